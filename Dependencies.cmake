@@ -24,15 +24,38 @@ CPMAddPackage(
         "GLFW_INSTALL OFF"
 )
 
+# The renderer needs API newer than VkMana's first releases, see src/Rendering/VkManaRequirements.cpp. Pin a revision that passes
+# those checks with -DGS_VKMANA_GIT_TAG=<commit>, or build against a local checkout with -DCPM_VkMana_SOURCE=<path>.
+set(GS_VKMANA_GIT_TAG main CACHE STRING "VkMana revision to fetch, a commit hash for reproducible builds")
 CPMAddPackage(
         NAME VkMana
         GITHUB_REPOSITORY stuart6854/VkMana
-        GIT_TAG main
+        GIT_TAG ${GS_VKMANA_GIT_TAG}
         SYSTEM ON
         OPTIONS
         "VKMANA_BUILD_SAMPLES OFF"
 )
 
+# The commit actually built. Logged so a working build can be pinned, and part of the shader cache key (see ShaderCache).
+set(GS_VKMANA_REVISION ${GS_VKMANA_GIT_TAG})
+find_package(Git QUIET)
+if (GIT_FOUND AND EXISTS ${VkMana_SOURCE_DIR}/.git)
+    execute_process(
+            COMMAND ${GIT_EXECUTABLE} rev-parse HEAD
+            WORKING_DIRECTORY ${VkMana_SOURCE_DIR}
+            OUTPUT_VARIABLE GS_VKMANA_REVISION
+            OUTPUT_STRIP_TRAILING_WHITESPACE
+            ERROR_QUIET
+    )
+endif ()
+string(LENGTH "${GS_VKMANA_GIT_TAG}" GS_VKMANA_GIT_TAG_LENGTH)
+if (NOT CPM_VkMana_SOURCE AND (NOT GS_VKMANA_GIT_TAG MATCHES "^[0-9a-f]+$" OR NOT GS_VKMANA_GIT_TAG_LENGTH EQUAL 40))
+    message(WARNING "VkMana is fetched from '${GS_VKMANA_GIT_TAG}', which can move and may stop providing the API checked in "
+            "src/Rendering/VkManaRequirements.cpp. Once it builds, pin it with -DGS_VKMANA_GIT_TAG=${GS_VKMANA_REVISION}")
+else ()
+    message(STATUS "VkMana revision: ${GS_VKMANA_REVISION}")
+endif ()
+
 CPMAddPackage(
         NAME assimp
         GITHUB_REPOSITORY assimp/assimp
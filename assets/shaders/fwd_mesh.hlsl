@@ -1,6 +1,7 @@
 #define BINDLESS_SPACE space0
 #define SCENE_SPACE space1
 #define MATERIAL_SPACE space2
+#define INSTANCE_SPACE space3
 
 Texture2D bindlessTextures[] : register(t0, BINDLESS_SPACE);
 SamplerState bindlessSamplers[] : register(s0, BINDLESS_SPACE);
@@ -15,17 +16,14 @@ cbuffer Scene : register(b0, SCENE_SPACE)
 	SceneUBO scene;
 };
 
-struct MaterialUBO
+struct MaterialData
 {
 	float4 albedoColor;
 	uint albedoTexIndex;
 	uint normalTexIndex;
 	float2 padding;
 };
-cbuffer Material : register(b0, MATERIAL_SPACE)
-{
-	MaterialUBO material[32];
-};
+StructuredBuffer<MaterialData> material : register(t0, MATERIAL_SPACE);
 
 struct VSInput
 {
@@ -35,12 +33,33 @@ struct VSInput
 	[[vk::location(3)]] float3 Tangent : TANGENT0;
 };
 
-struct PushConsts
+// PackedVertex, see VertexPacking.hpp. Attribute formats unpack to float in the vertex fetch.
+struct VSInputPacked
+{
+	[[vk::location(0)]] float4 Position : POSITION0; // Unorm16, dequantized by the model matrix
+	[[vk::location(1)]] float2 TexCoord : TEXCOORD0; // Half float
+	[[vk::location(2)]] float2 Normal : NORMAL0;	 // Octahedral snorm16
+	[[vk::location(3)]] float2 Tangent : TANGENT0;	 // Octahedral snorm16
+};
+
+float3 OctDecode(float2 e)
+{
+	float3 n = float3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+// Per-instance data, in the renderer's sorted draw order. Indexed by instance index (includes the draw's firstInstance).
+// Indirect draws only honour a non-zero firstInstance with drawIndirectFirstInstance, the renderer draws directly without it.
+struct InstanceData
 {
 	float4x4 modelMatrix;
 	uint materialIndex;
+	uint3 padding;
 };
-[[vk::push_constant]] PushConsts consts;
+StructuredBuffer<InstanceData> instanceData : register(t0, INSTANCE_SPACE);
 
 struct VSOutput
 {
@@ -49,27 +68,52 @@ struct VSOutput
 	[[vk::location(1)]] float2 TexCoord : TEXCOORD0;
 	[[vk::location(2)]] float3 Normal : NORMAL0;
 	[[vk::location(3)]] float3 Tangent : TANGENT0;
+	[[vk::location(4)]] nointerpolation uint MaterialIndex : MATERIAL0;
 };
 
-VSOutput VSMain(VSInput input)
+VSInput UnpackVertex(VSInputPacked input)
+{
+	VSInput unpacked;
+	unpacked.Position = input.Position.xyz;
+	unpacked.TexCoord = input.TexCoord;
+	unpacked.Normal = OctDecode(input.Normal);
+	unpacked.Tangent = OctDecode(input.Tangent);
+	return unpacked;
+}
+
+VSOutput TransformVertex(VSInput input, float4x4 modelMatrix, uint materialIndex)
 {
 	VSOutput output;
 
-	output.FragPos = mul(scene.projMatrix, mul(scene.viewMatrix, mul(consts.modelMatrix, float4(input.Position.xyz, 1.0))));
+	output.FragPos = mul(scene.projMatrix, mul(scene.viewMatrix, mul(modelMatrix, float4(input.Position.xyz, 1.0))));
 
-	output.WorldPos = mul(consts.modelMatrix, float4(input.Position.xyz, 1.0)).xyz;
+	output.WorldPos = mul(modelMatrix, float4(input.Position.xyz, 1.0)).xyz;
 	output.TexCoord = input.TexCoord;
 	output.Normal = normalize(input.Normal);
 	output.Tangent = normalize(input.Tangent);
+	output.MaterialIndex = materialIndex;
 	return output;
 }
 
+VSOutput VSMain(VSInput input, uint instanceId : SV_InstanceID)
+{
+	const InstanceData data = instanceData[instanceId];
+	return TransformVertex(input, data.modelMatrix, data.materialIndex);
+}
+
+VSOutput VSMainPacked(VSInputPacked input, uint instanceId : SV_InstanceID)
+{
+	const InstanceData data = instanceData[instanceId];
+	return TransformVertex(UnpackVertex(input), data.modelMatrix, data.materialIndex);
+}
+
 struct PSInput
 {
 	[[vk::location(0)]] float3 WorldPos : POSITION0;
 	[[vk::location(1)]] float2 TexCoord : TEXCOORD0;
 	[[vk::location(2)]] float3 Normal : NORMAL0;
 	[[vk::location(3)]] float3 Tangent : TANGENT0;
+	[[vk::location(4)]] nointerpolation uint MaterialIndex : MATERIAL0;
 };
 
 struct PSOutput
@@ -82,6 +126,7 @@ PSOutput PSMain(PSInput input)
 	PSOutput output;
 
 	// Calculate normal in tangent space
+	// Normal maps are cooked to BC5 (XY only), reconstruct Z with: z = sqrt(saturate(1.0 - dot(xy, xy)))
 	/* float3 N = normalize(input.Normal);
 	float3 T = normalize(input.Tangent);
 	float3 B = cross(N, T);
@@ -95,7 +140,7 @@ PSOutput PSMain(PSInput input)
 
 	// output.Albedo = textureColor.Sample(samplerColor, input.UV);
 	// output.FragColor = float4(1, 1, 1, 1);
-	output.FragColor = bindlessTextures[material[consts.materialIndex].albedoTexIndex].Sample(bindlessSamplers[material[consts.materialIndex].albedoTexIndex], input.TexCoord);
+	output.FragColor = bindlessTextures[material[input.MaterialIndex].albedoTexIndex].Sample(bindlessSamplers[material[input.MaterialIndex].albedoTexIndex], input.TexCoord);
 
 	return output;
 }
\ No newline at end of file
@@ -0,0 +1,260 @@
+/**
+ * JobSystem scaling and stress tests.
+ *
+ * The scaling run times ParallelFor over fine and coarse work, and a tree of dependent jobs, with 1..N workers (plus the calling
+ * thread). The stress run hammers nested ParallelFor, dependencies, counters reused across rounds, jobs started from several
+ * external threads at once and background jobs, and checks every job ran exactly once (and background jobs only where allowed).
+ * Build with GS_ENABLE_TSAN to run it under ThreadSanitizer.
+ *
+ * Usage: graphics-sandbox-job-bench [--stress [rounds]] [maxWorkers]
+ */
+
+#include "Core/JobSystem.hpp"
+#include "Core/Logging.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	constexpr size_t BENCH_ITEM_COUNT = 1 << 20;
+	constexpr uint32_t BENCH_REPEATS = 10;
+	constexpr uint32_t BENCH_TREE_DEPTH = 12; // 2^12 leaf jobs
+	constexpr uint32_t STRESS_DEFAULT_ROUNDS = 200;
+	constexpr uint32_t STRESS_EXTERNAL_THREADS = 3;
+
+	/* Roughly `iterations` x a few ns of arithmetic that the compiler cannot drop. */
+	auto Work(size_t item, uint32_t iterations) -> float
+	{
+		auto value = float(item);
+		for (auto i = 0u; i < iterations; ++i)
+			value = std::sqrt(value * 1.0001f + 1.0f);
+		return value;
+	}
+
+	template <typename Fn>
+	auto MeasureMs(Fn&& fn) -> double
+	{
+		fn(); // Warm up the workers and the caches
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		for (auto i = 0u; i < BENCH_REPEATS; ++i)
+			fn();
+		const auto endTime = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::milli>(endTime - startTime).count() / BENCH_REPEATS;
+	}
+
+	/* A binary tree of jobs: each node starts its two children, the parent's counter tracks the whole subtree. */
+	void SpawnTree(JobSystem& jobs, JobCounter& counter, uint32_t depth, std::atomic<uint64_t>& leafCount)
+	{
+		if (depth == 0)
+		{
+			Work(depth, 200);
+			leafCount.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		for (auto child = 0; child < 2; ++child)
+			jobs.Run([&jobs, &counter, depth, &leafCount] { SpawnTree(jobs, counter, depth - 1, leafCount); }, &counter);
+	}
+
+	void RunScaling(uint32_t maxWorkers)
+	{
+		std::vector<float> output(BENCH_ITEM_COUNT);
+
+		LOG_INFO("{:>7} | {:>10} {:>7} | {:>10} {:>7} | {:>10} {:>7} | {:>8}", "threads", "fine ms", "speedup", "coarse ms", "speedup", "tree ms", "speedup", "steals");
+		double baseline[3] = {};
+		for (auto workerCount = 0u; workerCount <= maxWorkers; workerCount = workerCount == 0 ? 1 : workerCount * 2)
+		{
+			// 0 workers is the calling thread alone.
+			if (workerCount == 0)
+			{
+				baseline[0] = MeasureMs([&] { for (size_t i = 0; i < BENCH_ITEM_COUNT; ++i) output[i] = Work(i, 4); });
+				baseline[1] = MeasureMs([&] { for (size_t i = 0; i < BENCH_ITEM_COUNT / 64; ++i) output[i] = Work(i, 256); });
+				baseline[2] = MeasureMs([&] { for (auto i = 0u; i < (1u << BENCH_TREE_DEPTH); ++i) Work(0, 200); });
+				LOG_INFO("{:>7} | {:>10.3f} {:>7.2f} | {:>10.3f} {:>7.2f} | {:>10.3f} {:>7.2f} | {:>8}", 1, baseline[0], 1.0, baseline[1], 1.0, baseline[2], 1.0, 0);
+				continue;
+			}
+
+			JobSystem jobs(workerCount);
+			const auto fineMs = MeasureMs([&] {
+				jobs.ParallelFor(0, BENCH_ITEM_COUNT, 4096, [&](size_t begin, size_t end) {
+					for (auto i = begin; i < end; ++i)
+						output[i] = Work(i, 4);
+				});
+			});
+			const auto coarseMs = MeasureMs([&] {
+				jobs.ParallelFor(0, BENCH_ITEM_COUNT / 64, 64, [&](size_t begin, size_t end) {
+					for (auto i = begin; i < end; ++i)
+						output[i] = Work(i, 256);
+				});
+			});
+			std::atomic<uint64_t> leafCount = 0;
+			const auto treeMs = MeasureMs([&] {
+				JobCounter counter;
+				SpawnTree(jobs, counter, BENCH_TREE_DEPTH, leafCount);
+				jobs.Wait(counter);
+			});
+
+			LOG_INFO("{:>7} | {:>10.3f} {:>7.2f} | {:>10.3f} {:>7.2f} | {:>10.3f} {:>7.2f} | {:>8}",
+				workerCount + 1,
+				fineMs,
+				baseline[0] / fineMs,
+				coarseMs,
+				baseline[1] / coarseMs,
+				treeMs,
+				baseline[2] / treeMs,
+				jobs.GetStealCount());
+		}
+	}
+
+	/* Returns the number of failed checks. */
+	auto RunStress(uint32_t rounds, uint32_t workerCount) -> uint32_t
+	{
+		JobSystem jobs(workerCount);
+		uint32_t failures = 0;
+		const auto check = [&failures](bool condition, const char* what, uint32_t round) {
+			if (!condition)
+			{
+				LOG_ERR("Stress round {}: {}", round, what);
+				++failures;
+			}
+		};
+
+		JobCounter reusedCounter; // Reused every round, once it has reached zero
+		for (auto round = 0u; round < rounds; ++round)
+		{
+			// Nested ParallelFor: every item visited exactly once.
+			constexpr size_t OUTER = 64;
+			constexpr size_t INNER = 1000;
+			std::vector<std::atomic<uint32_t>> visits(OUTER * INNER);
+			jobs.ParallelFor(0, OUTER, 1, [&](size_t outerBegin, size_t outerEnd) {
+				for (auto outer = outerBegin; outer < outerEnd; ++outer)
+				{
+					jobs.ParallelFor(0, INNER, 16, [&, outer](size_t begin, size_t end) {
+						for (auto i = begin; i < end; ++i)
+							visits[outer * INNER + i].fetch_add(1, std::memory_order_relaxed);
+					});
+				}
+			});
+			auto visitedOnce = true;
+			for (const auto& visit : visits)
+				visitedOnce &= visit.load(std::memory_order_relaxed) == 1;
+			check(visitedOnce, "nested ParallelFor visited an item other than once", round);
+
+			// Dependencies: a chain of stages, each stage only starts once the previous one has finished.
+			constexpr uint32_t STAGES = 8;
+			constexpr uint32_t JOBS_PER_STAGE = 32;
+			JobCounter stageCounters[STAGES];
+			std::atomic<uint32_t> stageDone[STAGES] = {};
+			std::atomic<uint32_t> orderViolations = 0;
+			for (auto stage = 0u; stage < STAGES; ++stage)
+			{
+				for (auto i = 0u; i < JOBS_PER_STAGE; ++i)
+				{
+					const auto run = [&, stage] {
+						if (stage > 0 && stageDone[stage - 1].load(std::memory_order_relaxed) != JOBS_PER_STAGE)
+							orderViolations.fetch_add(1, std::memory_order_relaxed);
+						stageDone[stage].fetch_add(1, std::memory_order_relaxed);
+					};
+					if (stage == 0)
+						jobs.Run(run, &stageCounters[stage]);
+					else
+						jobs.Run(run, &stageCounters[stage], { &stageCounters[stage - 1] });
+				}
+			}
+			jobs.Wait(stageCounters[STAGES - 1]);
+			check(orderViolations.load() == 0, "a job started before its dependency finished", round);
+			check(stageDone[STAGES - 1].load() == JOBS_PER_STAGE, "last stage incomplete", round);
+			for (auto& counter : stageCounters)
+				jobs.Wait(counter); // Earlier stages are done, this only checks Wait() on a finished counter.
+
+			// Several external threads starting jobs on a shared, reused counter, and waiting on their own.
+			std::atomic<uint32_t> externalRuns = 0;
+			std::vector<std::thread> threads;
+			for (auto t = 0u; t < STRESS_EXTERNAL_THREADS; ++t)
+			{
+				threads.emplace_back([&] {
+					JobCounter ownCounter;
+					for (auto i = 0u; i < 100; ++i)
+					{
+						jobs.Run([&] { externalRuns.fetch_add(1, std::memory_order_relaxed); }, &reusedCounter);
+						jobs.Run([&] { externalRuns.fetch_add(1, std::memory_order_relaxed); }, &ownCounter);
+					}
+					jobs.Wait(ownCounter);
+				});
+			}
+			for (auto& thread : threads)
+				thread.join();
+			jobs.Wait(reusedCounter);
+			check(externalRuns.load() == STRESS_EXTERNAL_THREADS * 200, "jobs from external threads lost or repeated", round);
+
+			// Background jobs: a wait outside a background job never runs them (nor the ranges of their ParallelFor), nested work in
+			// them still completes.
+			const auto callerId = std::this_thread::get_id();
+			std::atomic<uint32_t> backgroundOnCaller = 0;
+			std::atomic<uint32_t> backgroundItems = 0;
+			JobCounter backgroundCounter;
+			auto backgroundFuture = jobs.EnqueueBackground(
+				[&] {
+					jobs.ParallelFor(0, 1000, 16, [&](size_t begin, size_t end) {
+						if (std::this_thread::get_id() == callerId)
+							backgroundOnCaller.fetch_add(1, std::memory_order_relaxed);
+						backgroundItems.fetch_add(uint32_t(end - begin), std::memory_order_relaxed);
+					});
+					return std::this_thread::get_id() != callerId;
+				},
+				&backgroundCounter);
+			jobs.ParallelFor(0, 1000, 16, [&](size_t begin, size_t end) {
+				for (auto i = begin; i < end; ++i)
+					Work(i, 16);
+			});
+			jobs.Wait(backgroundCounter);
+			check(backgroundFuture.get() && backgroundOnCaller.load() == 0, "a background job ran in a frame-critical wait", round);
+			check(backgroundItems.load() == 1000, "background ParallelFor incomplete", round);
+
+			// Futures
+			auto future = jobs.Enqueue([round] { return round * 2; }, nullptr, { &reusedCounter });
+			check(future.get() == round * 2, "Enqueue returned a wrong result", round);
+		}
+		return failures;
+	}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	auto stress = false;
+	auto rounds = STRESS_DEFAULT_ROUNDS;
+	auto maxWorkers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	for (auto i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--stress") == 0)
+		{
+			stress = true;
+			if (i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+				rounds = uint32_t(std::atoi(argv[++i]));
+		}
+		else if (std::atoi(argv[i]) > 0)
+			maxWorkers = uint32_t(std::atoi(argv[i]));
+	}
+
+	if (!stress)
+	{
+		LOG_INFO("Graphics Sandbox - JobSystem scaling, up to {} workers", maxWorkers);
+		RunScaling(maxWorkers);
+		return 0;
+	}
+
+	LOG_INFO("Graphics Sandbox - JobSystem stress, {} rounds, {} workers", rounds, maxWorkers);
+	const auto failures = RunStress(rounds, maxWorkers);
+	if (failures != 0)
+	{
+		LOG_ERR("{} checks failed", failures);
+		return 1;
+	}
+	LOG_INFO("All checks passed");
+	return 0;
+}
@@ -0,0 +1,159 @@
+/**
+ * Per-call latency of the LOG_* macros: the previous synchronous macros (fmt::format + std::cout + std::endl) against the asynchronous
+ * Logger with each overflow policy. stdout is redirected to a file so terminal speed does not dominate, results are printed to stderr.
+ *
+ * Usage: graphics-sandbox-log-bench [callsPerThread] [outputFile]
+ */
+
+#include "Core/Logging.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* The macros as they were before the asynchronous logger. */
+#define LEGACY_LOG_INFO(...) std::cout << "[INFO] " << fmt::format(__VA_ARGS__) << std::endl
+
+namespace
+{
+	constexpr uint32_t BENCH_DEFAULT_CALLS_PER_THREAD = 100'000;
+	constexpr uint32_t BENCH_THREAD_COUNTS[] = { 1, 4 };
+
+	using Clock = std::chrono::steady_clock;
+
+	enum class LogMode
+	{
+		Legacy,
+		AsyncDrop,
+		AsyncBlock,
+	};
+
+	auto GetModeName(LogMode mode) -> const char*
+	{
+		switch (mode)
+		{
+			case LogMode::Legacy:
+				return "legacy (cout+endl)";
+			case LogMode::AsyncDrop:
+				return "async, drop";
+			case LogMode::AsyncBlock:
+				return "async, block";
+		}
+		return "";
+	}
+
+	/* A typical message from asset loading: a path, an index and a float. */
+	void LogOnce(LogMode mode, const std::string& path, uint32_t index, float value)
+	{
+		if (mode == LogMode::Legacy)
+			LEGACY_LOG_INFO("Loaded mesh {} (submesh {}, {:.2f} ms)", path, index, value);
+		else
+			LOG_INFO("Loaded mesh {} (submesh {}, {:.2f} ms)", path, index, value);
+	}
+
+	/* Nearest rank. `values` must be sorted. */
+	auto GetPercentile(const std::vector<uint64_t>& values, double percentile) -> uint64_t
+	{
+		const auto rank = size_t(percentile / 100.0 * double(values.size()) + 0.5);
+		return values[std::min(values.size() - 1, rank > 0 ? rank - 1 : 0)];
+	}
+
+	void RunCase(LogMode mode, uint32_t threadCount, uint32_t callsPerThread)
+	{
+		if (mode != LogMode::Legacy)
+			Logger::Get().SetOverflowPolicy(mode == LogMode::AsyncDrop ? LogOverflowPolicy::Drop : LogOverflowPolicy::Block);
+		const auto droppedBefore = Logger::Get().GetDroppedCount();
+
+		std::vector<std::vector<uint64_t>> threadLatencies(threadCount);
+		std::vector<std::thread> threads;
+		const auto startTime = Clock::now();
+		for (auto t = 0u; t < threadCount; ++t)
+		{
+			threads.emplace_back(
+				[&, t]
+				{
+					const std::string path = fmt::format("assets/models/thread_{}/mesh.gltf", t);
+					auto& latencies = threadLatencies[t];
+					latencies.reserve(callsPerThread);
+					for (auto i = 0u; i < callsPerThread; ++i)
+					{
+						const auto callStart = Clock::now();
+						LogOnce(mode, path, i, float(i) * 0.01f);
+						latencies.push_back(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - callStart).count()));
+					}
+				});
+		}
+		for (auto& thread : threads)
+			thread.join();
+		const auto callTime = Clock::now() - startTime;
+
+		// The async loggers still have to write, include that in the throughput.
+		if (mode != LogMode::Legacy)
+			Logger::Get().Flush();
+		const auto totalTime = Clock::now() - startTime;
+
+		std::vector<uint64_t> latencies;
+		latencies.reserve(size_t(threadCount) * callsPerThread);
+		for (const auto& threadLatency : threadLatencies)
+			latencies.insert(latencies.end(), threadLatency.begin(), threadLatency.end());
+		std::sort(latencies.begin(), latencies.end());
+
+		const auto toMs = [](auto duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+		fmt::print(stderr,
+			"{:<20} {:>7} {:>10} {:>10} {:>10} {:>12} {:>12.2f} {:>12.2f} {:>10}\n",
+			GetModeName(mode),
+			threadCount,
+			GetPercentile(latencies, 50.0),
+			GetPercentile(latencies, 99.0),
+			GetPercentile(latencies, 99.9),
+			latencies.back(),
+			toMs(callTime),
+			toMs(totalTime),
+			Logger::Get().GetDroppedCount() - droppedBefore);
+	}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	const auto callsPerThread = argc > 1 ? uint32_t(std::strtoul(argv[1], nullptr, 10)) : BENCH_DEFAULT_CALLS_PER_THREAD;
+	const std::string outputFile = argc > 2 ? argv[2] : "log-bench-output.txt";
+	if (callsPerThread == 0)
+	{
+		fmt::print(stderr, "Usage: graphics-sandbox-log-bench [callsPerThread] [outputFile]\n");
+		return 1;
+	}
+
+	if (!std::freopen(outputFile.c_str(), "w", stdout))
+	{
+		fmt::print(stderr, "Failed to redirect stdout to {}\n", outputFile);
+		return 1;
+	}
+
+	fmt::print(stderr, "Per-call latency in ns, {} calls per thread, output written to {}\n", callsPerThread, outputFile);
+	fmt::print(stderr,
+		"{:<20} {:>7} {:>10} {:>10} {:>10} {:>12} {:>12} {:>12} {:>10}\n",
+		"mode",
+		"threads",
+		"p50",
+		"p99",
+		"p99.9",
+		"max",
+		"calls (ms)",
+		"written (ms)",
+		"dropped");
+
+	for (const auto threadCount : BENCH_THREAD_COUNTS)
+	{
+		for (const auto mode : { LogMode::Legacy, LogMode::AsyncDrop, LogMode::AsyncBlock })
+			RunCase(mode, threadCount, callsPerThread);
+	}
+
+	return 0;
+}
@@ -0,0 +1,336 @@
+/**
+ * CPU microbenchmarks of the renderer's submission path: Submit() (mesh/material resolution, LOD selection, sort keys), culling,
+ * sorting, batching and draw recording. Draws are recorded into a mock command buffer and no device is ever created, so this runs
+ * without a GPU.
+ *
+ * Usage: graphics-sandbox-bench [maxInstances]
+ */
+
+#include "Core/HeadlessWindow.hpp"
+#include "Core/Logging.hpp"
+#include "Rendering/Renderer.hpp"
+
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace
+{
+	std::atomic<uint64_t> g_allocationCount = 0;
+} // namespace
+
+/* Every heap allocation in the process is counted, so each phase's allocations can be reported. */
+void* operator new(size_t size)
+{
+	g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* ptr = std::malloc(size != 0 ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+void operator delete(void* ptr, size_t /*size*/) noexcept
+{
+	std::free(ptr);
+}
+
+namespace
+{
+	constexpr uint32_t BENCH_SURFACE_WIDTH = 1920;
+	constexpr uint32_t BENCH_SURFACE_HEIGHT = 1080;
+	constexpr uint64_t BENCH_INSTANCES_PER_SCENE = 4'000'000; // Frames are repeated until roughly this many instances were submitted.
+	constexpr uint32_t BENCH_MIN_FRAMES = 3;
+
+	/* Accepts the calls made by Renderer::DrawRenderInstances(). Only counts them. */
+	struct MockCommandBuffer
+	{
+		uint64_t commandCount = 0;
+		uint64_t checksum = 0; // Keeps the draw arguments observable
+
+		void BindPipeline(VkMana::Pipeline* /*pipeline*/) { ++commandCount; }
+		void BindVertexBuffers(uint32_t /*firstBinding*/, const std::vector<const VkMana::Buffer*>& /*buffers*/, const std::vector<uint64_t>& /*offsets*/)
+		{
+			++commandCount;
+		}
+		void BindIndexBuffer(const VkMana::Buffer* /*buffer*/) { ++commandCount; }
+		void DrawIndexed(uint32_t indexCount, uint32_t firstIndex, uint32_t vertexOffset, uint32_t instanceCount, uint32_t firstInstance)
+		{
+			++commandCount;
+			checksum += uint64_t(indexCount) + firstIndex + vertexOffset + instanceCount + firstInstance;
+		}
+	};
+
+	struct SceneConfig
+	{
+		uint32_t instanceCount;
+		uint32_t meshCount;
+		uint32_t submeshesPerMesh; // Each submesh has its own material
+	};
+
+	enum Phase : uint32_t
+	{
+		PhaseSubmit,
+		PhaseCull,
+		PhaseSort,
+		PhaseBatch,
+		PhaseRecord,
+		PhaseCount,
+	};
+	constexpr const char* PHASE_NAMES[PhaseCount] = { "submit", "cull", "sort", "batch", "record" };
+
+	struct PhaseResult
+	{
+		double timeNs = 0.0;
+		uint64_t allocations = 0;
+	};
+
+	/* Times `fn` and counts its allocations. */
+	template <typename Fn>
+	void MeasurePhase(PhaseResult& result, Fn&& fn)
+	{
+		const auto allocationsBefore = g_allocationCount.load(std::memory_order_relaxed);
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		fn();
+		const auto endTime = std::chrono::high_resolution_clock::now();
+		result.timeNs += std::chrono::duration<double, std::nano>(endTime - startTime).count();
+		result.allocations += g_allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+	}
+
+	/* Deterministic, so every run submits the same scene. */
+	struct Random
+	{
+		uint32_t state = 0x12345678;
+
+		auto Next() -> float
+		{
+			state = state * 1664525u + 1013904223u;
+			return float(state >> 8) / float(1u << 24);
+		}
+	};
+} // namespace
+
+class RendererBenchmark
+{
+public:
+	RendererBenchmark()
+	{
+		m_window.Init(BENCH_SURFACE_WIDTH, BENCH_SURFACE_HEIGHT);
+	}
+
+	void Run(uint32_t maxInstances)
+	{
+		const SceneConfig scenes[] = {
+			{ 1'000, 1, 1 },
+			{ 1'000, 16, 4 },
+			{ 10'000, 1, 1 },
+			{ 10'000, 16, 4 },
+			{ 10'000, 256, 1 },
+			{ 100'000, 1, 1 },
+			{ 100'000, 16, 4 },
+			{ 100'000, 256, 1 },
+			{ 1'000'000, 1, 1 },
+			{ 1'000'000, 256, 1 },
+		};
+
+		LOG_INFO("{:>9} {:>6} {:>9} | {:>8} {:>8} {:>8} {:>8} {:>8} {:>8} | {:>12} | {:>8} {:>8}",
+			"instances",
+			"meshes",
+			"materials",
+			"submit",
+			"cull",
+			"sort",
+			"batch",
+			"record",
+			"total",
+			"allocs/frame",
+			"mesh",
+			"material");
+		LOG_INFO("{:>9} {:>6} {:>9} | {:>53} | {:>12} | {:>17}", "", "", "", "ns/instance", "", "ns/lookup (hot)");
+		for (const auto& scene : scenes)
+		{
+			if (scene.instanceCount <= maxInstances)
+				RunScene(scene);
+		}
+	}
+
+private:
+	void RunScene(const SceneConfig& config)
+	{
+		/* A fresh renderer per scene, nothing is carried over. Init() is never called, so no device or GPU resources are created. */
+		auto renderer = std::make_unique<Renderer>();
+		renderer->m_window = &m_window;
+
+		const auto aspect = float(BENCH_SURFACE_WIDTH) / float(BENCH_SURFACE_HEIGHT);
+		const auto projMatrix = glm::perspectiveLH_ZO(glm::radians(60.0f), aspect, 0.1f, 1000.0f);
+		const auto viewMatrix = glm::lookAtLH(glm::vec3(0.0f, 20.0f, -10.0f), glm::vec3(0.0f, 0.0f, 50.0f), glm::vec3(0, 1, 0));
+		renderer->SetCamera(projMatrix, viewMatrix);
+
+		const auto meshes = CreateMeshes(*renderer, config); // Destroyed before the renderer, whose geometry buffer they reference.
+
+		// Instances are scattered over an area wider than the view, so some are culled and LODs vary with distance.
+		Random random{};
+		std::vector<glm::mat4> transforms(config.instanceCount);
+		std::vector<Mesh*> instanceMeshes(config.instanceCount);
+		for (auto i = 0u; i < config.instanceCount; ++i)
+		{
+			const auto position = glm::vec3((random.Next() - 0.5f) * 400.0f, 0.0f, random.Next() * 400.0f);
+			transforms[i] = glm::translate(glm::mat4(1.0f), position);
+			instanceMeshes[i] = meshes[i % meshes.size()].get();
+		}
+
+		const auto frameCount = uint32_t(std::max<uint64_t>(BENCH_INSTANCES_PER_SCENE / config.instanceCount, BENCH_MIN_FRAMES));
+		PhaseResult phases[PhaseCount] = {};
+		MockCommandBuffer cmd{};
+		// Init() is not called, so there is no render thread. The packet is drawn right where it is built.
+		auto& packet = renderer->m_packets[renderer->m_buildPacketIndex];
+		// The first frame also registers every mesh/material, it is not measured.
+		for (auto frame = 0u; frame <= frameCount; ++frame)
+		{
+			PhaseResult framePhases[PhaseCount] = {};
+			MeasurePhase(framePhases[PhaseSubmit],
+				[&]
+				{
+					for (auto i = 0u; i < config.instanceCount; ++i)
+						renderer->Submit(instanceMeshes[i], transforms[i]);
+				});
+			renderer->m_drawMeshes = renderer->m_meshes;
+			MeasurePhase(framePhases[PhaseCull], [&] { renderer->CullRenderInstances(packet); });
+			MeasurePhase(framePhases[PhaseSort], [&] { renderer->SortRenderInstances(packet); });
+			MeasurePhase(framePhases[PhaseBatch], [&] { renderer->BuildDrawBatches(packet); });
+			MeasurePhase(framePhases[PhaseRecord],
+				[&] { renderer->DrawRenderInstances(cmd, 0, renderer->m_drawBatches.size(), renderer->m_frameStats); });
+
+			packet.renderInstances.clear();
+			packet.instanceSpheres.Clear();
+			renderer->m_frameStats = {};
+
+			if (frame == 0)
+				continue;
+			for (auto phase = 0u; phase < PhaseCount; ++phase)
+			{
+				phases[phase].timeNs += framePhases[phase].timeNs;
+				phases[phase].allocations += framePhases[phase].allocations;
+			}
+		}
+
+		const auto instancesSubmitted = double(config.instanceCount) * frameCount;
+		double totalTimeNs = 0.0;
+		uint64_t totalAllocations = 0;
+		for (const auto& phase : phases)
+		{
+			totalTimeNs += phase.timeNs;
+			totalAllocations += phase.allocations;
+		}
+
+		const auto [meshLookupNs, materialLookupNs] = MeasureLookups(*renderer, meshes);
+
+		LOG_INFO("{:>9} {:>6} {:>9} | {:>8.2f} {:>8.2f} {:>8.2f} {:>8.2f} {:>8.2f} {:>8.2f} | {:>12} | {:>8.2f} {:>8.2f}",
+			config.instanceCount,
+			config.meshCount,
+			config.meshCount * config.submeshesPerMesh,
+			phases[PhaseSubmit].timeNs / instancesSubmitted,
+			phases[PhaseCull].timeNs / instancesSubmitted,
+			phases[PhaseSort].timeNs / instancesSubmitted,
+			phases[PhaseBatch].timeNs / instancesSubmitted,
+			phases[PhaseRecord].timeNs / instancesSubmitted,
+			totalTimeNs / instancesSubmitted,
+			totalAllocations / frameCount,
+			meshLookupNs,
+			materialLookupNs);
+
+		for (auto phase = 0u; phase < PhaseCount; ++phase)
+		{
+			if (phases[phase].allocations != 0)
+				LOG_INFO("{:>29} {} allocations/frame", PHASE_NAMES[phase], phases[phase].allocations / frameCount);
+		}
+		if (cmd.checksum == 0)
+			LOG_WARN("No draws were recorded");
+	}
+
+	/* Meshes with CPU-side data only. Vertex/index data would need a device, and is never read by the submission path. */
+	static auto CreateMeshes(Renderer& renderer, const SceneConfig& config) -> std::vector<std::unique_ptr<Mesh>>
+	{
+		std::vector<std::unique_ptr<Mesh>> meshes;
+		for (auto meshIndex = 0u; meshIndex < config.meshCount; ++meshIndex)
+		{
+			std::vector<Submesh> submeshes(config.submeshesPerMesh);
+			for (auto i = 0u; i < config.submeshesPerMesh; ++i)
+			{
+				auto& submesh = submeshes[i];
+				submesh.indexOffset = i * 3000;
+				submesh.indexCount = 3000;
+				submesh.vertexCount = 1000;
+				submesh.materialIndex = i;
+				submesh.boundsMin = glm::vec3(-1.0f);
+				submesh.boundsMax = glm::vec3(1.0f);
+				submesh.sphereRadius = 1.0f;
+				submesh.lodCount = MAX_SUBMESH_LODS;
+				for (auto lod = 0u; lod < MAX_SUBMESH_LODS; ++lod)
+				{
+					submesh.lods[lod].indexOffset = submesh.indexOffset;
+					submesh.lods[lod].indexCount = submesh.indexCount >> lod;
+					submesh.lods[lod].error = lod * 0.01f;
+				}
+			}
+
+			auto& mesh = meshes.emplace_back(std::make_unique<Mesh>(renderer.m_geometry, renderer.m_assets));
+			mesh->SetSubmeshes(submeshes);
+			mesh->SetMaterials(std::vector<Material>(config.submeshesPerMesh));
+		}
+		return meshes;
+	}
+
+	/* Cost of AddOrGetMesh()/AddOrGetBindlessMaterial() once everything is registered, the common case every frame. */
+	static auto MeasureLookups(Renderer& renderer, const std::vector<std::unique_ptr<Mesh>>& meshes) -> std::pair<double, double>
+	{
+		constexpr uint32_t LOOKUP_ITERATIONS = 1'000'000;
+
+		uint64_t sink = 0;
+		auto startTime = std::chrono::high_resolution_clock::now();
+		for (auto i = 0u; i < LOOKUP_ITERATIONS; ++i)
+			sink += renderer.AddOrGetMesh(meshes[i % meshes.size()].get());
+		auto endTime = std::chrono::high_resolution_clock::now();
+		const auto meshLookupNs = std::chrono::duration<double, std::nano>(endTime - startTime).count() / LOOKUP_ITERATIONS;
+
+		std::vector<Material*> materials;
+		for (const auto& mesh : meshes)
+		{
+			for (auto& material : mesh->GetMaterials())
+				materials.push_back(&material);
+		}
+		startTime = std::chrono::high_resolution_clock::now();
+		for (auto i = 0u; i < LOOKUP_ITERATIONS; ++i)
+			sink += renderer.AddOrGetBindlessMaterial(materials[i % materials.size()]);
+		endTime = std::chrono::high_resolution_clock::now();
+		const auto materialLookupNs = std::chrono::duration<double, std::nano>(endTime - startTime).count() / LOOKUP_ITERATIONS;
+
+		if (sink == ~0ull)
+			LOG_INFO("{}", sink);
+		return { meshLookupNs, materialLookupNs };
+	}
+
+private:
+	HeadlessWindow m_window;
+};
+
+int main(int argc, char** argv)
+{
+	LOG_INFO("Graphics Sandbox - Renderer CPU benchmark");
+
+	uint32_t maxInstances = 1'000'000;
+	if (argc > 1 && std::atoi(argv[1]) > 0)
+		maxInstances = uint32_t(std::atoi(argv[1]));
+
+	RendererBenchmark benchmark{};
+	benchmark.Run(maxInstances);
+
+	return 0;
+}
@@ -1,70 +1,238 @@
 #include "App.hpp"
 
+#include "HeadlessWindow.hpp"
+#include "JobSystem.hpp"
 #include "Logging.hpp"
+#include "Profiler.hpp"
+#include "Window.hpp"
 
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
 
+#include <chrono>
+
 constexpr auto WINDOW_INIT_WIDTH = 1280;
 constexpr auto WINDOW_INIT_HEIGHT = 720;
 
+constexpr auto RECORD_SCALING_GRID_SIZE = 100;
+constexpr auto RECORD_SCALING_WARMUP_FRAMES = 30u;
+constexpr auto RECORD_SCALING_MEASURE_FRAMES = 120u;
+
+constexpr auto BENCHMARK_WARMUP_FRAMES = 60u; // Excluded from the report, covers pipeline compilation and first-use uploads.
+
 void App::Run()
 {
 	Init();
 
 	while (m_isRunning)
 	{
-		m_window.NewFrame();
-		if (!m_window.IsAlive())
+		const auto frameStartTime = std::chrono::high_resolution_clock::now();
+		PROFILE_SCOPE("Frame");
+
+		m_window->PollEvents();
+		if (!m_window->IsAlive())
 		{
 			m_isRunning = false;
 			break;
 		}
 
 		/* Render */
-		const auto windowAspect = float(m_window.GetSurfaceWidth()) / float(m_window.GetSurfaceHeight());
+		const auto windowAspect = float(m_window->GetSurfaceWidth()) / float(m_window->GetSurfaceHeight());
 		const auto projMatrix = glm::perspectiveLH_ZO(glm::radians(60.0f), windowAspect, 0.1f, 1000.0f);
 		const auto viewMatrix = glm::lookAtLH(glm::vec3(-0.0f, 5.0f, -10.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0, 1, 0));
 		m_renderer->SetCamera(projMatrix, viewMatrix);
 
-		auto backpackTransform = glm::translate(glm::mat4(1.0f), { -3.0f, 0, -2.0f }) * glm::scale(glm::mat4(1.0f), glm::vec3(0.05f))
-			* glm::rotate(glm::mat4(1.0f), glm::radians(210.0f), { 0, 1, 0 });
-		m_renderer->Submit(m_backpackMesh.get(), backpackTransform);
-
-		auto runestoneTransform = glm::translate(glm::mat4(1.0f), { 0, -5, 5 }) * glm::scale(glm::mat4(1.0f), glm::vec3(2.0f));
-		m_renderer->Submit(m_runestoneMesh.get(), runestoneTransform);
+		if (m_options.recordScalingBenchmark)
+			SubmitBenchmarkScene();
+		else
+			SubmitScene();
 
 		m_renderer->Flush();
+
+		if (m_options.recordScalingBenchmark)
+			UpdateRecordScalingBenchmark();
+
+		if (m_benchmark)
+		{
+			// With the render thread, the stats are one frame behind. Steady enough for the mismatch not to matter.
+			const auto frameEndTime = std::chrono::high_resolution_clock::now();
+			const auto& stats = m_renderer->GetStats();
+			const FrameTimes times{
+				.cpuMs = std::chrono::duration<double, std::milli>(frameEndTime - frameStartTime).count(),
+				.gpuMs = stats.gpuTimeMs,
+				.buildMs = stats.buildTimeMs,
+				.renderThreadMs = stats.renderThreadTimeMs,
+				.handoffWaitMs = stats.handoffWaitMs,
+			};
+			if (m_benchmark->AddFrame(times))
+				m_isRunning = false;
+		}
+
+		PROFILE_END_FRAME();
+	}
+#ifdef GS_PROFILER_ENABLED
+	Profiler::Get().EndCapture();
+#endif
+
+	if (m_renderer)
+		m_renderer->WaitForRenderThread();
+
+	if (m_benchmark)
+	{
+		const auto& output = m_options.benchmarkOutput;
+		const auto label = fmt::format("{}x{}{}{}",
+			m_window->GetSurfaceWidth(),
+			m_window->GetSurfaceHeight(),
+			m_options.headless ? " headless" : "",
+			m_options.renderThread ? " render-thread" : "");
+		LOG_INFO("Benchmark: main/render thread overlap {:.2f}", m_benchmark->GetOverlap());
+		m_benchmark->WriteReport(output == "-" ? std::filesystem::path() : output, label);
+	}
+
+	if (m_renderer)
+	{
+		m_renderer->GetAssets().LogStats();
+		m_renderer->GetFrameRing().LogStats();
 	}
 }
 
 void App::Init()
 {
-	if (!m_window.Init(WINDOW_INIT_WIDTH, WINDOW_INIT_HEIGHT, "Graphics Sandbox"))
+	if (!m_options.traceOutput.empty())
 	{
-		LOG_ERR("Failed to init window");
-		return;
+#ifdef GS_PROFILER_ENABLED
+		Profiler::Get().BeginCapture(m_options.traceOutput);
+#else
+		LOG_WARN("--trace ignored, built without GS_ENABLE_PROFILER");
+#endif
+	}
+
+	if (m_options.headless)
+	{
+		auto window = std::make_unique<HeadlessWindow>();
+		if (!window->Init(WINDOW_INIT_WIDTH, WINDOW_INIT_HEIGHT))
+		{
+			LOG_ERR("Failed to init headless window");
+			return;
+		}
+		m_window = std::move(window);
+	}
+	else
+	{
+		auto window = std::make_unique<Window>();
+		if (!window->Init(WINDOW_INIT_WIDTH, WINDOW_INIT_HEIGHT, "Graphics Sandbox"))
+		{
+			LOG_ERR("Failed to init window");
+			return;
+		}
+		m_window = std::move(window);
 	}
 
 	m_renderer = std::make_unique<Renderer>();
-	if (!m_renderer->Init(m_window))
+	m_renderer->SetPipelineCacheEnabled(m_options.pipelineCache);
+	m_renderer->SetRenderThreadEnabled(m_options.renderThread);
+	if (!m_renderer->Init(*m_window))
 	{
 		LOG_ERR("Failed to init renderer");
 		return;
 	}
 
-	m_backpackMesh = std::make_unique<Mesh>(m_renderer->GetContext());
-	if (!m_backpackMesh->LoadFromFile("assets/models/backpack/scene.gltf"))
+	auto& assets = m_renderer->GetAssets();
+	const MeshImportOptions importOptions{ .vertexFormat = VertexFormat::Packed };
+	// Benchmarks load up front so every measured frame draws the full scene. Otherwise the meshes stream in while the first frames run.
+	const auto loadMesh = [&](const std::filesystem::path& filename) {
+		const auto isBenchmark = m_options.benchmarkFrames != 0 || m_options.recordScalingBenchmark;
+		return isBenchmark ? assets.GetOrLoadMesh(filename, importOptions) : assets.LoadMeshAsync(filename, importOptions);
+	};
+	m_backpackMesh = loadMesh("assets/models/backpack/scene.gltf");
+	if (!m_backpackMesh)
 	{
 		LOG_ERR("Failed to load backpack model.");
 	}
-	m_runestoneMesh = std::make_unique<Mesh>(m_renderer->GetContext());
-	if (!m_runestoneMesh->LoadFromFile("assets/models/runestone/scene.gltf"))
+	m_runestoneMesh = loadMesh("assets/models/runestone/scene.gltf");
+	if (!m_runestoneMesh)
 	{
 		LOG_ERR("Failed to load backpack model.");
 	}
+	assets.LogStats();
+	m_renderer->GetGeometry().LogStats();
+
+	if (m_options.recordScalingBenchmark)
+	{
+		m_renderer->SetInstancing(false);
+		m_renderer->SetRecordThreadCount(1);
+		m_recordScaling.maxThreadCount = JobSystem::Get().GetWorkerCount() + 1;
+		LOG_INFO("Record scaling benchmark: 1-{} threads, {} frames each", m_recordScaling.maxThreadCount, RECORD_SCALING_MEASURE_FRAMES);
+	}
+
+	if (m_options.benchmarkFrames != 0)
+	{
+		if (m_window->IsVSync())
+			LOG_WARN("Benchmarking with VSync enabled, frame times will be capped by the display");
+		m_benchmark = std::make_unique<FrameBenchmark>(BENCHMARK_WARMUP_FRAMES, m_options.benchmarkFrames);
+		LOG_INFO("Benchmark: {} frames (+{} warmup)", m_options.benchmarkFrames, BENCHMARK_WARMUP_FRAMES);
+	}
 
 	LOG_INFO("Initialisation complete\n");
 
 	m_isRunning = true;
 }
+
+void App::SubmitScene()
+{
+	auto backpackTransform = glm::translate(glm::mat4(1.0f), { -3.0f, 0, -2.0f }) * glm::scale(glm::mat4(1.0f), glm::vec3(0.05f))
+		* glm::rotate(glm::mat4(1.0f), glm::radians(210.0f), { 0, 1, 0 });
+	m_renderer->Submit(m_backpackMesh.get(), backpackTransform);
+
+	auto runestoneTransform = glm::translate(glm::mat4(1.0f), { 0, -5, 5 }) * glm::scale(glm::mat4(1.0f), glm::vec3(2.0f));
+	m_renderer->Submit(m_runestoneMesh.get(), runestoneTransform);
+}
+
+void App::SubmitBenchmarkScene()
+{
+	for (auto z = 0; z < RECORD_SCALING_GRID_SIZE; ++z)
+	{
+		for (auto x = 0; x < RECORD_SCALING_GRID_SIZE; ++x)
+		{
+			const auto position = glm::vec3(float(x - RECORD_SCALING_GRID_SIZE / 2) * 2.0f, 0.0f, float(z) * 2.0f);
+			if ((x + z) % 2 == 0)
+				m_renderer->Submit(m_backpackMesh.get(), glm::translate(glm::mat4(1.0f), position) * glm::scale(glm::mat4(1.0f), glm::vec3(0.01f)));
+			else
+				m_renderer->Submit(m_runestoneMesh.get(), glm::translate(glm::mat4(1.0f), position) * glm::scale(glm::mat4(1.0f), glm::vec3(0.2f)));
+		}
+	}
+}
+
+void App::UpdateRecordScalingBenchmark()
+{
+	auto& benchmark = m_recordScaling;
+	++benchmark.frame;
+	if (benchmark.frame <= RECORD_SCALING_WARMUP_FRAMES)
+		return;
+
+	const auto& stats = m_renderer->GetStats();
+	benchmark.recordTimeMs += stats.recordTimeMs;
+	if (benchmark.frame < RECORD_SCALING_WARMUP_FRAMES + RECORD_SCALING_MEASURE_FRAMES)
+		return;
+
+	const auto averageTimeMs = benchmark.recordTimeMs / RECORD_SCALING_MEASURE_FRAMES;
+	if (benchmark.threadCount == 1)
+		benchmark.baselineTimeMs = averageTimeMs;
+	LOG_INFO("Record scaling: {:>2} threads ({} used), {} draws, {:.3f} ms, {:.2f}x",
+		benchmark.threadCount,
+		stats.recordThreads,
+		stats.drawCalls,
+		averageTimeMs,
+		benchmark.baselineTimeMs / averageTimeMs);
+
+	if (benchmark.threadCount >= benchmark.maxThreadCount)
+	{
+		m_isRunning = false;
+		return;
+	}
+
+	++benchmark.threadCount;
+	benchmark.frame = 0;
+	benchmark.recordTimeMs = 0.0;
+	m_renderer->SetRecordThreadCount(benchmark.threadCount);
+}
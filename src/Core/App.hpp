@@ -1,15 +1,29 @@
 #pragma once
 
+#include "FrameBenchmark.hpp"
 #include "Rendering/Mesh.hpp"
 #include "Rendering/Renderer.hpp"
-#include "Window.hpp"
 
+#include <VkMana/WSI.hpp>
+
+#include <filesystem>
 #include <memory>
 
+struct AppOptions
+{
+	bool recordScalingBenchmark = false; // --record-scaling: time draw recording with 1..N threads, then exit.
+	bool pipelineCache = true;			 // --no-pipeline-cache: neither load nor save the Vulkan pipeline cache.
+	bool headless = false;				 // --headless: render offscreen, without a window (see HeadlessWindow).
+	bool renderThread = true;			 // --no-render-thread: record and submit frames on the main thread, inside Renderer::Flush().
+	uint32_t benchmarkFrames = 0;		 // --benchmark [frames]: render the default scene for N frames, report frame times, then exit.
+	std::filesystem::path benchmarkOutput = "benchmark.json"; // --benchmark-output <file>: "-" writes the report to stdout.
+	std::filesystem::path traceOutput;	 // --trace <file>: write a Chrome trace of every frame (needs GS_ENABLE_PROFILER).
+};
+
 class App
 {
 public:
-	App() = default;
+	explicit App(const AppOptions& options = {}) : m_options(options) {}
 	~App() = default;
 
 	void Run();
@@ -17,11 +31,27 @@ public:
 private:
 	void Init();
 
+	void SubmitScene();
+	/* A grid of meshes, with instancing disabled, so recording has one draw per instance to chew through. */
+	void SubmitBenchmarkScene();
+	void UpdateRecordScalingBenchmark();
+
 private:
+	AppOptions m_options;
 	bool m_isRunning = false;
-	Window m_window;
+	std::unique_ptr<VkMana::WSI> m_window; // Window, or HeadlessWindow
 	std::unique_ptr<Renderer> m_renderer;
+	std::unique_ptr<FrameBenchmark> m_benchmark;
+
+	std::shared_ptr<Mesh> m_backpackMesh;
+	std::shared_ptr<Mesh> m_runestoneMesh;
 
-	std::unique_ptr<Mesh> m_backpackMesh;
-	std::unique_ptr<Mesh> m_runestoneMesh;
+	struct RecordScalingBenchmark
+	{
+		uint32_t threadCount = 1;
+		uint32_t maxThreadCount = 1;
+		uint32_t frame = 0;
+		double recordTimeMs = 0.0;
+		double baselineTimeMs = 0.0; // Single thread
+	} m_recordScaling;
 };
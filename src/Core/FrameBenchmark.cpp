@@ -0,0 +1,135 @@
+#include "FrameBenchmark.hpp"
+
+#include "Logging.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+
+namespace
+{
+	auto SummaryToJson(const FrameTimeSummary& summary) -> std::string
+	{
+		if (summary.samples == 0)
+			return "null";
+
+		return fmt::format(R"({{ "samples": {}, "mean": {:.4f}, "min": {:.4f}, "p50": {:.4f}, "p95": {:.4f}, "p99": {:.4f}, "max": {:.4f} }})",
+			summary.samples,
+			summary.mean,
+			summary.min,
+			summary.p50,
+			summary.p95,
+			summary.p99,
+			summary.max);
+	}
+} // namespace
+
+FrameBenchmark::FrameBenchmark(uint32_t warmupFrames, uint32_t measureFrames) : m_warmupFrames(warmupFrames), m_measureFrames(measureFrames)
+{
+	m_cpuTimesMs.reserve(measureFrames);
+	m_gpuTimesMs.reserve(measureFrames);
+	m_buildTimesMs.reserve(measureFrames);
+	m_renderThreadTimesMs.reserve(measureFrames);
+	m_handoffWaitTimesMs.reserve(measureFrames);
+}
+
+bool FrameBenchmark::AddFrame(const FrameTimes& times)
+{
+	if (IsComplete())
+		return true;
+
+	++m_frame;
+	if (m_frame <= m_warmupFrames)
+		return false;
+
+	m_cpuTimesMs.push_back(times.cpuMs);
+	if (times.gpuMs >= 0.0)
+		m_gpuTimesMs.push_back(times.gpuMs);
+	m_buildTimesMs.push_back(times.buildMs);
+	m_renderThreadTimesMs.push_back(times.renderThreadMs);
+	m_handoffWaitTimesMs.push_back(times.handoffWaitMs);
+	return IsComplete();
+}
+
+auto FrameBenchmark::GetOverlap() const -> double
+{
+	const auto cpuTimeMs = std::accumulate(m_cpuTimesMs.begin(), m_cpuTimesMs.end(), 0.0);
+	if (cpuTimeMs <= 0.0)
+		return 0.0;
+
+	const auto buildTimeMs = std::accumulate(m_buildTimesMs.begin(), m_buildTimesMs.end(), 0.0);
+	const auto renderThreadTimeMs = std::accumulate(m_renderThreadTimesMs.begin(), m_renderThreadTimesMs.end(), 0.0);
+	return (buildTimeMs + renderThreadTimeMs) / cpuTimeMs;
+}
+
+auto FrameBenchmark::ToJson(const std::string& label) const -> std::string
+{
+	return fmt::format("{{\n"
+					   "\t\"label\": \"{}\",\n"
+					   "\t\"warmupFrames\": {},\n"
+					   "\t\"frames\": {},\n"
+					   "\t\"cpuFrameTimeMs\": {},\n"
+					   "\t\"gpuFrameTimeMs\": {},\n"
+					   "\t\"buildTimeMs\": {},\n"
+					   "\t\"renderThreadTimeMs\": {},\n"
+					   "\t\"handoffWaitMs\": {},\n"
+					   "\t\"overlap\": {:.3f}\n"
+					   "}}\n",
+		label,
+		m_warmupFrames,
+		m_cpuTimesMs.size(),
+		SummaryToJson(GetCpuSummary()),
+		SummaryToJson(GetGpuSummary()),
+		SummaryToJson(Summarize(m_buildTimesMs)),
+		SummaryToJson(Summarize(m_renderThreadTimesMs)),
+		SummaryToJson(Summarize(m_handoffWaitTimesMs)),
+		GetOverlap());
+}
+
+bool FrameBenchmark::WriteReport(const std::filesystem::path& filename, const std::string& label) const
+{
+	const auto json = ToJson(label);
+	if (filename.empty())
+	{
+		// Not through the logger, the report must stay machine-readable. Pending log lines go out first.
+		Logger::Get().Flush();
+		std::fwrite(json.data(), 1, json.size(), stdout);
+		std::fflush(stdout);
+		return true;
+	}
+
+	std::ofstream file(filename, std::ios::trunc);
+	if (!file)
+	{
+		LOG_ERR("Failed to open benchmark report file: {}", filename.string());
+		return false;
+	}
+	file << json;
+	LOG_INFO("Benchmark report written to {}", filename.string());
+	return bool(file);
+}
+
+auto FrameBenchmark::Summarize(std::vector<double> samples) -> FrameTimeSummary
+{
+	FrameTimeSummary summary{};
+	if (samples.empty())
+		return summary;
+
+	std::sort(samples.begin(), samples.end());
+	const auto percentile = [&samples](double p)
+	{
+		const auto rank = size_t(std::ceil(p / 100.0 * double(samples.size())));
+		return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+	};
+
+	summary.samples = uint32_t(samples.size());
+	summary.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / double(samples.size());
+	summary.min = samples.front();
+	summary.p50 = percentile(50.0);
+	summary.p95 = percentile(95.0);
+	summary.p99 = percentile(99.0);
+	summary.max = samples.back();
+	return summary;
+}
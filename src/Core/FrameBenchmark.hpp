@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+struct FrameTimeSummary
+{
+	uint32_t samples = 0;
+	double mean = 0.0;
+	double min = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+/**
+ * Times of one frame, in milliseconds.
+ */
+struct FrameTimes
+{
+	double cpuMs = 0.0;			 // Main thread, whole frame
+	double gpuMs = -1.0;		 // Negative if unavailable
+	double buildMs = 0.0;		 // Main thread, building the frame (RenderStats::buildTimeMs)
+	double renderThreadMs = 0.0; // Recording and submitting it (RenderStats::renderThreadTimeMs)
+	double handoffWaitMs = 0.0;	 // Main thread, waiting for the render thread (RenderStats::handoffWaitMs)
+};
+
+/**
+ * Collects per-frame CPU and GPU times over a fixed number of frames (after a warmup) and reports their percentiles as JSON.
+ */
+class FrameBenchmark
+{
+public:
+	FrameBenchmark(uint32_t warmupFrames, uint32_t measureFrames);
+	~FrameBenchmark() = default;
+
+	/**
+	 * Records one frame. Returns true once every frame has been measured.
+	 */
+	bool AddFrame(const FrameTimes& times);
+
+	auto ToJson(const std::string& label) const -> std::string;
+	/**
+	 * Writes the JSON report to `filename`, or to stdout when it is empty.
+	 */
+	bool WriteReport(const std::filesystem::path& filename, const std::string& label) const;
+
+	//////////////////////////////////////////////////
+	/// Getters
+	//////////////////////////////////////////////////
+
+	bool IsComplete() const { return m_cpuTimesMs.size() >= m_measureFrames; }
+	auto GetCpuSummary() const -> FrameTimeSummary { return Summarize(m_cpuTimesMs); }
+	auto GetGpuSummary() const -> FrameTimeSummary { return Summarize(m_gpuTimesMs); }
+	/**
+	 * Main thread build time plus render thread time, over the frame time. Above 1 when the two threads overlapped.
+	 */
+	auto GetOverlap() const -> double;
+
+private:
+	/* Nearest-rank percentiles. */
+	static auto Summarize(std::vector<double> samples) -> FrameTimeSummary;
+
+private:
+	uint32_t m_warmupFrames = 0;
+	uint32_t m_measureFrames = 0;
+	uint32_t m_frame = 0;
+	std::vector<double> m_cpuTimesMs;
+	std::vector<double> m_gpuTimesMs;
+	std::vector<double> m_buildTimesMs;
+	std::vector<double> m_renderThreadTimesMs;
+	std::vector<double> m_handoffWaitTimesMs;
+};
@@ -0,0 +1,12 @@
+#include "Hash.hpp"
+
+#include "MappedFile.hpp"
+
+auto HashFile(const std::filesystem::path& filename) -> std::optional<uint64_t>
+{
+	MappedFile file;
+	if (!file.Open(filename))
+		return std::nullopt;
+
+	return HashBytes(file.GetData(), file.GetSize());
+}
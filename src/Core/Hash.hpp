@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+
+constexpr uint64_t HASH_FNV1A_OFFSET = 0xcbf29ce484222325ull;
+constexpr uint64_t HASH_FNV1A_PRIME = 0x100000001b3ull;
+
+/**
+ * 64-bit FNV-1a. Not cryptographic, only used to detect changed content (cache keys, asset dedup).
+ */
+inline auto HashBytes(const void* data, size_t size, uint64_t seed = HASH_FNV1A_OFFSET) -> uint64_t
+{
+	const auto* bytes = static_cast<const uint8_t*>(data);
+	auto hash = seed;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= HASH_FNV1A_PRIME;
+	}
+	return hash;
+}
+
+inline auto HashString(std::string_view str, uint64_t seed = HASH_FNV1A_OFFSET) -> uint64_t
+{
+	return HashBytes(str.data(), str.size(), seed);
+}
+
+template <typename T>
+inline auto HashCombine(uint64_t seed, const T& value) -> uint64_t
+{
+	static_assert(std::is_trivially_copyable_v<T>, "HashCombine() requires a trivially copyable type.");
+	return HashBytes(&value, sizeof(T), seed);
+}
+
+/**
+ * Hashes the entire contents of a file. Returns std::nullopt if the file could not be read.
+ */
+auto HashFile(const std::filesystem::path& filename) -> std::optional<uint64_t>;
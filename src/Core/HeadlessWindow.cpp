@@ -0,0 +1,51 @@
+#include "HeadlessWindow.hpp"
+
+#include "Logging.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+bool HeadlessWindow::Init(uint32_t width, uint32_t height)
+{
+	uint32_t extensionCount = 0;
+	auto result = vk::enumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+	std::vector<vk::ExtensionProperties> extensions(extensionCount);
+	if (result == vk::Result::eSuccess)
+		result = vk::enumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+	const auto hasHeadlessSurface = std::any_of(extensions.begin(), extensions.end(), [](const vk::ExtensionProperties& extension) {
+		return std::strcmp(extension.extensionName, VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME) == 0;
+	});
+	if (result != vk::Result::eSuccess || !hasHeadlessSurface)
+	{
+		LOG_ERR("{} is not available, headless mode needs an ICD that supports it (eg. lavapipe)", VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_isAlive = true;
+	return true;
+}
+
+auto HeadlessWindow::CreateSurface(vk::Instance instance) -> vk::SurfaceKHR
+{
+	// Available is not enabled: the loader only hands out the entry point if the context enabled the extension on this instance.
+	const auto createHeadlessSurface =
+		reinterpret_cast<PFN_vkCreateHeadlessSurfaceEXT>(instance.getProcAddr("vkCreateHeadlessSurfaceEXT"));
+	if (!createHeadlessSurface)
+	{
+		LOG_ERR("{} is not enabled on the Vulkan instance, cannot create a headless surface", VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+		return nullptr;
+	}
+
+	const VkHeadlessSurfaceCreateInfoEXT surfaceInfo{ VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT };
+	VkSurfaceKHR surface = VK_NULL_HANDLE;
+	const auto result = vk::Result(createHeadlessSurface(instance, &surfaceInfo, nullptr, &surface));
+	if (result != vk::Result::eSuccess)
+	{
+		LOG_ERR("Failed to create headless surface ({})", vk::to_string(result));
+		return nullptr;
+	}
+	return surface;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <VkMana/WSI.hpp>
+
+#include <cstdint>
+
+/**
+ * WSI without a display. The surface comes from VK_EXT_headless_surface, so the swapchain images are plain offscreen images and
+ * presenting only hands them back. Runs anywhere the ICD supports the extension, including software ICDs (eg. lavapipe).
+ * Init() fails if the extension is not available. WSI cannot request instance extensions, so CreateSurface() also fails (rather
+ * than calling into an extension that is not enabled) if the context did not enable it.
+ */
+class HeadlessWindow : public VkMana::WSI
+{
+public:
+	HeadlessWindow() = default;
+	~HeadlessWindow() override = default;
+
+	bool Init(uint32_t width, uint32_t height);
+	void Close() { m_isAlive = false; }
+
+	void PollEvents() override {}
+
+	auto CreateSurface(vk::Instance instance) -> vk::SurfaceKHR override;
+
+	auto GetSurfaceWidth() -> uint32_t override { return m_width; }
+	auto GetSurfaceHeight() -> uint32_t override { return m_height; }
+
+	bool IsVSync() override { return false; }
+	bool IsAlive() override { return m_isAlive; }
+
+	void HideCursor() override {}
+	void ShowCursor() override {}
+
+	auto CreateCursor(uint32_t /*cursorType*/) -> void* override { return nullptr; }
+	void SetCursor(void* /*cursor*/) override {}
+
+private:
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	bool m_isAlive = false;
+};
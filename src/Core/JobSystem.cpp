@@ -0,0 +1,342 @@
+#include "JobSystem.hpp"
+
+#include "Profiler.hpp"
+
+#include <string>
+
+constexpr uint32_t JOB_SYSTEM_SPIN_COUNT = 64; // Failed searches before an idle worker goes to sleep.
+
+namespace
+{
+	// The worker (and its system) running on this thread, if any. Several systems can exist, eg. in benchmarks.
+	thread_local const JobSystem* t_jobSystem = nullptr;
+	thread_local uint32_t t_workerIndex = 0;
+	thread_local uint32_t t_backgroundDepth = 0; // Background jobs being run by this thread (nested through Wait())
+} // namespace
+
+JobCounter::~JobCounter()
+{
+	// The last Signal() decrements under the lock, wait for it to be out of it before the memory goes.
+	std::lock_guard lock(m_mutex);
+}
+
+JobSystem::WorkerQueue::WorkerQueue() : m_jobs(std::make_unique<std::atomic<Job*>[]>(WORKER_QUEUE_CAPACITY)) {}
+
+bool JobSystem::WorkerQueue::Push(Job* job)
+{
+	const auto bottom = m_bottom.load(std::memory_order_relaxed);
+	const auto top = m_top.load(std::memory_order_acquire);
+	if (bottom - top >= int64_t(WORKER_QUEUE_CAPACITY))
+		return false;
+
+	m_jobs[bottom & (WORKER_QUEUE_CAPACITY - 1)].store(job, std::memory_order_relaxed);
+	// Sequentially consistent, so a worker about to sleep either sees the job or is seen by WakeWorkers().
+	m_bottom.store(bottom + 1, std::memory_order_seq_cst);
+	return true;
+}
+
+auto JobSystem::WorkerQueue::Pop() -> Job*
+{
+	const auto bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+	m_bottom.store(bottom, std::memory_order_seq_cst);
+	auto top = m_top.load(std::memory_order_seq_cst);
+	if (top > bottom)
+	{
+		// Empty
+		m_bottom.store(bottom + 1, std::memory_order_release);
+		return nullptr;
+	}
+
+	auto* job = m_jobs[bottom & (WORKER_QUEUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (top == bottom)
+	{
+		// Last job, race the thieves for it.
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			job = nullptr;
+		m_bottom.store(bottom + 1, std::memory_order_release);
+	}
+	return job;
+}
+
+auto JobSystem::WorkerQueue::Steal() -> Job*
+{
+	auto top = m_top.load(std::memory_order_seq_cst);
+	const auto bottom = m_bottom.load(std::memory_order_seq_cst);
+	if (top >= bottom)
+		return nullptr;
+
+	auto* job = m_jobs[top & (WORKER_QUEUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return nullptr; // Lost to the owner or another thief
+	return job;
+}
+
+bool JobSystem::WorkerQueue::IsEmpty() const
+{
+	return m_top.load(std::memory_order_seq_cst) >= m_bottom.load(std::memory_order_seq_cst);
+}
+
+JobSystem::JobSystem(uint32_t workerCount)
+{
+	m_workerCount = std::max(workerCount, 1u);
+	m_queues = std::make_unique<WorkerQueue[]>(m_workerCount);
+	m_workers.reserve(m_workerCount);
+	for (auto i = 0u; i < m_workerCount; ++i)
+		m_workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+	// Workers run every queued job before exiting.
+	{
+		std::lock_guard lock(m_sleepMutex);
+		m_stopping.store(true, std::memory_order_seq_cst);
+	}
+	m_sleepCondition.notify_all();
+
+	for (auto& worker : m_workers)
+		worker.join();
+}
+
+auto JobSystem::Get() -> JobSystem&
+{
+	static JobSystem jobSystem(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+	return jobSystem;
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	const auto allowBackground = IsInBackgroundJob();
+	while (!counter.IsDone())
+	{
+		if (auto* job = FindJob(allowBackground))
+			Execute(job);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::Submit(Job* job, std::initializer_list<JobCounter*> dependencies)
+{
+	if (job->counter)
+		job->counter->m_count.fetch_add(1, std::memory_order_relaxed);
+
+	// One extra count held while attaching, so the job cannot start before every dependency has seen it.
+	job->pendingDependencies.store(uint32_t(dependencies.size()) + 1, std::memory_order_relaxed);
+	for (auto* dependency : dependencies)
+	{
+		std::unique_lock lock(dependency->m_mutex);
+		if (dependency->m_count.load(std::memory_order_acquire) != 0)
+		{
+			dependency->m_continuations.push_back(job);
+			continue;
+		}
+		lock.unlock();
+		ReleaseDependency(job);
+	}
+	ReleaseDependency(job);
+}
+
+void JobSystem::ReleaseDependency(Job* job)
+{
+	if (job->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		Push(job);
+}
+
+void JobSystem::Push(Job* job)
+{
+	if (job->isBackground)
+	{
+		PushBackground(&job, 1);
+		return;
+	}
+
+	auto* queue = GetCurrentQueue();
+	if (queue && queue->Push(job))
+		WakeWorkers(1);
+	else
+		PushInjected(&job, 1);
+}
+
+void JobSystem::PushInjected(Job* const* jobs, size_t count)
+{
+	{
+		std::lock_guard lock(m_injectedMutex);
+		m_injectedJobs.insert(m_injectedJobs.end(), jobs, jobs + count);
+		m_injectedCount.fetch_add(count, std::memory_order_seq_cst);
+	}
+	WakeWorkers(count);
+}
+
+void JobSystem::PushBackground(Job* const* jobs, size_t count)
+{
+	{
+		std::lock_guard lock(m_backgroundMutex);
+		m_backgroundJobs.insert(m_backgroundJobs.end(), jobs, jobs + count);
+		m_backgroundCount.fetch_add(count, std::memory_order_seq_cst);
+	}
+	WakeWorkers(count);
+}
+
+bool JobSystem::IsInBackgroundJob()
+{
+	return t_backgroundDepth != 0;
+}
+
+auto JobSystem::FindJob(bool allowBackground) -> Job*
+{
+	// Own deque first (newest job, its data is likely still in cache), then jobs from other threads, then the oldest job of another worker.
+	auto* ownQueue = GetCurrentQueue();
+	if (ownQueue)
+	{
+		if (auto* job = ownQueue->Pop())
+			return job;
+	}
+
+	if (m_injectedCount.load(std::memory_order_acquire) != 0)
+	{
+		std::lock_guard lock(m_injectedMutex);
+		if (!m_injectedJobs.empty())
+		{
+			auto* job = m_injectedJobs.front();
+			m_injectedJobs.pop_front();
+			m_injectedCount.fetch_sub(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+
+	// Start at a different victim per thread, so thieves do not all hit the same deque.
+	const auto workerCount = GetWorkerCount();
+	const auto firstVictim = ownQueue ? t_workerIndex + 1 : uint32_t(std::hash<std::thread::id>()(std::this_thread::get_id()));
+	for (auto i = 0u; i < workerCount; ++i)
+	{
+		auto& queue = m_queues[(firstVictim + i) % workerCount];
+		if (&queue == ownQueue)
+			continue;
+		if (auto* job = queue.Steal())
+		{
+			m_stealCount.fetch_add(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+
+	// Background jobs last. In request order for idle workers, newest first for a background job waiting in Wait(): those are likely
+	// the ranges of its own ParallelFor.
+	if (allowBackground && m_backgroundCount.load(std::memory_order_acquire) != 0)
+	{
+		std::lock_guard lock(m_backgroundMutex);
+		if (!m_backgroundJobs.empty())
+		{
+			const auto newestFirst = IsInBackgroundJob();
+			auto* job = newestFirst ? m_backgroundJobs.back() : m_backgroundJobs.front();
+			if (newestFirst)
+				m_backgroundJobs.pop_back();
+			else
+				m_backgroundJobs.pop_front();
+			m_backgroundCount.fetch_sub(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+void JobSystem::Execute(Job* job)
+{
+	const auto isBackground = job->isBackground;
+	t_backgroundDepth += isBackground ? 1 : 0;
+	job->execute(*job);
+	t_backgroundDepth -= isBackground ? 1 : 0;
+
+	auto* counter = job->counter;
+	if (job->destroy)
+		job->destroy(*job);
+	if (counter)
+		Signal(*counter);
+}
+
+void JobSystem::Signal(JobCounter& counter)
+{
+	// Only the final decrement needs the lock. Once the count reads zero a waiter may destroy the counter, so that decrement happens
+	// under the lock (which ~JobCounter() takes) and nothing touches the counter after it.
+	auto count = counter.m_count.load(std::memory_order_relaxed);
+	while (count > 1)
+	{
+		if (counter.m_count.compare_exchange_weak(count, count - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+			return;
+	}
+
+	std::vector<Job*> continuations;
+	{
+		std::lock_guard lock(counter.m_mutex);
+		if (counter.m_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			continuations.swap(counter.m_continuations);
+	}
+	for (auto* job : continuations)
+		ReleaseDependency(job);
+}
+
+void JobSystem::WorkerLoop(uint32_t workerIndex)
+{
+	PROFILE_THREAD_NAME("Worker " + std::to_string(workerIndex));
+	t_jobSystem = this;
+	t_workerIndex = workerIndex;
+
+	auto idleCount = 0u;
+	while (true)
+	{
+		if (auto* job = FindJob(true))
+		{
+			Execute(job);
+			idleCount = 0;
+			continue;
+		}
+
+		if (m_stopping.load(std::memory_order_acquire) && !HasQueuedJobs())
+			return;
+
+		if (++idleCount < JOB_SYSTEM_SPIN_COUNT)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		// Sleep. Registering as a sleeper before the final check pairs with the check in WakeWorkers(), so no wake-up is lost.
+		std::unique_lock lock(m_sleepMutex);
+		m_sleepingCount.fetch_add(1, std::memory_order_seq_cst);
+		if (!HasQueuedJobs() && !m_stopping.load(std::memory_order_seq_cst))
+			m_sleepCondition.wait(lock);
+		m_sleepingCount.fetch_sub(1, std::memory_order_relaxed);
+		idleCount = 0;
+	}
+}
+
+bool JobSystem::HasQueuedJobs() const
+{
+	if (m_injectedCount.load(std::memory_order_seq_cst) != 0 || m_backgroundCount.load(std::memory_order_seq_cst) != 0)
+		return true;
+	for (auto i = 0u; i < GetWorkerCount(); ++i)
+	{
+		if (!m_queues[i].IsEmpty())
+			return true;
+	}
+	return false;
+}
+
+void JobSystem::WakeWorkers(size_t jobCount)
+{
+	const auto sleepingCount = m_sleepingCount.load(std::memory_order_seq_cst);
+	if (sleepingCount == 0)
+		return;
+
+	std::lock_guard lock(m_sleepMutex);
+	if (jobCount >= sleepingCount)
+		m_sleepCondition.notify_all();
+	else
+		for (size_t i = 0; i < jobCount; ++i)
+			m_sleepCondition.notify_one();
+}
+
+auto JobSystem::GetCurrentQueue() const -> WorkerQueue*
+{
+	return t_jobSystem == this ? &m_queues[t_workerIndex] : nullptr;
+}
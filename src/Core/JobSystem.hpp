@@ -0,0 +1,287 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class JobCounter;
+
+/**
+ * A unit of work. Run() allocates its jobs and the system frees them once they have run, ParallelFor() keeps them on its stack.
+ */
+struct Job
+{
+	void (*execute)(Job& job) = nullptr;
+	void (*destroy)(Job& job) = nullptr; // Null if the job is not owned by the system
+	void* context = nullptr;			 // ParallelFor's callable
+	size_t begin = 0;					 // ParallelFor's range
+	size_t end = 0;
+	JobCounter* counter = nullptr; // Signalled once the job has run
+	std::atomic<uint32_t> pendingDependencies = 0;
+	bool isBackground = false; // See JobSystem::EnqueueBackground()
+};
+
+/**
+ * Counts unfinished jobs. Jobs started with a counter increment it and decrement it once they have run. Wait on it with
+ * JobSystem::Wait(), or pass it as a dependency to start other jobs once it reaches zero.
+ * A counter may be reused once it has reached zero.
+ */
+class JobCounter
+{
+public:
+	JobCounter() = default;
+	~JobCounter();
+
+	JobCounter(const JobCounter&) = delete;
+	auto operator=(const JobCounter&) -> JobCounter& = delete;
+
+	bool IsDone() const { return m_count.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> m_count = 0;
+	std::mutex m_mutex;				  // Guards `m_continuations`, and the final decrement
+	std::vector<Job*> m_continuations; // Jobs depending on this counter
+};
+
+/**
+ * Work-stealing job scheduler.
+ *
+ * Each worker owns a deque: jobs started on a worker are pushed to its own deque and popped LIFO (cache-warm), idle workers steal
+ * FIFO from the others. Jobs started on other threads (main thread, render thread) go through a shared injection queue.
+ * Waiting on a counter runs queued jobs in the meantime, so the waiting thread participates instead of blocking.
+ *
+ * Background jobs (eg. asset imports) have a queue of their own. Only idle workers pick them up, and Wait() only runs them from inside
+ * another background job, so a frame-critical wait never ends up running a long import. Jobs started by a background job are
+ * background jobs too.
+ *
+ * Jobs must not block on other jobs except through Wait(), use dependencies instead.
+ */
+class JobSystem
+{
+public:
+	explicit JobSystem(uint32_t workerCount);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	auto operator=(const JobSystem&) -> JobSystem& = delete;
+
+	/**
+	 * Process-wide system with one worker per hardware thread, minus the main thread.
+	 */
+	static auto Get() -> JobSystem&;
+
+	/**
+	 * Starts `fn` once every counter in `dependencies` has reached zero. `counter` (optional) is incremented now and decremented
+	 * once `fn` has run.
+	 */
+	template <typename Fn>
+	void Run(Fn&& fn, JobCounter* counter = nullptr, std::initializer_list<JobCounter*> dependencies = {});
+	/**
+	 * Run() for jobs producing a result. Waiting on the future blocks without running other jobs, wait on `counter` to participate.
+	 */
+	template <typename Fn>
+	auto Enqueue(Fn&& fn, JobCounter* counter = nullptr, std::initializer_list<JobCounter*> dependencies = {})
+		-> std::future<std::invoke_result_t<Fn>>;
+	/**
+	 * Enqueue() at background priority. Waiting on `counter` outside a background job does not help with the job, it only blocks.
+	 */
+	template <typename Fn>
+	auto EnqueueBackground(Fn&& fn, JobCounter* counter = nullptr) -> std::future<std::invoke_result_t<Fn>>;
+
+	/**
+	 * Calls `fn(rangeBegin, rangeEnd)` over [begin, end) split into ranges of at least `grainSize` items, and returns once every range
+	 * is done. The calling thread runs the first range.
+	 */
+	template <typename Fn>
+	void ParallelFor(size_t begin, size_t end, size_t grainSize, Fn&& fn);
+
+	/**
+	 * Runs queued jobs until `counter` reaches zero. Background jobs are only run if the caller is one.
+	 */
+	void Wait(JobCounter& counter);
+
+	//////////////////////////////////////////////////
+	/// Getters
+	//////////////////////////////////////////////////
+
+	auto GetWorkerCount() const -> uint32_t { return m_workerCount; }
+	/**
+	 * Jobs run by stealing from another worker's deque, since the system was created.
+	 */
+	auto GetStealCount() const -> uint64_t { return m_stealCount.load(std::memory_order_relaxed); }
+
+private:
+	static constexpr uint32_t WORKER_QUEUE_CAPACITY = 4096; // Power of two. Jobs overflow to the injection queue.
+
+	/* Chase-Lev deque. The owning worker pushes and pops at the bottom, any thread steals from the top. */
+	class WorkerQueue
+	{
+	public:
+		WorkerQueue();
+
+		bool Push(Job* job);
+		auto Pop() -> Job*;
+		auto Steal() -> Job*;
+		bool IsEmpty() const;
+
+	private:
+		alignas(64) std::atomic<int64_t> m_top = 0;
+		alignas(64) std::atomic<int64_t> m_bottom = 0;
+		std::unique_ptr<std::atomic<Job*>[]> m_jobs;
+	};
+
+	template <typename Fn>
+	auto MakeJob(Fn&& fn, JobCounter* counter) -> Job*;
+	void Submit(Job* job, std::initializer_list<JobCounter*> dependencies);
+	void Push(Job* job);
+	void PushInjected(Job* const* jobs, size_t count);
+	void PushBackground(Job* const* jobs, size_t count);
+	/* Jobs started from here on are background jobs. */
+	static bool IsInBackgroundJob();
+	auto FindJob(bool allowBackground) -> Job*;
+	void Execute(Job* job);
+	void Signal(JobCounter& counter);
+	void ReleaseDependency(Job* job);
+
+	void WorkerLoop(uint32_t workerIndex);
+	bool HasQueuedJobs() const;
+	void WakeWorkers(size_t jobCount);
+	auto GetCurrentQueue() const -> WorkerQueue*;
+
+	template <typename Fn>
+	struct CallableJob : Job
+	{
+		explicit CallableJob(Fn&& callable) : fn(std::forward<Fn>(callable)) {}
+		std::decay_t<Fn> fn;
+	};
+
+private:
+	uint32_t m_workerCount = 0; // Not m_workers.size(), workers read it while the constructor is still starting them
+	std::unique_ptr<WorkerQueue[]> m_queues;
+	std::vector<std::thread> m_workers;
+
+	std::mutex m_injectedMutex;
+	std::deque<Job*> m_injectedJobs;
+	std::atomic<size_t> m_injectedCount = 0; // Read without the lock, to skip it when empty
+
+	std::mutex m_backgroundMutex;
+	std::deque<Job*> m_backgroundJobs;
+	std::atomic<size_t> m_backgroundCount = 0;
+
+	std::mutex m_sleepMutex;
+	std::condition_variable m_sleepCondition;
+	std::atomic<uint32_t> m_sleepingCount = 0;
+	std::atomic<bool> m_stopping = false;
+
+	std::atomic<uint64_t> m_stealCount = 0;
+};
+
+template <typename Fn>
+auto JobSystem::MakeJob(Fn&& fn, JobCounter* counter) -> Job*
+{
+	auto* job = new CallableJob<Fn>(std::forward<Fn>(fn));
+	job->execute = [](Job& self) { static_cast<CallableJob<Fn>&>(self).fn(); };
+	job->destroy = [](Job& self) { delete &static_cast<CallableJob<Fn>&>(self); };
+	job->counter = counter;
+	job->isBackground = IsInBackgroundJob();
+	return job;
+}
+
+template <typename Fn>
+void JobSystem::Run(Fn&& fn, JobCounter* counter, std::initializer_list<JobCounter*> dependencies)
+{
+	Submit(MakeJob(std::forward<Fn>(fn), counter), dependencies);
+}
+
+template <typename Fn>
+auto JobSystem::Enqueue(Fn&& fn, JobCounter* counter, std::initializer_list<JobCounter*> dependencies)
+	-> std::future<std::invoke_result_t<Fn>>
+{
+	std::packaged_task<std::invoke_result_t<Fn>()> task(std::forward<Fn>(fn));
+	auto future = task.get_future();
+	Run([task = std::move(task)]() mutable { task(); }, counter, dependencies);
+	return future;
+}
+
+template <typename Fn>
+auto JobSystem::EnqueueBackground(Fn&& fn, JobCounter* counter) -> std::future<std::invoke_result_t<Fn>>
+{
+	std::packaged_task<std::invoke_result_t<Fn>()> task(std::forward<Fn>(fn));
+	auto future = task.get_future();
+	auto* job = MakeJob([task = std::move(task)]() mutable { task(); }, counter);
+	job->isBackground = true;
+	Submit(job, {});
+	return future;
+}
+
+template <typename Fn>
+void JobSystem::ParallelFor(size_t begin, size_t end, size_t grainSize, Fn&& fn)
+{
+	constexpr size_t RANGES_PER_THREAD = 4; // More ranges than threads, so stealing can even out uneven ranges.
+
+	if (begin >= end)
+		return;
+
+	const auto count = end - begin;
+	const auto maxRangeCount = (count + std::max<size_t>(grainSize, 1) - 1) / std::max<size_t>(grainSize, 1);
+	const auto rangeCount = std::min<size_t>(maxRangeCount, size_t(GetWorkerCount() + 1) * RANGES_PER_THREAD);
+	if (rangeCount <= 1)
+	{
+		fn(begin, end);
+		return;
+	}
+
+	using Callable = std::remove_reference_t<Fn>;
+	JobCounter counter;
+	counter.m_count.store(uint32_t(rangeCount - 1), std::memory_order_relaxed);
+
+	// Range 0 runs on this thread, the others are queued.
+	const auto isBackground = IsInBackgroundJob();
+	auto jobs = std::make_unique<Job[]>(rangeCount - 1);
+	std::vector<Job*> jobPtrs(rangeCount - 1);
+	for (size_t i = 1; i < rangeCount; ++i)
+	{
+		auto& job = jobs[i - 1];
+		job.execute = [](Job& self) { (*static_cast<Callable*>(self.context))(self.begin, self.end); };
+		job.context = const_cast<void*>(static_cast<const void*>(&fn));
+		job.begin = begin + count * i / rangeCount;
+		job.end = begin + count * (i + 1) / rangeCount;
+		job.counter = &counter;
+		job.isBackground = isBackground;
+		jobPtrs[i - 1] = &job;
+	}
+
+	if (isBackground)
+	{
+		PushBackground(jobPtrs.data(), jobPtrs.size());
+	}
+	else if (auto* queue = GetCurrentQueue())
+	{
+		// Reverse, so the owner pops the ranges next to its own first and thieves take the far ones.
+		for (auto i = jobPtrs.size(); i-- > 0;)
+		{
+			if (!queue->Push(jobPtrs[i]))
+				PushInjected(&jobPtrs[i], 1);
+		}
+		WakeWorkers(jobPtrs.size());
+	}
+	else
+	{
+		PushInjected(jobPtrs.data(), jobPtrs.size());
+	}
+
+	fn(begin, begin + count / rangeCount);
+	Wait(counter);
+}
@@ -0,0 +1,178 @@
+#include "Logger.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+	constexpr auto LOGGER_IDLE_SLEEP = std::chrono::milliseconds(1); // Polled while the queue is empty
+	constexpr uint32_t LOGGER_BATCH_SIZE = 256;						  // Messages written between stream flushes
+
+	auto GetLevelPrefix(LogLevel level) -> std::string_view
+	{
+		switch (level)
+		{
+			case LogLevel::Info:
+				return "[INFO] ";
+			case LogLevel::Warn:
+				return "[WARN] ";
+			case LogLevel::Error:
+				return "[ERROR] ";
+		}
+		return "";
+	}
+
+	/* Errors go to stderr, as before. */
+	auto GetLevelStream(LogLevel level) -> std::FILE*
+	{
+		return level == LogLevel::Error ? stderr : stdout;
+	}
+} // namespace
+
+auto Logger::Get() -> Logger&
+{
+	static Logger* logger = new Logger();
+	return *logger;
+}
+
+Logger::Logger() : m_slots(std::make_unique<Slot[]>(QUEUE_CAPACITY))
+{
+	for (auto i = 0u; i < QUEUE_CAPACITY; ++i)
+		m_slots[i].sequence.store(i, std::memory_order_relaxed);
+
+	m_thread = std::thread(&Logger::WorkerLoop, this);
+	std::atexit(&Logger::Shutdown);
+}
+
+void Logger::Shutdown()
+{
+	auto& logger = Get();
+	logger.Flush();
+	logger.m_isSynchronous.store(true, std::memory_order_relaxed);
+	logger.m_stopping.store(true, std::memory_order_relaxed);
+	logger.m_thread.join();
+}
+
+void Logger::Flush()
+{
+	if (m_isSynchronous.load(std::memory_order_relaxed))
+		return;
+
+	const auto target = m_enqueuePos.load(std::memory_order_acquire);
+	while (m_writtenPos.load(std::memory_order_acquire) < target)
+		std::this_thread::yield();
+}
+
+auto Logger::BeginWrite() -> Slot*
+{
+	auto pos = m_enqueuePos.load(std::memory_order_relaxed);
+	while (true)
+	{
+		auto& slot = m_slots[pos & (QUEUE_CAPACITY - 1)];
+		const auto sequence = slot.sequence.load(std::memory_order_acquire);
+		const auto diff = int64_t(sequence) - int64_t(pos);
+		if (diff == 0)
+		{
+			if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				return &slot;
+		}
+		else if (diff < 0)
+		{
+			// Full, the consumer has not released this slot yet.
+			if (m_overflowPolicy.load(std::memory_order_relaxed) == LogOverflowPolicy::Drop)
+			{
+				m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+				return nullptr;
+			}
+			std::this_thread::yield();
+			pos = m_enqueuePos.load(std::memory_order_relaxed);
+		}
+		else
+		{
+			pos = m_enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+void Logger::EndWrite(Slot& slot)
+{
+	const auto pos = slot.sequence.load(std::memory_order_relaxed);
+	slot.sequence.store(pos + 1, std::memory_order_release);
+}
+
+void Logger::WriteSynchronous(const Message& message)
+{
+	fmt::memory_buffer buffer;
+	WriteMessage(message, buffer);
+
+	std::lock_guard lock(m_syncMutex);
+	auto* stream = GetLevelStream(message.level);
+	std::fwrite(buffer.data(), 1, buffer.size(), stream);
+	std::fflush(stream);
+}
+
+void Logger::WorkerLoop()
+{
+	fmt::memory_buffer buffer;
+	uint64_t reportedDrops = 0;
+
+	while (true)
+	{
+		/* Write a batch, then flush the streams before publishing the written position, so Flush() can rely on it. */
+		auto pos = m_dequeuePos.load(std::memory_order_relaxed);
+		std::FILE* lastStream = nullptr;
+		for (auto i = 0u; i < LOGGER_BATCH_SIZE; ++i, ++pos)
+		{
+			auto& slot = m_slots[pos & (QUEUE_CAPACITY - 1)];
+			if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+				break; // Empty
+
+			buffer.clear();
+			WriteMessage(slot.message, buffer);
+
+			// Keep the order between stdout and stderr.
+			auto* stream = GetLevelStream(slot.message.level);
+			if (lastStream && lastStream != stream)
+				std::fflush(lastStream);
+			std::fwrite(buffer.data(), 1, buffer.size(), stream);
+			lastStream = stream;
+
+			slot.sequence.store(pos + QUEUE_CAPACITY, std::memory_order_release);
+		}
+		if (lastStream)
+			std::fflush(lastStream);
+
+		const auto isIdle = pos == m_dequeuePos.load(std::memory_order_relaxed);
+		m_dequeuePos.store(pos, std::memory_order_relaxed);
+		m_writtenPos.store(pos, std::memory_order_release);
+
+		const auto droppedCount = m_droppedCount.load(std::memory_order_relaxed);
+		if (droppedCount != reportedDrops)
+		{
+			fmt::print(stdout, "[WARN] Logger queue overflowed, {} messages dropped\n", droppedCount - reportedDrops);
+			std::fflush(stdout);
+			reportedDrops = droppedCount;
+		}
+
+		if (isIdle)
+		{
+			if (m_stopping.load(std::memory_order_relaxed))
+				return;
+			std::this_thread::sleep_for(LOGGER_IDLE_SLEEP);
+		}
+	}
+}
+
+void Logger::WriteMessage(const Message& message, fmt::memory_buffer& buffer)
+{
+	const auto prefix = GetLevelPrefix(message.level);
+	buffer.append(prefix.data(), prefix.data() + prefix.size());
+	if (message.spilled)
+		buffer.append(message.spilled->data(), message.spilled->data() + message.spilled->size());
+	else if (message.format)
+		message.format(message, buffer);
+	else
+		buffer.append(reinterpret_cast<const char*>(message.payload), reinterpret_cast<const char*>(message.payload) + message.payloadSize);
+	buffer.push_back('\n');
+}
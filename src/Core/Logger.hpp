@@ -0,0 +1,244 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+enum class LogLevel : uint8_t
+{
+	Info,
+	Warn,
+	Error,
+};
+
+enum class LogOverflowPolicy : uint8_t
+{
+	Drop,  // A full queue drops the message (counted, and reported once the queue drains). Logging never waits.
+	Block, // A full queue makes the caller wait for space.
+};
+
+/**
+ * Asynchronous logger. Use through the LOG_* macros in Logging.hpp.
+ *
+ * Callers only copy the format string pointer and the arguments into a slot of a bounded lock-free multi-producer queue. Formatting
+ * and writing happen on the logger's thread. Arguments that cannot be copied as plain values/strings, and messages too large for a
+ * slot, are formatted on the calling thread instead (the write is still deferred).
+ *
+ * After exit begins, the logger turns synchronous, so messages from static destructors are not lost.
+ */
+class Logger
+{
+public:
+	static auto Get() -> Logger&;
+
+	template <typename... Args>
+	void Log(LogLevel level, fmt::format_string<Args...> format, Args&&... args);
+
+	/**
+	 * Blocks until every message logged before the call has been written.
+	 */
+	void Flush();
+
+	void SetOverflowPolicy(LogOverflowPolicy policy) { m_overflowPolicy.store(policy, std::memory_order_relaxed); }
+
+	//////////////////////////////////////////////////
+	/// Getters
+	//////////////////////////////////////////////////
+
+	auto GetDroppedCount() const -> uint64_t { return m_droppedCount.load(std::memory_order_relaxed); }
+
+private:
+	static constexpr uint32_t QUEUE_CAPACITY = 4096; // Power of two
+	static constexpr uint32_t MESSAGE_PAYLOAD_SIZE = 232;
+
+	struct Message;
+	using FormatFn = void (*)(const Message& message, fmt::memory_buffer& out);
+
+	struct Message
+	{
+		LogLevel level = LogLevel::Info;
+		FormatFn format = nullptr;	  // Formats the encoded arguments. Null if `payload` already holds the text.
+		std::string_view formatString; // Points at the caller's literal
+		uint32_t payloadSize = 0;
+		std::unique_ptr<std::string> spilled; // Pre-formatted text that did not fit the payload
+		uint8_t payload[MESSAGE_PAYLOAD_SIZE];
+	};
+
+	/* Slot of a bounded MPMC queue (Vyukov). `sequence` tells producers/the consumer whose turn it is. */
+	struct Slot
+	{
+		std::atomic<uint64_t> sequence = 0;
+		Message message;
+	};
+
+	Logger();
+	~Logger() = delete; // Never destroyed, so it outlives every static that logs. Shutdown() runs at exit.
+
+	static void Shutdown();
+
+	/* Claims a slot, or returns null when the queue is full and the policy is to drop. */
+	auto BeginWrite() -> Slot*;
+	void EndWrite(Slot& slot);
+	void WriteSynchronous(const Message& message);
+
+	void WorkerLoop();
+	static void WriteMessage(const Message& message, fmt::memory_buffer& buffer);
+
+	/* Values and strings are copied into the payload. Anything else is formatted by the caller. */
+	template <typename T>
+	static constexpr bool IsStringArg = std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view> || std::is_same_v<T, const char*>
+		|| std::is_same_v<T, char*>;
+	template <typename T>
+	static constexpr bool IsDeferrableArg = IsStringArg<std::decay_t<T>> || std::is_arithmetic_v<std::decay_t<T>>;
+
+	template <typename T>
+	using StoredArg = std::conditional_t<IsStringArg<std::decay_t<T>>, std::string_view, std::decay_t<T>>;
+
+	/* Only pointers are null-checked. Arrays (eg. literals) never decay here, their address is never null. */
+	template <typename T>
+	static auto ToStringView(const T& arg) -> std::string_view;
+	template <typename T>
+	static auto GetEncodedSize(const T& arg) -> size_t;
+	template <typename T>
+	static void Encode(uint8_t*& dst, const T& arg);
+	template <typename T>
+	static auto Decode(const uint8_t*& src) -> T;
+	template <typename... Stored>
+	static void FormatEncoded(const Message& message, fmt::memory_buffer& out);
+
+private:
+	std::unique_ptr<Slot[]> m_slots;
+	alignas(64) std::atomic<uint64_t> m_enqueuePos = 0;
+	alignas(64) std::atomic<uint64_t> m_dequeuePos = 0;
+	alignas(64) std::atomic<uint64_t> m_writtenPos = 0; // Messages before this have been written and flushed
+
+	std::atomic<LogOverflowPolicy> m_overflowPolicy = LogOverflowPolicy::Drop;
+	std::atomic<uint64_t> m_droppedCount = 0;
+
+	std::atomic<bool> m_isSynchronous = false;
+	std::atomic<bool> m_stopping = false;
+	std::mutex m_syncMutex; // Serialises writes once synchronous
+	std::thread m_thread;
+};
+
+template <typename... Args>
+void Logger::Log(LogLevel level, fmt::format_string<Args...> format, Args&&... args)
+{
+	if (m_isSynchronous.load(std::memory_order_relaxed))
+	{
+		Message message{};
+		message.level = level;
+		message.spilled = std::make_unique<std::string>(fmt::format(format, args...));
+		WriteSynchronous(message);
+		return;
+	}
+
+	auto* slot = BeginWrite();
+	if (!slot)
+		return;
+
+	auto& message = slot->message;
+	message.level = level;
+	message.spilled.reset();
+
+	constexpr auto isDeferrable = (IsDeferrableArg<Args> && ...);
+	if constexpr (isDeferrable)
+	{
+		const auto encodedSize = (size_t(0) + ... + GetEncodedSize(args));
+		if (encodedSize <= MESSAGE_PAYLOAD_SIZE)
+		{
+			auto* dst = message.payload;
+			(Encode(dst, args), ...);
+			message.format = &FormatEncoded<StoredArg<Args>...>;
+			const fmt::string_view formatView = format;
+			message.formatString = std::string_view(formatView.data(), formatView.size());
+			message.payloadSize = uint32_t(encodedSize);
+			EndWrite(*slot);
+			return;
+		}
+	}
+
+	message.format = nullptr;
+	const auto result = fmt::format_to_n(reinterpret_cast<char*>(message.payload), MESSAGE_PAYLOAD_SIZE, format, args...);
+	if (result.size <= MESSAGE_PAYLOAD_SIZE)
+		message.payloadSize = uint32_t(result.size);
+	else
+		message.spilled = std::make_unique<std::string>(fmt::format(format, args...));
+	EndWrite(*slot);
+}
+
+template <typename T>
+auto Logger::ToStringView(const T& arg) -> std::string_view
+{
+	if constexpr (std::is_pointer_v<T>)
+		return arg ? std::string_view(arg) : std::string_view();
+	else
+		return std::string_view(arg);
+}
+
+template <typename T>
+auto Logger::GetEncodedSize(const T& arg) -> size_t
+{
+	using Type = std::decay_t<T>;
+	if constexpr (IsStringArg<Type>)
+		return sizeof(uint32_t) + ToStringView(arg).size();
+	else
+		return sizeof(Type);
+}
+
+template <typename T>
+void Logger::Encode(uint8_t*& dst, const T& arg)
+{
+	using Type = std::decay_t<T>;
+	if constexpr (IsStringArg<Type>)
+	{
+		const auto view = ToStringView(arg);
+		const auto size = uint32_t(view.size());
+		std::memcpy(dst, &size, sizeof(size));
+		std::memcpy(dst + sizeof(size), view.data(), size);
+		dst += sizeof(size) + size;
+	}
+	else
+	{
+		std::memcpy(dst, &arg, sizeof(Type));
+		dst += sizeof(Type);
+	}
+}
+
+template <typename T>
+auto Logger::Decode(const uint8_t*& src) -> T
+{
+	if constexpr (std::is_same_v<T, std::string_view>)
+	{
+		uint32_t size = 0;
+		std::memcpy(&size, src, sizeof(size));
+		const auto view = std::string_view(reinterpret_cast<const char*>(src + sizeof(size)), size);
+		src += sizeof(size) + size;
+		return view;
+	}
+	else
+	{
+		T value;
+		std::memcpy(&value, src, sizeof(T));
+		src += sizeof(T);
+		return value;
+	}
+}
+
+template <typename... Stored>
+void Logger::FormatEncoded(const Message& message, fmt::memory_buffer& out)
+{
+	[[maybe_unused]] const auto* src = message.payload; // Unused without arguments
+	// Braced initialisation, so the arguments are decoded in order.
+	std::tuple<Stored...> args{ Decode<Stored>(src)... };
+	std::apply([&](auto&... values) { fmt::vformat_to(fmt::appender(out), message.formatString, fmt::make_format_args(values...)); }, args);
+}
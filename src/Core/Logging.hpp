@@ -1,9 +1,36 @@
 #pragma once
 
+#include "Logger.hpp"
+
 #include <fmt/format.h>
 
-#include <iostream>
+/**
+ * Levels below GS_LOG_LEVEL are compiled out, their arguments are not evaluated. Set with the CMake cache variable of the same name.
+ * Format strings must be literals, they are read after the call returns (see Logger).
+ */
+#define GS_LOG_LEVEL_INFO 0
+#define GS_LOG_LEVEL_WARN 1
+#define GS_LOG_LEVEL_ERROR 2
+#define GS_LOG_LEVEL_OFF 3
+
+#ifndef GS_LOG_LEVEL
+	#define GS_LOG_LEVEL GS_LOG_LEVEL_INFO
+#endif
+
+#if GS_LOG_LEVEL <= GS_LOG_LEVEL_INFO
+	#define LOG_INFO(...) Logger::Get().Log(LogLevel::Info, __VA_ARGS__)
+#else
+	#define LOG_INFO(...) ((void)0)
+#endif
+
+#if GS_LOG_LEVEL <= GS_LOG_LEVEL_WARN
+	#define LOG_WARN(...) Logger::Get().Log(LogLevel::Warn, __VA_ARGS__)
+#else
+	#define LOG_WARN(...) ((void)0)
+#endif
 
-#define LOG_INFO(...) std::cout << "[INFO] " << fmt::format(__VA_ARGS__) << std::endl
-#define LOG_WARN(...) std::cout << "[WARN] " << fmt::format(__VA_ARGS__) << std::endl
-#define LOG_ERR(...) std::cerr << "[ERROR] " << fmt::format(__VA_ARGS__) << std::endl
+#if GS_LOG_LEVEL <= GS_LOG_LEVEL_ERROR
+	#define LOG_ERR(...) Logger::Get().Log(LogLevel::Error, __VA_ARGS__)
+#else
+	#define LOG_ERR(...) ((void)0)
+#endif
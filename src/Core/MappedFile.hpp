@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+/**
+ * Read-only memory mapping of a whole file. The mapping is released on Close() or destruction.
+ */
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	auto operator=(const MappedFile&) -> MappedFile& = delete;
+	auto operator=(MappedFile&& other) noexcept -> MappedFile&;
+
+	bool Open(const std::filesystem::path& filename);
+	void Close();
+
+	//////////////////////////////////////////////////
+	/// Getters
+	//////////////////////////////////////////////////
+
+	bool IsOpen() const { return m_data != nullptr; }
+	auto GetData() const -> const uint8_t* { return m_data; }
+	auto GetSize() const -> size_t { return m_size; }
+
+private:
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+
+#ifdef _WIN32
+	void* m_fileHandle = nullptr;
+	void* m_mappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,195 @@
+#include "Profiler.hpp"
+
+#include "Logging.hpp"
+
+#include <chrono>
+
+namespace
+{
+	constexpr uint32_t PROFILER_PROCESS_ID = 1;
+	constexpr uint32_t PROFILER_GPU_THREAD_ID = 0; // Real threads start at 1
+
+	auto GetClockNs() -> uint64_t
+	{
+		return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+} // namespace
+
+Profiler::Profiler() : m_epochNs(GetClockNs()) {}
+
+Profiler::~Profiler()
+{
+	EndCapture();
+}
+
+auto Profiler::Get() -> Profiler&
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+bool Profiler::BeginCapture(const std::filesystem::path& filename)
+{
+	EndCapture();
+
+	if (filename.has_parent_path())
+	{
+		std::error_code error;
+		std::filesystem::create_directories(filename.parent_path(), error);
+	}
+	m_file = std::fopen(filename.string().c_str(), "wb");
+	if (!m_file)
+	{
+		LOG_ERR("Failed to open trace file: {}", filename.string());
+		return false;
+	}
+
+	fmt::print(m_file, "[");
+	m_firstEvent = true;
+	m_frameIndex = 0;
+	WriteThreadName(PROFILER_GPU_THREAD_ID, "GPU");
+
+	// Discard anything recorded while not capturing.
+	{
+		std::lock_guard lock(m_ringsMutex);
+		for (auto& ring : m_rings)
+		{
+			ring->tail.store(ring->head.load(std::memory_order_acquire), std::memory_order_release);
+			ring->isNameWritten = false;
+		}
+	}
+	m_isCapturing.store(true, std::memory_order_relaxed);
+	LOG_INFO("Profiler capture started: {}", filename.string());
+	return true;
+}
+
+void Profiler::EndCapture()
+{
+	if (!m_file)
+		return;
+
+	EndFrame();
+	m_isCapturing.store(false, std::memory_order_relaxed);
+
+	fmt::print(m_file, "\n]\n");
+	std::fclose(m_file);
+	m_file = nullptr;
+	LOG_INFO("Profiler capture ended: {} frames, {} zones dropped", m_frameIndex, GetDroppedZoneCount());
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+	auto& ring = GetThreadRing();
+	std::lock_guard lock(m_ringsMutex);
+	ring.threadName = name;
+	ring.isNameWritten = false;
+}
+
+void Profiler::AddZone(const char* name, uint64_t startNs, uint64_t endNs)
+{
+	if (!IsCapturing())
+		return;
+
+	auto& ring = GetThreadRing();
+	const auto head = ring.head.load(std::memory_order_relaxed);
+	if (head - ring.tail.load(std::memory_order_acquire) >= RING_CAPACITY)
+	{
+		m_droppedZones.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	ring.zones[head % RING_CAPACITY] = { name, startNs, endNs };
+	ring.head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::AddGpuZones(const std::vector<ProfileZone>& zones)
+{
+	if (!IsCapturing())
+		return;
+
+	std::lock_guard lock(m_gpuZonesMutex);
+	m_gpuZones.insert(m_gpuZones.end(), zones.begin(), zones.end());
+}
+
+void Profiler::EndFrame()
+{
+	if (!m_file)
+		return;
+
+	{
+		std::lock_guard lock(m_ringsMutex);
+		for (auto& ring : m_rings)
+		{
+			if (!ring->isNameWritten && !ring->threadName.empty())
+			{
+				WriteThreadName(ring->threadId, ring->threadName);
+				ring->isNameWritten = true;
+			}
+
+			const auto head = ring->head.load(std::memory_order_acquire);
+			auto tail = ring->tail.load(std::memory_order_relaxed);
+			for (; tail != head; ++tail)
+				WriteZone(ring->zones[tail % RING_CAPACITY], ring->threadId);
+			ring->tail.store(tail, std::memory_order_release);
+		}
+	}
+	{
+		std::lock_guard lock(m_gpuZonesMutex);
+		for (const auto& zone : m_gpuZones)
+			WriteZone(zone, PROFILER_GPU_THREAD_ID);
+		m_gpuZones.clear();
+	}
+
+	++m_frameIndex;
+	std::fflush(m_file);
+}
+
+auto Profiler::Now() const -> uint64_t
+{
+	return GetClockNs() - m_epochNs;
+}
+
+auto Profiler::GetThreadRing() -> ThreadRing&
+{
+	/* Rings are never freed, pool threads live as long as the process. */
+	thread_local ThreadRing* threadRing = nullptr;
+	if (!threadRing)
+	{
+		std::lock_guard lock(m_ringsMutex);
+		auto& ring = m_rings.emplace_back(std::make_unique<ThreadRing>());
+		ring->threadId = uint32_t(m_rings.size());
+		threadRing = ring.get();
+	}
+	return *threadRing;
+}
+
+void Profiler::WriteZone(const ProfileZone& zone, uint32_t threadId)
+{
+	fmt::print(m_file,
+		R"({}{{"name":"{}","ph":"X","ts":{:.3f},"dur":{:.3f},"pid":{},"tid":{}}})",
+		m_firstEvent ? "\n" : ",\n",
+		zone.name,
+		double(zone.startNs) / 1000.0,
+		double(zone.endNs - zone.startNs) / 1000.0,
+		PROFILER_PROCESS_ID,
+		threadId);
+	m_firstEvent = false;
+}
+
+void Profiler::WriteThreadName(uint32_t threadId, const std::string& name)
+{
+	fmt::print(m_file,
+		R"({}{{"name":"thread_name","ph":"M","pid":{},"tid":{},"args":{{"name":"{}"}}}})",
+		m_firstEvent ? "\n" : ",\n",
+		PROFILER_PROCESS_ID,
+		threadId,
+		name);
+	m_firstEvent = false;
+}
+
+ProfileScope::ProfileScope(const char* name) : m_name(name), m_startNs(Profiler::Get().Now()) {}
+
+ProfileScope::~ProfileScope()
+{
+	auto& profiler = Profiler::Get();
+	profiler.AddZone(m_name, m_startNs, profiler.Now());
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Instrumentation macros. They compile to nothing unless the build defines GS_PROFILER_ENABLED (CMake option GS_ENABLE_PROFILER).
+ * Zone names must be string literals (or otherwise outlive the capture), only the pointer is recorded.
+ */
+#ifdef GS_PROFILER_ENABLED
+	#define GS_PROFILE_CONCAT_INNER(a, b) a##b
+	#define GS_PROFILE_CONCAT(a, b) GS_PROFILE_CONCAT_INNER(a, b)
+	#define PROFILE_SCOPE(name) const ProfileScope GS_PROFILE_CONCAT(profileScope, __LINE__)(name)
+	#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+	#define PROFILE_THREAD_NAME(name) Profiler::Get().SetThreadName(name)
+	#define PROFILE_END_FRAME() Profiler::Get().EndFrame()
+#else
+	#define PROFILE_SCOPE(name)
+	#define PROFILE_FUNCTION()
+	#define PROFILE_THREAD_NAME(name)
+	#define PROFILE_END_FRAME()
+#endif
+
+struct ProfileZone
+{
+	const char* name;
+	uint64_t startNs; // Since the profiler was created
+	uint64_t endNs;
+};
+
+/**
+ * Collects timed zones from every thread and streams them to a Chrome trace (JSON array format, also opened by Perfetto).
+ *
+ * Each thread records into its own single-producer ring, so recording never takes a lock. EndFrame() drains the rings on the calling
+ * thread and appends the frame's zones to the trace file. Zones are dropped (and counted) if a ring fills up within a frame.
+ */
+class Profiler
+{
+public:
+	Profiler();
+	~Profiler();
+
+	Profiler(const Profiler&) = delete;
+	auto operator=(const Profiler&) -> Profiler& = delete;
+
+	static auto Get() -> Profiler&;
+
+	/**
+	 * Starts writing the trace to `filename`. Nothing is kept or written before this.
+	 */
+	bool BeginCapture(const std::filesystem::path& filename);
+	void EndCapture();
+	bool IsCapturing() const { return m_isCapturing.load(std::memory_order_relaxed); }
+
+	void SetThreadName(const std::string& name);
+
+	/**
+	 * Records a finished zone on the calling thread.
+	 */
+	void AddZone(const char* name, uint64_t startNs, uint64_t endNs);
+	/**
+	 * Zones measured on the GPU, already converted to profiler time. Shown on their own track.
+	 */
+	void AddGpuZones(const std::vector<ProfileZone>& zones);
+
+	/**
+	 * Writes every zone recorded since the last call to the trace.
+	 */
+	void EndFrame();
+
+	//////////////////////////////////////////////////
+	/// Getters
+	//////////////////////////////////////////////////
+
+	auto Now() const -> uint64_t;
+	auto GetDroppedZoneCount() const -> uint64_t { return m_droppedZones.load(std::memory_order_relaxed); }
+
+private:
+	static constexpr uint32_t RING_CAPACITY = 1u << 16; // Zones per thread per frame
+
+	/* Single producer (the owning thread), single consumer (the thread calling EndFrame). */
+	struct ThreadRing
+	{
+		uint32_t threadId = 0;
+		std::string threadName; // Guarded by m_ringsMutex
+		bool isNameWritten = false;
+		std::unique_ptr<ProfileZone[]> zones = std::make_unique<ProfileZone[]>(RING_CAPACITY);
+		std::atomic<uint64_t> head = 0; // Next write, only advanced by the producer
+		std::atomic<uint64_t> tail = 0; // Next read, only advanced by the consumer
+	};
+
+	auto GetThreadRing() -> ThreadRing&;
+	void WriteZone(const ProfileZone& zone, uint32_t threadId);
+	void WriteThreadName(uint32_t threadId, const std::string& name);
+
+private:
+	const uint64_t m_epochNs;
+	std::atomic<bool> m_isCapturing = false;
+	std::atomic<uint64_t> m_droppedZones = 0;
+
+	std::mutex m_ringsMutex; // Only guards the list, taken once per thread and once per EndFrame()
+	std::vector<std::unique_ptr<ThreadRing>> m_rings;
+
+	std::mutex m_gpuZonesMutex;
+	std::vector<ProfileZone> m_gpuZones;
+
+	std::FILE* m_file = nullptr;
+	bool m_firstEvent = true;
+	uint64_t m_frameIndex = 0;
+};
+
+/**
+ * Records the lifetime of the scope as a zone. Use through PROFILE_SCOPE().
+ */
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name);
+	~ProfileScope();
+
+	ProfileScope(const ProfileScope&) = delete;
+	auto operator=(const ProfileScope&) -> ProfileScope& = delete;
+
+private:
+	const char* m_name;
+	uint64_t m_startNs;
+};
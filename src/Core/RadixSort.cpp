@@ -0,0 +1,59 @@
+#include "RadixSort.hpp"
+
+#include <algorithm>
+
+void RadixSort(uint64_t* keys, uint32_t* values, uint64_t* tempKeys, uint32_t* tempValues, size_t count)
+{
+	constexpr uint32_t RADIX_BITS = 8;
+	constexpr uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+	constexpr uint32_t PASS_COUNT = 64 / RADIX_BITS;
+
+	if (count < 2)
+		return;
+
+	// All histograms are built in a single read of the keys.
+	size_t histograms[PASS_COUNT][RADIX_SIZE] = {};
+	for (size_t i = 0; i < count; ++i)
+	{
+		const auto key = keys[i];
+		for (auto pass = 0u; pass < PASS_COUNT; ++pass)
+			++histograms[pass][(key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)];
+	}
+
+	auto* srcKeys = keys;
+	auto* srcValues = values;
+	auto* dstKeys = tempKeys;
+	auto* dstValues = tempValues;
+	for (auto pass = 0u; pass < PASS_COUNT; ++pass)
+	{
+		auto& histogram = histograms[pass];
+		const auto shift = pass * RADIX_BITS;
+		if (histogram[(srcKeys[0] >> shift) & (RADIX_SIZE - 1)] == count)
+			continue;
+
+		// Histogram -> exclusive prefix sum (output offset of each bucket).
+		size_t offset = 0;
+		for (auto& bucket : histogram)
+		{
+			const auto bucketCount = bucket;
+			bucket = offset;
+			offset += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const auto dstIndex = histogram[(srcKeys[i] >> shift) & (RADIX_SIZE - 1)]++;
+			dstKeys[dstIndex] = srcKeys[i];
+			dstValues[dstIndex] = srcValues[i];
+		}
+
+		std::swap(srcKeys, dstKeys);
+		std::swap(srcValues, dstValues);
+	}
+
+	if (srcKeys != keys)
+	{
+		std::copy(srcKeys, srcKeys + count, keys);
+		std::copy(srcValues, srcValues + count, values);
+	}
+}
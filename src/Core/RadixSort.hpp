@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Stable LSD radix sort of 64-bit keys (8 bits per pass), carrying a 32-bit value along with each key.
+ * Passes where every key has the same byte are skipped, so keys that only use a few bits sort in fewer passes.
+ * `tempKeys`/`tempValues` must hold `count` elements. The sorted result ends up in `keys`/`values`.
+ */
+void RadixSort(uint64_t* keys, uint32_t* values, uint64_t* tempKeys, uint32_t* tempValues, size_t count);
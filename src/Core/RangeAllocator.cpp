@@ -0,0 +1,132 @@
+#include "RangeAllocator.hpp"
+
+#include <cassert>
+#include <iterator>
+
+RangeAllocator::RangeAllocator(uint64_t capacity) : m_capacity(capacity)
+{
+	if (capacity > 0)
+		AddFreeBlock(0, capacity);
+}
+
+auto RangeAllocator::Allocate(uint64_t size, uint64_t alignment) -> std::optional<RangeAllocation>
+{
+	if (size == 0 || alignment == 0)
+		return std::nullopt;
+
+	// Smallest block that fits once its start is aligned. Alignment padding can make a block too small, so keep looking.
+	for (auto sizeIt = m_freeBySize.lower_bound(size); sizeIt != m_freeBySize.end(); ++sizeIt)
+	{
+		const auto [blockSize, blockOffset] = *sizeIt;
+		const auto alignedOffset = (blockOffset + alignment - 1) / alignment * alignment;
+		const auto padding = alignedOffset - blockOffset;
+		if (padding + size > blockSize)
+			continue;
+
+		RemoveFreeBlock(m_freeByOffset.find(blockOffset));
+		if (padding > 0)
+			AddFreeBlock(blockOffset, padding);
+		if (padding + size < blockSize)
+			AddFreeBlock(alignedOffset + size, blockSize - padding - size);
+
+		m_usedSize += size;
+		++m_allocationCount;
+		return RangeAllocation{ alignedOffset, size };
+	}
+
+	return std::nullopt;
+}
+
+void RangeAllocator::Free(const RangeAllocation& allocation)
+{
+	if (allocation.size == 0)
+		return;
+
+	assert(allocation.offset + allocation.size <= m_capacity);
+	assert(m_usedSize >= allocation.size && m_allocationCount > 0);
+	m_usedSize -= allocation.size;
+	--m_allocationCount;
+
+	auto offset = allocation.offset;
+	auto size = allocation.size;
+
+	// Coalesce with the free neighbours on either side.
+	auto nextIt = m_freeByOffset.lower_bound(offset);
+	assert(nextIt == m_freeByOffset.end() || nextIt->first >= offset + size); // Double free / overlap
+	if (nextIt != m_freeByOffset.end() && nextIt->first == offset + size)
+	{
+		size += nextIt->second;
+		RemoveFreeBlock(nextIt);
+		nextIt = m_freeByOffset.lower_bound(offset);
+	}
+	if (nextIt != m_freeByOffset.begin())
+	{
+		const auto prevIt = std::prev(nextIt);
+		assert(prevIt->first + prevIt->second <= offset);
+		if (prevIt->first + prevIt->second == offset)
+		{
+			offset = prevIt->first;
+			size += prevIt->second;
+			RemoveFreeBlock(prevIt);
+		}
+	}
+
+	AddFreeBlock(offset, size);
+}
+
+void RangeAllocator::Grow(uint64_t newCapacity)
+{
+	if (newCapacity <= m_capacity)
+		return;
+
+	const auto oldCapacity = m_capacity;
+	m_capacity = newCapacity;
+
+	// Merge with a free block ending at the old capacity.
+	auto offset = oldCapacity;
+	auto size = newCapacity - oldCapacity;
+	if (!m_freeByOffset.empty())
+	{
+		const auto lastIt = std::prev(m_freeByOffset.end());
+		if (lastIt->first + lastIt->second == oldCapacity)
+		{
+			offset = lastIt->first;
+			size += lastIt->second;
+			RemoveFreeBlock(lastIt);
+		}
+	}
+	AddFreeBlock(offset, size);
+}
+
+auto RangeAllocator::GetStats() const -> RangeAllocatorStats
+{
+	RangeAllocatorStats stats{};
+	stats.capacity = m_capacity;
+	stats.usedSize = m_usedSize;
+	stats.freeSize = m_capacity - m_usedSize;
+	stats.largestFreeBlock = m_freeBySize.empty() ? 0 : m_freeBySize.rbegin()->first;
+	stats.allocationCount = m_allocationCount;
+	stats.freeBlockCount = uint32_t(m_freeByOffset.size());
+	return stats;
+}
+
+void RangeAllocator::AddFreeBlock(uint64_t offset, uint64_t size)
+{
+	m_freeByOffset.emplace(offset, size);
+	m_freeBySize.emplace(size, offset);
+}
+
+void RangeAllocator::RemoveFreeBlock(std::map<uint64_t, uint64_t>::iterator offsetIt)
+{
+	const auto [offset, size] = *offsetIt;
+	auto [begin, end] = m_freeBySize.equal_range(size);
+	for (auto it = begin; it != end; ++it)
+	{
+		if (it->second == offset)
+		{
+			m_freeBySize.erase(it);
+			break;
+		}
+	}
+	m_freeByOffset.erase(offsetIt);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+
+struct RangeAllocation
+{
+	uint64_t offset = 0;
+	uint64_t size = 0;
+};
+
+struct RangeAllocatorStats
+{
+	uint64_t capacity = 0;
+	uint64_t usedSize = 0;
+	uint64_t freeSize = 0;
+	uint64_t largestFreeBlock = 0;
+	uint32_t allocationCount = 0;
+	uint32_t freeBlockCount = 0;
+
+	/**
+	 * 0 when all free space is one contiguous block, approaching 1 as it splits into many small blocks.
+	 */
+	auto GetFragmentation() const -> float { return freeSize > 0 ? 1.0f - float(double(largestFreeBlock) / double(freeSize)) : 0.0f; }
+};
+
+/**
+ * Best-fit free-list sub-allocator of an abstract [0, capacity) range, eg. regions of a GPU buffer.
+ * Free blocks are indexed by offset (for coalescing neighbours on free) and by size (for best-fit lookup), both O(log n).
+ * Touches no memory of its own, so it can be used and tested without a GPU.
+ */
+class RangeAllocator
+{
+public:
+	RangeAllocator() = default;
+	explicit RangeAllocator(uint64_t capacity);
+
+	/**
+	 * Returns std::nullopt if no free block fits. `alignment` does not need to be a power of 2 (eg. a vertex stride).
+	 */
+	auto Allocate(uint64_t size, uint64_t alignment = 1) -> std::optional<RangeAllocation>;
+	void Free(const RangeAllocation& allocation);
+
+	/**
+	 * Extends the range to `newCapacity`. Existing allocations keep their offsets.
+	 */
+	void Grow(uint64_t newCapacity);
+
+	//////////////////////////////////////////////////
+	/// Getters
+	//////////////////////////////////////////////////
+
+	auto GetCapacity() const -> uint64_t { return m_capacity; }
+	auto GetStats() const -> RangeAllocatorStats;
+
+private:
+	void AddFreeBlock(uint64_t offset, uint64_t size);
+	void RemoveFreeBlock(std::map<uint64_t, uint64_t>::iterator offsetIt);
+
+private:
+	uint64_t m_capacity = 0;
+	uint64_t m_usedSize = 0;
+	uint32_t m_allocationCount = 0;
+
+	std::map<uint64_t, uint64_t> m_freeByOffset;	  // Offset -> size
+	std::multimap<uint64_t, uint64_t> m_freeBySize; // Size -> offset
+};
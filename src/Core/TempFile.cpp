@@ -0,0 +1,17 @@
+#include "TempFile.hpp"
+
+#include <fmt/format.h>
+
+#include <functional>
+#include <random>
+#include <thread>
+
+auto GetTempFilename(const std::filesystem::path& filename) -> std::filesystem::path
+{
+	static const auto processToken = std::random_device{}();
+	const auto threadToken = std::hash<std::thread::id>{}(std::this_thread::get_id());
+
+	auto tempFilename = filename;
+	tempFilename += fmt::format(".{:08x}{:016x}.tmp", processToken, uint64_t(threadToken));
+	return tempFilename;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <filesystem>
+
+/**
+ * `filename` with a suffix unique to the calling process and thread. Write to it, then rename it over `filename`, so concurrent
+ * writers never share a temporary file and readers never see a partial one.
+ */
+auto GetTempFilename(const std::filesystem::path& filename) -> std::filesystem::path;
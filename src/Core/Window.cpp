@@ -17,6 +17,7 @@ bool Window::Init(int32_t width, int32_t height, const char* title)
 		return false;
 
 	glfwSetWindowUserPointer(m_window, this);
+	UpdateSurfaceSize();
 
 	return true;
 }
@@ -35,6 +36,7 @@ void Window::NewFrame()
 void Window::PollEvents()
 {
 	glfwPollEvents();
+	UpdateSurfaceSize();
 }
 
 auto Window::CreateSurface(const vk::Instance instance) -> vk::SurfaceKHR
@@ -44,20 +46,13 @@ auto Window::CreateSurface(const vk::Instance instance) -> vk::SurfaceKHR
 	return surface;
 }
 
-auto Window::GetSurfaceWidth() -> uint32_t
+void Window::UpdateSurfaceSize()
 {
 	int32_t width;
 	int32_t height;
 	glfwGetFramebufferSize(m_window, &width, &height);
-	return width;
-}
-
-auto Window::GetSurfaceHeight() -> uint32_t
-{
-	int32_t width;
-	int32_t height;
-	glfwGetFramebufferSize(m_window, &width, &height);
-	return height;
+	m_surfaceWidth.store(uint32_t(width), std::memory_order_relaxed);
+	m_surfaceHeight.store(uint32_t(height), std::memory_order_relaxed);
 }
 
 bool Window::IsVSync()
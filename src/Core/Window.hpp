@@ -4,6 +4,8 @@
 
 #include <GLFW/glfw3.h>
 
+#include <atomic>
+
 class Window : public VkMana::WSI
 {
 public:
@@ -19,8 +21,9 @@ public:
 
 	auto CreateSurface(vk::Instance instance) -> vk::SurfaceKHR override;
 
-	auto GetSurfaceWidth() -> uint32_t override;
-	auto GetSurfaceHeight() -> uint32_t override;
+	/* Cached by PollEvents(), GLFW may only be queried on the main thread but the render thread needs the size too. */
+	auto GetSurfaceWidth() -> uint32_t override { return m_surfaceWidth.load(std::memory_order_relaxed); }
+	auto GetSurfaceHeight() -> uint32_t override { return m_surfaceHeight.load(std::memory_order_relaxed); }
 
 	bool IsVSync() override;
 	bool IsAlive() override;
@@ -31,6 +34,11 @@ public:
 	auto CreateCursor(uint32_t cursorType) -> void* override;
 	void SetCursor(void* cursor) override;
 
+private:
+	void UpdateSurfaceSize();
+
 private:
 	GLFWwindow* m_window;
+	std::atomic<uint32_t> m_surfaceWidth = 0;
+	std::atomic<uint32_t> m_surfaceHeight = 0;
 };
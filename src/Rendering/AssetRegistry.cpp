@@ -0,0 +1,326 @@
+#include "AssetRegistry.hpp"
+
+#include "Core/Hash.hpp"
+#include "Core/Logging.hpp"
+#include "Core/Profiler.hpp"
+#include "Mesh.hpp"
+
+#include <system_error>
+
+AssetRegistry::AssetRegistry(VkMana::Context& ctx, GeometryBuffer& geometry) : m_ctx(&ctx), m_geometry(&geometry) {}
+
+AssetRegistry::~AssetRegistry()
+{
+	// Imports write to their mesh and the geometry buffer, they must be done before either goes.
+	for (auto& load : m_meshLoads)
+		JobSystem::Get().Wait(*load.importing);
+}
+
+auto AssetRegistry::GetOrLoadMesh(const std::filesystem::path& filename, const MeshImportOptions& options) -> std::shared_ptr<Mesh>
+{
+	PROFILE_FUNCTION();
+	// The same file imported with different options is a different asset.
+	const auto optionsKey = options.GetKey();
+	const auto canonicalPath = fmt::format("{}#{:x}", GetCanonicalPath(filename), optionsKey);
+	if (const auto it = m_meshHashesByPath.find(canonicalPath); it != m_meshHashesByPath.end())
+	{
+		++m_stats.meshHits;
+		return m_meshes.at(it->second).asset;
+	}
+	for (auto it = m_meshLoads.begin(); it != m_meshLoads.end(); ++it)
+	{
+		if (it->canonicalPath != canonicalPath)
+			continue;
+
+		// Already loading asynchronously, finish it now.
+		++m_stats.meshHits;
+		auto load = std::move(*it);
+		m_meshLoads.erase(it);
+		FinishMeshLoad(load);
+		return load.mesh->IsLoading() ? nullptr : load.mesh;
+	}
+
+	const auto contentHash = HashFile(filename);
+	if (!contentHash)
+	{
+		LOG_ERR("Failed to read mesh file: {}", filename.string());
+		return nullptr;
+	}
+
+	const auto key = HashCombine(contentHash.value(), optionsKey);
+	if (const auto it = m_meshes.find(key); it != m_meshes.end())
+	{
+		++m_stats.meshHits;
+		m_meshHashesByPath[canonicalPath] = key;
+		return it->second.asset;
+	}
+
+	++m_stats.meshMisses;
+
+	auto mesh = std::make_shared<Mesh>(*m_geometry, *this);
+	if (!mesh->LoadFromFile(filename, contentHash.value(), options))
+		return nullptr;
+
+	AddMesh(canonicalPath, key, mesh);
+	return mesh;
+}
+
+auto AssetRegistry::LoadMeshAsync(const std::filesystem::path& filename, const MeshImportOptions& options) -> std::shared_ptr<Mesh>
+{
+	PROFILE_FUNCTION();
+	const auto optionsKey = options.GetKey();
+	const auto canonicalPath = fmt::format("{}#{:x}", GetCanonicalPath(filename), optionsKey);
+	if (const auto it = m_meshHashesByPath.find(canonicalPath); it != m_meshHashesByPath.end())
+	{
+		++m_stats.meshHits;
+		return m_meshes.at(it->second).asset;
+	}
+	for (const auto& load : m_meshLoads)
+	{
+		if (load.canonicalPath == canonicalPath)
+		{
+			++m_stats.meshHits;
+			return load.mesh;
+		}
+	}
+
+	++m_stats.meshMisses;
+
+	// Hashing reads the whole file, so it is part of the job too. Content-hash deduplication happens once the hash is known.
+	// A background job, so the frame's own jobs (and the waits on them) never end up running the import.
+	auto& load = m_meshLoads.emplace_back();
+	load.canonicalPath = canonicalPath;
+	load.optionsKey = optionsKey;
+	load.mesh = std::make_shared<Mesh>(*m_geometry, *this);
+	load.mesh->BeginLoad();
+	load.importing = std::make_unique<JobCounter>();
+	load.startTime = std::chrono::high_resolution_clock::now();
+	load.contentHash = JobSystem::Get().EnqueueBackground(
+		[mesh = load.mesh, filename, options]() -> std::optional<uint64_t> {
+			PROFILE_SCOPE("ImportMesh");
+			const auto contentHash = HashFile(filename);
+			if (!contentHash)
+			{
+				LOG_ERR("Failed to read mesh file: {}", filename.string());
+				return std::nullopt;
+			}
+			if (!mesh->Import(filename, contentHash.value(), options))
+				return std::nullopt;
+			return contentHash;
+		},
+		load.importing.get());
+	return load.mesh;
+}
+
+auto AssetRegistry::FinishMeshLoads(uint64_t textureBudget) -> uint64_t
+{
+	if (m_meshLoads.empty())
+		return 0;
+
+	PROFILE_FUNCTION();
+	uint64_t textureBytes = 0;
+	for (auto it = m_meshLoads.begin(); it != m_meshLoads.end();)
+	{
+		// Waiting on either would stall the frame.
+		if (!it->importing->IsDone() || !it->mesh->AreTexturesDecoded())
+		{
+			++it;
+			continue;
+		}
+
+		const auto loadTextureBytes = it->mesh->GetPendingTextureSize();
+		if (textureBytes != 0 && textureBytes + loadTextureBytes > textureBudget)
+			break;
+
+		FinishMeshLoad(*it);
+		it = m_meshLoads.erase(it);
+		textureBytes += loadTextureBytes;
+	}
+	return textureBytes;
+}
+
+void AssetRegistry::FinishMeshLoad(MeshLoad& load)
+{
+	JobSystem::Get().Wait(*load.importing);
+	const auto contentHash = load.contentHash.get();
+	if (!contentHash)
+	{
+		LOG_ERR("Failed to load mesh: {}", load.canonicalPath);
+		return; // The mesh stays loading, so it is never drawn.
+	}
+
+	load.mesh->FinishLoad();
+	LOG_INFO("Loaded mesh {} in {:.2f} ms",
+		load.canonicalPath,
+		std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - load.startTime).count());
+
+	// The same content may have finished loading under another path meanwhile. Callers already hold this mesh, so it is registered as
+	// its own entry (keyed by path too) rather than dropped: eviction then sees it and releases its geometry and bindless slots.
+	auto key = HashCombine(contentHash.value(), load.optionsKey);
+	if (m_meshes.count(key) != 0)
+	{
+		LOG_WARN("Mesh {} has the same content as a mesh loaded meanwhile, keeping both", load.canonicalPath);
+		key = HashCombine(key, HashString(load.canonicalPath));
+	}
+	AddMesh(load.canonicalPath, key, load.mesh);
+}
+
+void AssetRegistry::AddMesh(const std::string& canonicalPath, uint64_t key, const std::shared_ptr<Mesh>& mesh)
+{
+	auto& entry = m_meshes[key];
+	entry.asset = mesh;
+	entry.memorySize = mesh->GetMemorySize();
+	m_meshHashesByPath[canonicalPath] = key;
+
+	++m_stats.meshCount;
+	m_stats.meshMemory += entry.memorySize;
+}
+
+auto AssetRegistry::GetOrLoadTexture(const std::filesystem::path& filename, TextureUsage usage) -> std::shared_ptr<Texture>
+{
+	PROFILE_FUNCTION();
+	if (auto texture = FindTexture(filename, usage))
+		return texture;
+
+	uint64_t contentHash = 0;
+	const auto data = Texture::LoadData(filename, usage, &contentHash);
+	if (!data)
+	{
+		LOG_WARN("Failed to load texture: {}", filename.string());
+		return nullptr;
+	}
+
+	return AddTexture(filename, usage, contentHash, data.value());
+}
+
+auto AssetRegistry::FindTexture(const std::filesystem::path& filename, TextureUsage usage) -> std::shared_ptr<Texture>
+{
+	const auto it = m_textureHashesByPath.find(GetTextureKeys(filename, usage, 0).first);
+	if (it == m_textureHashesByPath.end())
+		return nullptr;
+
+	++m_stats.textureHits;
+	return m_textures.at(it->second).asset;
+}
+
+auto AssetRegistry::AddTexture(const std::filesystem::path& filename, TextureUsage usage, uint64_t contentHash, const TextureData& data)
+	-> std::shared_ptr<Texture>
+{
+	const auto [pathKey, hashKey] = GetTextureKeys(filename, usage, contentHash);
+	if (const auto it = m_textures.find(hashKey); it != m_textures.end())
+	{
+		++m_stats.textureHits;
+		m_textureHashesByPath[pathKey] = hashKey;
+		return it->second.asset;
+	}
+
+	++m_stats.textureMisses;
+
+	auto texture = std::make_shared<Texture>(*m_ctx);
+	if (!texture->FromData(data))
+		return nullptr;
+
+	auto& entry = m_textures[hashKey];
+	entry.asset = texture;
+	entry.memorySize = texture->GetMemorySize();
+	m_textureHashesByPath[pathKey] = hashKey;
+	m_textureLookup[texture.get()] = hashKey;
+
+	++m_stats.textureCount;
+	m_stats.textureMemory += entry.memorySize;
+
+	return texture;
+}
+
+void AssetRegistry::AddBuiltinTexture(const std::string& name, const std::shared_ptr<Texture>& texture)
+{
+	const auto key = HashString(name);
+
+	auto& entry = m_textures[key];
+	entry.asset = texture;
+	entry.memorySize = texture->GetMemorySize();
+	entry.isBuiltin = true;
+	m_textureLookup[texture.get()] = key;
+
+	++m_stats.textureCount;
+	m_stats.textureMemory += entry.memorySize;
+}
+
+void AssetRegistry::EvictUnreferenced()
+{
+	// Erases every entry the registry holds the only reference to, along with all paths that resolve to it.
+	const auto evict = [](auto& assets, auto& hashesByPath, auto&& onEvict) {
+		for (auto it = assets.begin(); it != assets.end();)
+		{
+			auto& entry = it->second;
+			if (entry.isBuiltin || entry.asset.use_count() > 1)
+			{
+				++it;
+				continue;
+			}
+
+			onEvict(entry);
+
+			for (auto pathIt = hashesByPath.begin(); pathIt != hashesByPath.end();)
+			{
+				if (pathIt->second == it->first)
+					pathIt = hashesByPath.erase(pathIt);
+				else
+					++pathIt;
+			}
+			it = assets.erase(it);
+		}
+	};
+
+	evict(m_meshes, m_meshHashesByPath, [this](const Entry<Mesh>& entry) {
+		for (const auto& callback : m_meshEvictedCallbacks)
+			callback(entry.asset.get());
+
+		++m_stats.evictedMeshes;
+		--m_stats.meshCount;
+		m_stats.meshMemory -= entry.memorySize;
+	});
+
+	evict(m_textures, m_textureHashesByPath, [this](const Entry<Texture>& entry) {
+		for (const auto& callback : m_textureEvictedCallbacks)
+			callback(entry.asset.get());
+
+		m_textureLookup.erase(entry.asset.get());
+		++m_stats.evictedTextures;
+		--m_stats.textureCount;
+		m_stats.textureMemory -= entry.memorySize;
+	});
+}
+
+void AssetRegistry::LogStats() const
+{
+	constexpr auto MiB = 1024.0 * 1024.0;
+	LOG_INFO("Assets: textures {} ({:.2f} MiB, {} hits / {} misses, {} evicted), meshes {} ({:.2f} MiB, {} hits / {} misses, {} evicted)",
+		m_stats.textureCount,
+		double(m_stats.textureMemory) / MiB,
+		m_stats.textureHits,
+		m_stats.textureMisses,
+		m_stats.evictedTextures,
+		m_stats.meshCount,
+		double(m_stats.meshMemory) / MiB,
+		m_stats.meshHits,
+		m_stats.meshMisses,
+		m_stats.evictedMeshes);
+}
+
+auto AssetRegistry::GetCanonicalPath(const std::filesystem::path& filename) -> std::string
+{
+	std::error_code err;
+	auto canonicalPath = std::filesystem::weakly_canonical(filename, err);
+	if (err)
+		canonicalPath = std::filesystem::absolute(filename, err).lexically_normal();
+	return canonicalPath.generic_string();
+}
+
+auto AssetRegistry::GetTextureKeys(const std::filesystem::path& filename, TextureUsage usage, uint64_t contentHash) -> std::pair<std::string, uint64_t>
+{
+	auto pathKey = GetCanonicalPath(filename);
+	if (usage == TextureUsage::NormalMap)
+		pathKey += "#normal";
+	return { pathKey, HashCombine(contentHash, usage) };
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "Core/JobSystem.hpp"
+#include "GeometryBuffer.hpp"
+#include "Mesh.hpp"
+#include "Texture.hpp"
+
+#include <VkMana/Context.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct AssetRegistryStats
+{
+	uint32_t textureHits = 0;
+	uint32_t textureMisses = 0;
+	uint32_t meshHits = 0;
+	uint32_t meshMisses = 0;
+	uint32_t evictedTextures = 0;
+	uint32_t evictedMeshes = 0;
+
+	uint32_t textureCount = 0;
+	uint32_t meshCount = 0;
+	uint64_t textureMemory = 0; // Bytes
+	uint64_t meshMemory = 0;	// Bytes
+};
+
+/**
+ * Central owner of shared texture and mesh assets.
+ * Assets are keyed by canonical path, and additionally by content hash so identical files under different paths are only loaded once.
+ * The registry holds a reference to every asset, an asset is unreferenced (and can be evicted) once the registry is its only owner.
+ *
+ * Not thread-safe, all calls are expected on the thread owning the VkMana context. Asynchronous mesh loads import on the job system
+ * and only come back to that thread to be finished.
+ */
+class AssetRegistry
+{
+public:
+	using TextureEvictedFn = std::function<void(const Texture*)>;
+	using MeshEvictedFn = std::function<void(const Mesh*)>;
+
+	AssetRegistry(VkMana::Context& ctx, GeometryBuffer& geometry);
+	~AssetRegistry();
+
+	auto GetOrLoadMesh(const std::filesystem::path& filename, const MeshImportOptions& options = {}) -> std::shared_ptr<Mesh>;
+	/**
+	 * Returns the mesh right away and imports it on the job system. The mesh is empty until FinishMeshLoads() picks it up, and is only
+	 * drawn once resident (see Mesh::IsResident()). Returns nullptr if the import fails.
+	 */
+	auto LoadMeshAsync(const std::filesystem::path& filename, const MeshImportOptions& options = {}) -> std::shared_ptr<Mesh>;
+	/**
+	 * Finishes asynchronous loads whose import and texture decoding are done, in request order: creates their textures and registers
+	 * them. Creating a texture uploads its data right away, so loads are only finished while their texture bytes fit in
+	 * `textureBudget`. The first one always finishes, a mesh with more texture data than the budget gets a call to itself.
+	 * Returns the texture bytes uploaded.
+	 * Creates GPU resources, so must not run while a frame is being recorded. The renderer calls it from Flush().
+	 */
+	auto FinishMeshLoads(uint64_t textureBudget) -> uint64_t;
+	auto GetOrLoadTexture(const std::filesystem::path& filename, TextureUsage usage = TextureUsage::Color) -> std::shared_ptr<Texture>;
+
+	/**
+	 * Lookup by path only. Used to skip decoding of textures that are already loaded.
+	 */
+	auto FindTexture(const std::filesystem::path& filename, TextureUsage usage) -> std::shared_ptr<Texture>;
+	/**
+	 * Registers a texture loaded elsewhere (eg. on a worker thread).
+	 * If a texture with the same content hash is already loaded, that one is returned and `data` is discarded.
+	 */
+	auto AddTexture(const std::filesystem::path& filename, TextureUsage usage, uint64_t contentHash, const TextureData& data) -> std::shared_ptr<Texture>;
+	/**
+	 * Registers a texture that has no backing file (eg. default white/black textures). Built-ins are never evicted.
+	 */
+	void AddBuiltinTexture(const std::string& name, const std::shared_ptr<Texture>& texture);
+
+	bool IsRegistered(const Texture* texture) const { return m_textureLookup.count(texture) != 0; }
+
+	/**
+	 * Releases every asset that is no longer referenced outside of the registry.
+	 * Meshes are evicted first, as they hold the references to their material textures.
+	 */
+	void EvictUnreferenced();
+
+	void AddTextureEvictedCallback(TextureEvictedFn&& callback) { m_textureEvictedCallbacks.push_back(std::move(callback)); }
+	void AddMeshEvictedCallback(MeshEvictedFn&& callback) { m_meshEvictedCallbacks.push_back(std::move(callback)); }
+
+	void LogStats() const;
+
+	//////////////////////////////////////////////////
+	/// Getters
+	//////////////////////////////////////////////////
+
+	auto GetStats() const -> const auto& { return m_stats; }
+	auto GetPendingMeshLoadCount() const -> uint32_t { return uint32_t(m_meshLoads.size()); }
+
+private:
+	static auto GetCanonicalPath(const std::filesystem::path& filename) -> std::string;
+	/* The same image cooked for a different usage is a different asset. */
+	static auto GetTextureKeys(const std::filesystem::path& filename, TextureUsage usage, uint64_t contentHash) -> std::pair<std::string, uint64_t>;
+
+	template <typename T>
+	struct Entry
+	{
+		std::shared_ptr<T> asset;
+		uint64_t memorySize = 0;
+		bool isBuiltin = false;
+	};
+
+	struct MeshLoad
+	{
+		std::string canonicalPath;
+		uint64_t optionsKey = 0;
+		std::shared_ptr<Mesh> mesh;
+		std::unique_ptr<JobCounter> importing;
+		std::future<std::optional<uint64_t>> contentHash; // Nothing if the import failed
+		std::chrono::high_resolution_clock::time_point startTime;
+	};
+
+	/* Waits for the import if it is still running. */
+	void FinishMeshLoad(MeshLoad& load);
+	void AddMesh(const std::string& canonicalPath, uint64_t key, const std::shared_ptr<Mesh>& mesh);
+private:
+	VkMana::Context* m_ctx = nullptr;
+	GeometryBuffer* m_geometry = nullptr;
+
+	// Assets are stored by content hash, any number of canonical paths can resolve to the same asset.
+	std::unordered_map<uint64_t, Entry<Texture>> m_textures;
+	std::unordered_map<std::string, uint64_t> m_textureHashesByPath;
+	std::unordered_map<const Texture*, uint64_t> m_textureLookup;
+
+	std::unordered_map<uint64_t, Entry<Mesh>> m_meshes;
+	std::unordered_map<std::string, uint64_t> m_meshHashesByPath;
+	std::vector<MeshLoad> m_meshLoads; // In request order
+
+	std::vector<TextureEvictedFn> m_textureEvictedCallbacks;
+	std::vector<MeshEvictedFn> m_meshEvictedCallbacks;
+
+	AssetRegistryStats m_stats{};
+};
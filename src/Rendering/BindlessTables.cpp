@@ -0,0 +1,197 @@
+#include "BindlessTables.hpp"
+
+#include "Core/Logging.hpp"
+
+#include <algorithm>
+
+constexpr uint32_t MATERIAL_BUFFER_MIN_CAPACITY = 64;
+
+namespace
+{
+	/* Sorts and dedups `slots`, then calls `fn(first, count)` for each run of consecutive slots. */
+	template <typename Fn>
+	void ForEachRun(std::vector<uint32_t>& slots, Fn&& fn)
+	{
+		std::sort(slots.begin(), slots.end());
+		slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+
+		size_t runStart = 0;
+		for (size_t i = 1; i <= slots.size(); ++i)
+		{
+			if (i == slots.size() || slots[i] != slots[i - 1] + 1)
+			{
+				fn(slots[runStart], uint32_t(i - runStart));
+				runStart = i;
+			}
+		}
+		slots.clear();
+	}
+} // namespace
+
+auto BindlessTables::SlotAllocator::Allocate() -> uint32_t
+{
+	if (freeSlots.empty())
+		return slotCount++;
+
+	const auto slot = freeSlots.back();
+	freeSlots.pop_back();
+	return slot;
+}
+
+void BindlessTables::SlotAllocator::Free(uint32_t slot, uint64_t frameIndex)
+{
+	pendingFrees.push_back({ frameIndex, slot });
+}
+
+void BindlessTables::SlotAllocator::Retire(uint64_t frameIndex)
+{
+	const auto it = std::partition(pendingFrees.begin(), pendingFrees.end(), [frameIndex](const PendingFree& pendingFree) {
+		return pendingFree.frameIndex + FRAME_RING_FRAME_COUNT > frameIndex;
+	});
+	for (auto freeIt = it; freeIt != pendingFrees.end(); ++freeIt)
+		freeSlots.push_back(freeIt->slot);
+	pendingFrees.erase(it, pendingFrees.end());
+}
+
+BindlessTables::BindlessTables(VkMana::Context& ctx) : m_ctx(&ctx) {}
+
+bool BindlessTables::Init(
+	const VkMana::SetLayoutHandle& textureSetLayout, const VkMana::SetLayoutHandle& materialSetLayout, const VkMana::ImageView* fallbackView)
+{
+	m_textureSetLayout = textureSetLayout;
+	m_materialSetLayout = materialSetLayout;
+	m_fallbackView = fallbackView;
+
+	for (auto& frame : m_frames)
+	{
+		frame.textureSet = m_ctx->RequestDescriptorSet(m_textureSetLayout.Get());
+		frame.materialSet = m_ctx->RequestDescriptorSet(m_materialSetLayout.Get());
+		if (!frame.textureSet || !frame.materialSet)
+		{
+			LOG_ERR("Failed to allocate bindless descriptor sets");
+			return false;
+		}
+		m_ctx->SetName(*frame.textureSet, "descriptor_set_bindless");
+		m_ctx->SetName(*frame.materialSet, "descriptor_set_materials");
+	}
+	return true;
+}
+
+auto BindlessTables::AddTexture(const VkMana::ImageView* view) -> std::optional<uint32_t>
+{
+	const auto slot = m_textureSlots.Allocate();
+	if (slot >= BINDLESS_TEXTURE_CAPACITY)
+	{
+		--m_textureSlots.slotCount;
+		LOG_ERR("Bindless texture table is full ({} slots)", BINDLESS_TEXTURE_CAPACITY);
+		return std::nullopt;
+	}
+
+	if (slot >= m_textures.size())
+		m_textures.resize(slot + 1, m_fallbackView);
+	m_textures[slot] = view;
+	MarkTextureDirty(slot);
+	++m_stats.textureCount;
+	return slot;
+}
+
+void BindlessTables::FreeTexture(uint32_t slot)
+{
+	// Point the stale slot at a valid image, so the table never references a destroyed view.
+	m_textures[slot] = m_fallbackView;
+	MarkTextureDirty(slot);
+	m_textureSlots.Free(slot, m_frameIndex);
+	--m_stats.textureCount;
+}
+
+auto BindlessTables::AddMaterial(const MaterialData& material) -> uint32_t
+{
+	const auto slot = m_materialSlots.Allocate();
+	if (slot >= m_materials.size())
+		m_materials.resize(slot + 1);
+	m_materials[slot] = material;
+	MarkMaterialDirty(slot);
+	++m_stats.materialCount;
+	return slot;
+}
+
+void BindlessTables::UpdateMaterial(uint32_t slot, const MaterialData& material)
+{
+	m_materials[slot] = material;
+	MarkMaterialDirty(slot);
+}
+
+void BindlessTables::FreeMaterial(uint32_t slot)
+{
+	m_materialSlots.Free(slot, m_frameIndex);
+	--m_stats.materialCount;
+}
+
+void BindlessTables::BeginFrame()
+{
+	++m_frameIndex;
+	m_frameSlot = uint32_t(m_frameIndex % FRAME_RING_FRAME_COUNT);
+
+	m_textureSlots.Retire(m_frameIndex);
+	m_materialSlots.Retire(m_frameIndex);
+
+	m_stats.textureWrites = 0;
+	m_stats.materialUploadBytes = 0;
+
+	auto& frame = m_frames[m_frameSlot];
+	FlushTextures(frame);
+	FlushMaterials(frame);
+}
+
+void BindlessTables::MarkTextureDirty(uint32_t slot)
+{
+	for (auto& frame : m_frames)
+		frame.dirtyTextures.push_back(slot);
+}
+
+void BindlessTables::MarkMaterialDirty(uint32_t slot)
+{
+	for (auto& frame : m_frames)
+		frame.dirtyMaterials.push_back(slot);
+}
+
+void BindlessTables::FlushTextures(FrameCopy& frame)
+{
+	std::vector<const VkMana::ImageView*> views;
+	ForEachRun(frame.dirtyTextures, [&](uint32_t first, uint32_t count) {
+		views.assign(m_textures.begin() + first, m_textures.begin() + first + count);
+		frame.textureSet->WriteArray(0, first, views, m_ctx->GetLinearSampler());
+		m_stats.textureWrites += count;
+	});
+}
+
+void BindlessTables::FlushMaterials(FrameCopy& frame)
+{
+	if (m_materials.size() > frame.materialCapacity)
+	{
+		const auto newCapacity = std::max({ uint32_t(m_materials.size()), frame.materialCapacity * 2, MATERIAL_BUFFER_MIN_CAPACITY });
+
+		auto bufferInfo = VkMana::BufferCreateInfo::Uniform(sizeof(MaterialData) * newCapacity);
+		bufferInfo.Usage = vk::BufferUsageFlagBits::eStorageBuffer;
+		auto newBuffer = m_ctx->CreateBuffer(bufferInfo);
+		if (!newBuffer)
+		{
+			LOG_ERR("Failed to grow material buffer to {} materials", newCapacity);
+			return;
+		}
+		m_ctx->SetName(*newBuffer, "ssbo_materials");
+
+		// The new buffer starts empty, so everything is dirty. The old one is released by VkMana once the GPU is done with it.
+		frame.materialBuffer = newBuffer;
+		frame.materialCapacity = newCapacity;
+		frame.materialSet->Write(frame.materialBuffer.Get(), 0, vk::DescriptorType::eStorageBuffer, 0, frame.materialBuffer->GetSize());
+		frame.dirtyMaterials.resize(m_materials.size());
+		for (uint32_t i = 0; i < m_materials.size(); ++i)
+			frame.dirtyMaterials[i] = i;
+	}
+
+	ForEachRun(frame.dirtyMaterials, [&](uint32_t first, uint32_t count) {
+		frame.materialBuffer->WriteHostAccessible(sizeof(MaterialData) * first, sizeof(MaterialData) * count, &m_materials[first]);
+		m_stats.materialUploadBytes += sizeof(MaterialData) * count;
+	});
+}
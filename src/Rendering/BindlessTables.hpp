@@ -0,0 +1,126 @@
+#pragma once
+
+#include "FrameRingBuffer.hpp"
+
+#include <VkMana/Buffer.hpp>
+#include <VkMana/Context.hpp>
+
+#include <glm/ext/vector_float4.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+constexpr uint32_t BINDLESS_TEXTURE_CAPACITY = 10000; // Descriptor count of the bindless texture binding.
+
+#pragma pack(push, 4)
+struct MaterialData
+{
+	glm::vec4 albedoColor = { 1, 1, 1, 1 };
+	uint32_t albedoTexIndex = 0;
+	uint32_t normalTexIndex = 0;
+	float padding[2];
+};
+#pragma pack(pop)
+
+struct BindlessStats
+{
+	uint32_t textureCount = 0;
+	uint32_t materialCount = 0;
+	uint32_t textureWrites = 0;		// Descriptors written by the last BeginFrame()
+	uint64_t materialUploadBytes = 0; // Bytes uploaded by the last BeginFrame()
+};
+
+/**
+ * Persistent bindless texture table and material storage buffer.
+ *
+ * There is one copy of the descriptor set/buffer per frame in flight. Changes are queued on every copy, and a copy is only brought up
+ * to date when its frame comes round again (so never while the GPU may be reading it). Per-frame cost is proportional to the changes,
+ * not to the number of textures/materials.
+ *
+ * Freed slots point back at the fallback texture, and are only reused once no in-flight frame can reference them.
+ *
+ * The sets are requested once in Init() and kept. A VkMana descriptor set is owned by its handle: it only goes back to its pool once
+ * the last handle is released (after the GPU is done with it), so holding the handles keeps the sets valid across frames.
+ */
+class BindlessTables
+{
+public:
+	explicit BindlessTables(VkMana::Context& ctx);
+	~BindlessTables() = default;
+
+	BindlessTables(const BindlessTables&) = delete;
+	auto operator=(const BindlessTables&) -> BindlessTables& = delete;
+
+	bool Init(const VkMana::SetLayoutHandle& textureSetLayout, const VkMana::SetLayoutHandle& materialSetLayout, const VkMana::ImageView* fallbackView);
+
+	auto AddTexture(const VkMana::ImageView* view) -> std::optional<uint32_t>;
+	void FreeTexture(uint32_t slot);
+
+	auto AddMaterial(const MaterialData& material) -> uint32_t;
+	void UpdateMaterial(uint32_t slot, const MaterialData& material);
+	void FreeMaterial(uint32_t slot);
+
+	/**
+	 * Call once per frame, before binding the sets. Moves on to the next copy and writes the changes it has not seen yet.
+	 */
+	void BeginFrame();
+
+	//////////////////////////////////////////////////
+	/// Getters
+	//////////////////////////////////////////////////
+
+	auto GetTextureSet() const -> const auto& { return m_frames[m_frameSlot].textureSet; }
+	auto GetMaterialSet() const -> const auto& { return m_frames[m_frameSlot].materialSet; }
+	auto GetStats() const -> const auto& { return m_stats; }
+
+private:
+	struct SlotAllocator
+	{
+		struct PendingFree
+		{
+			uint64_t frameIndex;
+			uint32_t slot;
+		};
+
+		uint32_t slotCount = 0; // High-water mark
+		std::vector<uint32_t> freeSlots;
+		std::vector<PendingFree> pendingFrees;
+
+		auto Allocate() -> uint32_t;
+		void Free(uint32_t slot, uint64_t frameIndex);
+		void Retire(uint64_t frameIndex);
+	};
+
+	struct FrameCopy
+	{
+		VkMana::DescriptorSetHandle textureSet = nullptr;
+		VkMana::DescriptorSetHandle materialSet = nullptr;
+		VkMana::BufferHandle materialBuffer = nullptr;
+		uint32_t materialCapacity = 0;
+		std::vector<uint32_t> dirtyTextures;
+		std::vector<uint32_t> dirtyMaterials;
+	};
+
+	void MarkTextureDirty(uint32_t slot);
+	void MarkMaterialDirty(uint32_t slot);
+	void FlushTextures(FrameCopy& frame);
+	void FlushMaterials(FrameCopy& frame);
+
+private:
+	VkMana::Context* m_ctx = nullptr;
+	VkMana::SetLayoutHandle m_textureSetLayout = nullptr;
+	VkMana::SetLayoutHandle m_materialSetLayout = nullptr;
+	const VkMana::ImageView* m_fallbackView = nullptr;
+
+	std::vector<const VkMana::ImageView*> m_textures;
+	std::vector<MaterialData> m_materials;
+	SlotAllocator m_textureSlots;
+	SlotAllocator m_materialSlots;
+
+	FrameCopy m_frames[FRAME_RING_FRAME_COUNT];
+	uint32_t m_frameSlot = 0;
+	uint64_t m_frameIndex = 0;
+
+	BindlessStats m_stats{};
+};
@@ -0,0 +1,102 @@
+#include "FrameRingBuffer.hpp"
+
+#include "Core/Logging.hpp"
+
+#include <algorithm>
+
+namespace
+{
+	/* Alignments are not necessarily powers of two (eg. structured buffer elements). */
+	inline auto AlignUp(uint64_t value, uint64_t alignment) -> uint64_t
+	{
+		return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+	}
+} // namespace
+
+FrameRingBuffer::FrameRingBuffer(VkMana::Context& ctx, vk::BufferUsageFlags usage, const char* name) : m_ctx(&ctx), m_usage(usage), m_name(name) {}
+
+bool FrameRingBuffer::Init(uint64_t frameCapacity)
+{
+	m_frameCapacity = 0;
+	if (!Grow(frameCapacity))
+		return false;
+
+	m_stats.growCount = 0;
+	return true;
+}
+
+bool FrameRingBuffer::BeginFrame(uint64_t reserveSize)
+{
+	m_segmentIndex = (m_segmentIndex + 1) % FRAME_RING_FRAME_COUNT;
+	m_segmentOffset = 0;
+	m_stats.frameUsage = 0;
+
+	const auto requiredSize = std::max(reserveSize, m_overflowSize);
+	m_overflowSize = 0;
+	if (requiredSize <= m_frameCapacity)
+		return false;
+
+	return Grow(requiredSize);
+}
+
+auto FrameRingBuffer::Allocate(uint64_t size, uint64_t alignment) -> std::optional<uint64_t>
+{
+	const auto segmentStart = m_frameCapacity * m_segmentIndex;
+	// Align the absolute offset, segments are only aligned to FRAME_RING_UNIFORM_ALIGNMENT.
+	const auto offset = AlignUp(segmentStart + m_segmentOffset, alignment);
+	if (offset + size > segmentStart + m_frameCapacity)
+	{
+		m_overflowSize = std::max(m_overflowSize, offset + size - segmentStart);
+		LOG_ERR("Frame ring buffer overflow: {} bytes requested, {} of {} bytes used", size, m_segmentOffset, m_frameCapacity);
+		return std::nullopt;
+	}
+
+	m_segmentOffset = offset + size - segmentStart;
+	m_stats.frameUsage = m_segmentOffset;
+	m_stats.peakFrameUsage = std::max(m_stats.peakFrameUsage, m_stats.frameUsage);
+	return offset;
+}
+
+auto FrameRingBuffer::Upload(const void* data, uint64_t size, uint64_t alignment) -> std::optional<uint64_t>
+{
+	const auto offset = Allocate(size, alignment);
+	if (offset && size > 0)
+		m_buffer->WriteHostAccessible(*offset, size, data);
+	return offset;
+}
+
+void FrameRingBuffer::LogStats() const
+{
+	constexpr auto KiB = 1024.0;
+	LOG_INFO("Frame ring buffer: {} x {:.1f} KiB, peak frame usage {:.1f} KiB, grown {} times",
+		FRAME_RING_FRAME_COUNT,
+		double(m_stats.capacity) / KiB,
+		double(m_stats.peakFrameUsage) / KiB,
+		m_stats.growCount);
+}
+
+bool FrameRingBuffer::Grow(uint64_t minFrameCapacity)
+{
+	const auto oldCapacity = m_frameCapacity;
+	const auto newCapacity = AlignUp(std::max(oldCapacity * 2, minFrameCapacity), FRAME_RING_UNIFORM_ALIGNMENT);
+
+	auto bufferInfo = VkMana::BufferCreateInfo::Uniform(newCapacity * FRAME_RING_FRAME_COUNT);
+	bufferInfo.Usage = m_usage;
+	auto newBuffer = m_ctx->CreateBuffer(bufferInfo);
+	if (!newBuffer)
+	{
+		LOG_ERR("Failed to create {} with {} bytes per frame", m_name, newCapacity);
+		return false;
+	}
+	m_ctx->SetName(*newBuffer, m_name);
+
+	// In-flight frames keep reading the old buffer, VkMana defers its destruction until they are done.
+	m_buffer = newBuffer;
+	m_frameCapacity = newCapacity;
+	m_stats.capacity = newCapacity;
+	++m_stats.growCount;
+
+	if (oldCapacity != 0)
+		LOG_WARN("Grew {}: {} -> {} bytes per frame", m_name, oldCapacity, newCapacity);
+	return true;
+}
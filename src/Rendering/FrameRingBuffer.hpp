@@ -0,0 +1,83 @@
+#pragma once
+
+#include <VkMana/Buffer.hpp>
+#include <VkMana/Context.hpp>
+
+#include <cstdint>
+#include <optional>
+
+constexpr uint32_t FRAME_RING_FRAME_COUNT = 3; // Frames in flight, plus the one being recorded.
+constexpr uint64_t FRAME_RING_UNIFORM_ALIGNMENT = 256; // Largest minUniformBufferOffsetAlignment allowed by the spec.
+
+struct FrameRingStats
+{
+	uint64_t capacity = 0;		// Bytes per frame
+	uint64_t frameUsage = 0;	// Bytes allocated by the current frame
+	uint64_t peakFrameUsage = 0; // Largest `frameUsage` seen
+	uint32_t growCount = 0;
+};
+
+/**
+ * Persistent, host-visible buffer for transient per-frame data (uniforms, instance data, indirect draw commands).
+ * The buffer is split into one segment per frame in flight, segments are reused in order, so a frame never overwrites data the GPU may
+ * still be reading. Within a frame, allocations are linear.
+ *
+ * The buffer (and so every descriptor pointing at it) stays the same across frames. Per-frame data is addressed with dynamic offsets.
+ * With transfer-source usage, the same scheme serves as a staging ring for uploads.
+ */
+class FrameRingBuffer
+{
+public:
+	explicit FrameRingBuffer(VkMana::Context& ctx,
+		vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+		const char* name = "frame_ring_buffer");
+	~FrameRingBuffer() = default;
+
+	FrameRingBuffer(const FrameRingBuffer&) = delete;
+	auto operator=(const FrameRingBuffer&) -> FrameRingBuffer& = delete;
+
+	bool Init(uint64_t frameCapacity);
+
+	/**
+	 * Call once per frame, before allocating. Moves on to the next frame's segment.
+	 * `reserveSize` is the frame's expected usage (alignment padding included). If it does not fit in a segment, the buffer is
+	 * reallocated with larger segments.
+	 * @return True if the buffer was reallocated, descriptors referencing it must be rewritten.
+	 */
+	bool BeginFrame(uint64_t reserveSize);
+
+	/**
+	 * Allocates `size` bytes from the current frame's segment.
+	 * @return Offset from the start of the buffer, or nothing if the segment is full. The next BeginFrame() grows to fit.
+	 */
+	auto Allocate(uint64_t size, uint64_t alignment) -> std::optional<uint64_t>;
+	/**
+	 * Allocates and copies `data` into the current frame's segment.
+	 */
+	auto Upload(const void* data, uint64_t size, uint64_t alignment) -> std::optional<uint64_t>;
+
+	void LogStats() const;
+
+	//////////////////////////////////////////////////
+	/// Getters
+	//////////////////////////////////////////////////
+
+	auto GetBuffer() const -> const auto& { return m_buffer; }
+	auto GetStats() const -> const auto& { return m_stats; }
+
+private:
+	bool Grow(uint64_t minFrameCapacity);
+
+private:
+	VkMana::Context* m_ctx = nullptr;
+	vk::BufferUsageFlags m_usage;
+	const char* m_name = nullptr;
+
+	VkMana::BufferHandle m_buffer = nullptr;
+	uint64_t m_frameCapacity = 0;
+	uint32_t m_segmentIndex = 0;
+	uint64_t m_segmentOffset = 0; // Next free byte, relative to the segment start
+	uint64_t m_overflowSize = 0;  // Requested size that did not fit last frame
+
+	FrameRingStats m_stats{};
+};
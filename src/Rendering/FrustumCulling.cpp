@@ -0,0 +1,186 @@
+#include "FrustumCulling.hpp"
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define GS_CULL_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define GS_CULL_SSE 1
+#endif
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+namespace
+{
+	constexpr size_t CULL_SIMD_WIDTH = 8; // Padding of the SoA arrays. Covers both the SSE and AVX paths.
+
+	inline auto GetRow(const glm::mat4& m, int row) -> glm::vec4
+	{
+		return { m[0][row], m[1][row], m[2][row], m[3][row] };
+	}
+
+	inline auto NormalizePlane(const glm::vec4& plane) -> glm::vec4
+	{
+		return plane / glm::length(glm::vec3(plane));
+	}
+
+	inline auto CountTrailingZeros(uint32_t value) -> uint32_t
+	{
+#if defined(_MSC_VER)
+		unsigned long index = 0;
+		_BitScanForward(&index, value);
+		return uint32_t(index);
+#else
+		return uint32_t(__builtin_ctz(value));
+#endif
+	}
+
+	/* Appends the lane indices set in `mask` to `outVisible`, starting from `base`. */
+	inline void AppendVisible(uint32_t mask, uint32_t base, size_t count, uint32_t*& outVisible)
+	{
+		while (mask != 0)
+		{
+			const auto lane = CountTrailingZeros(mask);
+			if (base + lane < count)
+				*outVisible++ = base + lane;
+			mask &= mask - 1;
+		}
+	}
+} // namespace
+
+auto Frustum::FromMatrix(const glm::mat4& viewProjMatrix) -> Frustum
+{
+	const auto row0 = GetRow(viewProjMatrix, 0);
+	const auto row1 = GetRow(viewProjMatrix, 1);
+	const auto row2 = GetRow(viewProjMatrix, 2);
+	const auto row3 = GetRow(viewProjMatrix, 3);
+
+	Frustum frustum{};
+	frustum.planes[0] = NormalizePlane(row3 + row0); // Left
+	frustum.planes[1] = NormalizePlane(row3 - row0); // Right
+	frustum.planes[2] = NormalizePlane(row3 + row1); // Bottom
+	frustum.planes[3] = NormalizePlane(row3 - row1); // Top
+	frustum.planes[4] = NormalizePlane(row2);		 // Near (0..1 depth)
+	frustum.planes[5] = NormalizePlane(row3 - row2); // Far
+	return frustum;
+}
+
+void CullingSpheres::Clear()
+{
+	m_count = 0;
+}
+
+void CullingSpheres::Add(const glm::vec3& center, float radius)
+{
+	if (m_count == m_centerX.size())
+	{
+		const auto newSize = m_centerX.size() + std::max(CULL_SIMD_WIDTH, m_centerX.size());
+		m_centerX.resize(newSize, 0.0f);
+		m_centerY.resize(newSize, 0.0f);
+		m_centerZ.resize(newSize, 0.0f);
+		m_radius.resize(newSize, 0.0f);
+	}
+
+	m_centerX[m_count] = center.x;
+	m_centerY[m_count] = center.y;
+	m_centerZ[m_count] = center.z;
+	m_radius[m_count] = radius;
+	++m_count;
+}
+
+auto CullSpheres(const Frustum& frustum, const CullingSpheres& spheres, std::vector<uint32_t>& outVisible) -> size_t
+{
+	const auto count = spheres.m_count;
+	outVisible.resize(count);
+	if (count == 0)
+		return 0;
+
+	const auto* centerX = spheres.m_centerX.data();
+	const auto* centerY = spheres.m_centerY.data();
+	const auto* centerZ = spheres.m_centerZ.data();
+	const auto* radius = spheres.m_radius.data();
+	auto* visible = outVisible.data();
+
+	// A sphere is visible unless it lies fully behind one of the planes: dot(n, c) + d < -r.
+#if defined(GS_CULL_AVX)
+	__m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (auto p = 0; p < 6; ++p)
+	{
+		planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+	}
+
+	const auto zero = _mm256_setzero_ps();
+	for (size_t i = 0; i < count; i += 8)
+	{
+		const auto x = _mm256_loadu_ps(centerX + i);
+		const auto y = _mm256_loadu_ps(centerY + i);
+		const auto z = _mm256_loadu_ps(centerZ + i);
+		const auto negRadius = _mm256_sub_ps(zero, _mm256_loadu_ps(radius + i));
+
+		auto inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (auto p = 0; p < 6; ++p)
+		{
+			auto distance = _mm256_add_ps(_mm256_mul_ps(planeX[p], x), planeW[p]);
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(planeY[p], y));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(planeZ[p], z));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+		}
+
+		AppendVisible(uint32_t(_mm256_movemask_ps(inside)), uint32_t(i), count, visible);
+	}
+#elif defined(GS_CULL_SSE)
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (auto p = 0; p < 6; ++p)
+	{
+		planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+	}
+
+	const auto zero = _mm_setzero_ps();
+	for (size_t i = 0; i < count; i += 4)
+	{
+		const auto x = _mm_loadu_ps(centerX + i);
+		const auto y = _mm_loadu_ps(centerY + i);
+		const auto z = _mm_loadu_ps(centerZ + i);
+		const auto negRadius = _mm_sub_ps(zero, _mm_loadu_ps(radius + i));
+
+		auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (auto p = 0; p < 6; ++p)
+		{
+			auto distance = _mm_add_ps(_mm_mul_ps(planeX[p], x), planeW[p]);
+			distance = _mm_add_ps(distance, _mm_mul_ps(planeY[p], y));
+			distance = _mm_add_ps(distance, _mm_mul_ps(planeZ[p], z));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+		}
+
+		AppendVisible(uint32_t(_mm_movemask_ps(inside)), uint32_t(i), count, visible);
+	}
+#else
+	for (size_t i = 0; i < count; ++i)
+	{
+		auto inside = true;
+		for (auto p = 0; p < 6 && inside; ++p)
+		{
+			const auto& plane = frustum.planes[p];
+			inside = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w >= -radius[i];
+		}
+		if (inside)
+			*visible++ = uint32_t(i);
+	}
+#endif
+
+	const auto visibleCount = size_t(visible - outVisible.data());
+	outVisible.resize(visibleCount);
+	return visibleCount;
+}
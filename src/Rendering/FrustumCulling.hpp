@@ -0,0 +1,54 @@
+#pragma once
+
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Normalized planes (xyz = inward normal, w = distance) of a view frustum.
+ */
+struct Frustum
+{
+	glm::vec4 planes[6];
+
+	/**
+	 * Extracts the planes of a Direct3D-style (0..1 depth) view-projection matrix (Gribb & Hartmann).
+	 */
+	static auto FromMatrix(const glm::mat4& viewProjMatrix) -> Frustum;
+};
+
+/**
+ * World-space bounding spheres stored as SoA, so the cull loop can test 4 (SSE) or 8 (AVX) spheres at a time.
+ * The arrays are padded with empty spheres up to a multiple of the SIMD width.
+ */
+class CullingSpheres
+{
+public:
+	void Clear();
+	void Add(const glm::vec3& center, float radius);
+
+	//////////////////////////////////////////////////
+	/// Getters
+	//////////////////////////////////////////////////
+
+	auto GetCount() const -> size_t { return m_count; }
+
+private:
+	friend auto CullSpheres(const Frustum& frustum, const CullingSpheres& spheres, std::vector<uint32_t>& outVisible) -> size_t;
+
+	size_t m_count = 0;
+	std::vector<float> m_centerX;
+	std::vector<float> m_centerY;
+	std::vector<float> m_centerZ;
+	std::vector<float> m_radius;
+};
+
+/**
+ * Writes the indices of the spheres intersecting the frustum to `outVisible` (in ascending order), and returns their count.
+ * Uses AVX when compiled with it (GS_ENABLE_AVX), otherwise SSE, with a scalar fallback for other architectures.
+ */
+auto CullSpheres(const Frustum& frustum, const CullingSpheres& spheres, std::vector<uint32_t>& outVisible) -> size_t;
@@ -0,0 +1,226 @@
+#include "GeometryBuffer.hpp"
+
+#include "Core/Logging.hpp"
+
+#include <algorithm>
+
+constexpr uint64_t GEOMETRY_FREE_LATENCY = 3; // Frames in flight, plus the one being recorded.
+
+namespace
+{
+	/*
+	 * Makes the transfer writes recorded so far (in this and earlier submissions on the queue) available to `dstStage`.
+	 * Submission order alone does not order memory accesses.
+	 */
+	void TransferWriteBarrier(vk::CommandBuffer cmd, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess)
+	{
+		const vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite, dstAccess);
+		cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, dstStage, {}, barrier, {}, {});
+	}
+} // namespace
+
+GeometryBuffer::GeometryBuffer(VkMana::Context& ctx)
+	: m_ctx(&ctx), m_stagingRing(ctx, vk::BufferUsageFlagBits::eTransferSrc, "geometry_staging_ring")
+{
+}
+
+bool GeometryBuffer::Init(uint64_t vertexCapacity, uint64_t indexCapacity, uint64_t uploadBudget)
+{
+	m_vertexArena.buffer = CreateArenaBuffer(false, vertexCapacity);
+	m_indexArena.buffer = CreateArenaBuffer(true, indexCapacity);
+	if (!m_vertexArena.buffer || !m_indexArena.buffer)
+	{
+		LOG_ERR("Failed to create geometry buffers");
+		return false;
+	}
+	if (!m_stagingRing.Init(uploadBudget))
+		return false;
+
+	m_ctx->SetName(*m_vertexArena.buffer, "geometry_vertices");
+	m_ctx->SetName(*m_indexArena.buffer, "geometry_indices");
+	m_vertexArena.allocator = RangeAllocator(vertexCapacity);
+	m_indexArena.allocator = RangeAllocator(indexCapacity);
+	m_indexArena.isIndexBuffer = true;
+	m_uploadBudget = uploadBudget;
+	return true;
+}
+
+auto GeometryBuffer::AllocateVertices(const void* data, uint64_t size, uint32_t vertexStride, uint64_t* outUploadEnd)
+	-> std::optional<RangeAllocation>
+{
+	return Allocate(m_vertexArena, data, size, vertexStride, outUploadEnd);
+}
+
+auto GeometryBuffer::AllocateIndices(const uint16_t* indices, size_t indexCount, uint64_t* outUploadEnd) -> std::optional<RangeAllocation>
+{
+	return Allocate(m_indexArena, indices, sizeof(uint16_t) * indexCount, sizeof(uint16_t), outUploadEnd);
+}
+
+void GeometryBuffer::FreeVertices(const RangeAllocation& allocation)
+{
+	std::lock_guard lock(m_mutex);
+	m_vertexArena.pendingFrees.push_back({ m_frameIndex, allocation });
+}
+
+void GeometryBuffer::FreeIndices(const RangeAllocation& allocation)
+{
+	std::lock_guard lock(m_mutex);
+	m_indexArena.pendingFrees.push_back({ m_frameIndex, allocation });
+}
+
+void GeometryBuffer::ProcessUploads(uint64_t budget)
+{
+	std::lock_guard lock(m_mutex);
+	m_uploadStats.frameUploadBytes = 0;
+
+	for (auto* arena : { &m_vertexArena, &m_indexArena })
+	{
+		if (arena->buffer->GetSize() < arena->allocator.GetCapacity() && !GrowBuffer(*arena))
+			return; // Queued ranges may lie past the end of the buffer
+	}
+
+	const auto frameBudget = std::min(budget, m_uploadBudget);
+	if (m_uploads.empty() || frameBudget == 0)
+		return;
+
+	// Copies are queued in order, a later upload to a reused range always lands after an earlier one.
+	m_stagingRing.BeginFrame(m_uploadBudget);
+	auto* stagingBuffer = m_stagingRing.GetBuffer().Get();
+	auto cmd = m_ctx->RequestCmd();
+	uint64_t frameBytes = 0;
+	while (!m_uploads.empty() && frameBytes < frameBudget)
+	{
+		auto& upload = m_uploads.front();
+		const auto chunkSize = std::min(uint64_t(upload.data.size()) - upload.uploadedSize, frameBudget - frameBytes);
+		const auto stagingOffset = m_stagingRing.Upload(upload.data.data() + upload.uploadedSize, chunkSize, 1);
+		if (!stagingOffset)
+			break;
+
+		cmd->CopyBuffer(upload.arena->buffer.Get(), upload.dstOffset + upload.uploadedSize, stagingBuffer, *stagingOffset, chunkSize);
+		upload.uploadedSize += chunkSize;
+		frameBytes += chunkSize;
+		if (upload.uploadedSize == upload.data.size())
+			m_uploads.pop_front();
+	}
+	TransferWriteBarrier(cmd->GetCmd(),
+		vk::PipelineStageFlagBits::eVertexInput,
+		vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead);
+	m_ctx->Submit(cmd);
+
+	m_uploadStats.frameUploadBytes = frameBytes;
+	m_uploadStats.pendingUploadBytes -= frameBytes;
+	m_uploadedBytes.fetch_add(frameBytes, std::memory_order_release);
+}
+
+void GeometryBuffer::NewFrame()
+{
+	std::lock_guard lock(m_mutex);
+	++m_frameIndex;
+
+	for (auto* arena : { &m_vertexArena, &m_indexArena })
+	{
+		auto& pendingFrees = arena->pendingFrees;
+		const auto it = std::partition(pendingFrees.begin(), pendingFrees.end(), [this](const PendingFree& pendingFree) {
+			return pendingFree.frameIndex + GEOMETRY_FREE_LATENCY > m_frameIndex;
+		});
+		for (auto freeIt = it; freeIt != pendingFrees.end(); ++freeIt)
+			arena->allocator.Free(freeIt->allocation);
+		pendingFrees.erase(it, pendingFrees.end());
+	}
+}
+
+auto GeometryBuffer::GetVertexStats() const -> RangeAllocatorStats
+{
+	std::lock_guard lock(m_mutex);
+	return m_vertexArena.allocator.GetStats();
+}
+
+auto GeometryBuffer::GetIndexStats() const -> RangeAllocatorStats
+{
+	std::lock_guard lock(m_mutex);
+	return m_indexArena.allocator.GetStats();
+}
+
+auto GeometryBuffer::GetUploadStats() const -> GeometryUploadStats
+{
+	std::lock_guard lock(m_mutex);
+	return m_uploadStats;
+}
+
+void GeometryBuffer::LogStats() const
+{
+	constexpr auto MiB = 1024.0 * 1024.0;
+	const auto logArena = [](const char* name, const RangeAllocatorStats& stats) {
+		LOG_INFO("Geometry {}: {:.2f} / {:.2f} MiB used, {} allocations, {} free blocks (largest {:.2f} MiB), fragmentation {:.1f}%",
+			name,
+			double(stats.usedSize) / MiB,
+			double(stats.capacity) / MiB,
+			stats.allocationCount,
+			stats.freeBlockCount,
+			double(stats.largestFreeBlock) / MiB,
+			stats.GetFragmentation() * 100.0f);
+	};
+	logArena("vertices", GetVertexStats());
+	logArena("indices", GetIndexStats());
+}
+
+auto GeometryBuffer::CreateArenaBuffer(bool isIndexBuffer, uint64_t capacity) const -> VkMana::BufferHandle
+{
+	auto bufferInfo = isIndexBuffer ? VkMana::BufferCreateInfo::Index(capacity) : VkMana::BufferCreateInfo::Vertex(capacity);
+	// Sub-ranges are written by transfer, and the old buffer is copied from when growing.
+	bufferInfo.Usage |= vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc;
+	return m_ctx->CreateBuffer(bufferInfo);
+}
+
+auto GeometryBuffer::Allocate(Arena& arena, const void* data, uint64_t size, uint64_t alignment, uint64_t* outUploadEnd)
+	-> std::optional<RangeAllocation>
+{
+	std::lock_guard lock(m_mutex);
+	auto allocation = arena.allocator.Allocate(size, alignment);
+	if (!allocation)
+	{
+		// Only the allocator grows here, the buffer follows in the next ProcessUploads(). Nothing reads the new range before then.
+		const auto oldCapacity = arena.allocator.GetCapacity();
+		arena.allocator.Grow(std::max(oldCapacity * 2, oldCapacity + size + alignment));
+		allocation = arena.allocator.Allocate(size, alignment);
+		if (!allocation)
+			return std::nullopt;
+	}
+
+	const auto* bytes = static_cast<const uint8_t*>(data);
+	m_uploads.push_back({ &arena, allocation->offset, std::vector<uint8_t>(bytes, bytes + size) });
+	m_queuedBytes += size;
+	m_uploadStats.pendingUploadBytes += size;
+	if (outUploadEnd)
+		*outUploadEnd = m_queuedBytes;
+	return allocation;
+}
+
+bool GeometryBuffer::GrowBuffer(Arena& arena)
+{
+	const auto oldCapacity = arena.buffer->GetSize();
+	const auto newCapacity = arena.allocator.GetCapacity();
+
+	auto newBuffer = CreateArenaBuffer(arena.isIndexBuffer, newCapacity);
+	if (!newBuffer)
+	{
+		LOG_ERR("Failed to grow geometry {} buffer to {} bytes", arena.isIndexBuffer ? "index" : "vertex", newCapacity);
+		return false;
+	}
+	m_ctx->SetName(*newBuffer, arena.isIndexBuffer ? "geometry_indices" : "geometry_vertices");
+
+	// The old buffer handle stays alive until the GPU is done with it (VkMana defers the destruction).
+	// Earlier uploads to the old buffer must land before it is copied, and the copy before later uploads to the same ranges.
+	auto cmd = m_ctx->RequestCmd();
+	TransferWriteBarrier(cmd->GetCmd(), vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead);
+	cmd->CopyBuffer(newBuffer.Get(), 0, arena.buffer.Get(), 0, oldCapacity);
+	TransferWriteBarrier(cmd->GetCmd(),
+		vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eVertexInput,
+		vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead);
+	m_ctx->Submit(cmd);
+
+	arena.buffer = newBuffer;
+
+	LOG_WARN("Grew geometry {} buffer: {} -> {} bytes", arena.isIndexBuffer ? "index" : "vertex", oldCapacity, newCapacity);
+	return true;
+}
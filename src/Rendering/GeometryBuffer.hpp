@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Core/RangeAllocator.hpp"
+#include "FrameRingBuffer.hpp"
+
+#include <VkMana/Buffer.hpp>
+#include <VkMana/Context.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+struct GeometryUploadStats
+{
+	uint64_t frameUploadBytes = 0; // Copied by the last ProcessUploads()
+	uint64_t pendingUploadBytes = 0;
+};
+
+/**
+ * Renderer-owned vertex and index arenas that all meshes are sub-allocated from, so the whole scene draws from one vertex/index buffer
+ * pair instead of a GPU allocation (and buffer bind) per mesh.
+ *
+ * Frees are deferred until the GPU can no longer be reading the range. An arena that runs out of space is reallocated at twice the size,
+ * existing allocations keep their offsets.
+ *
+ * Allocating only queues the data. ProcessUploads() copies at most `uploadBudget` bytes of it per frame to the arenas, through a
+ * staging ring, so loading a large scene is spread over frames instead of stalling one. Large uploads are split across frames.
+ * A range may only be drawn from once IsUploaded() returns true for it.
+ *
+ * Allocating and freeing are thread-safe (eg. from the main thread or loading jobs). The GPU buffers are only touched by
+ * ProcessUploads() and NewFrame(), on the thread recording frames.
+ */
+class GeometryBuffer
+{
+public:
+	explicit GeometryBuffer(VkMana::Context& ctx);
+	~GeometryBuffer() = default;
+
+	GeometryBuffer(const GeometryBuffer&) = delete;
+	auto operator=(const GeometryBuffer&) -> GeometryBuffer& = delete;
+
+	bool Init(uint64_t vertexCapacity, uint64_t indexCapacity, uint64_t uploadBudget);
+
+	/**
+	 * Allocates a range and queues `data` to be uploaded to it (the data is copied).
+	 * Offsets are aligned to `vertexStride`, so `offset / vertexStride` can be used as the draw's vertex offset.
+	 * @param outUploadEnd Position of the upload in the queue, for IsUploaded().
+	 */
+	auto AllocateVertices(const void* data, uint64_t size, uint32_t vertexStride, uint64_t* outUploadEnd = nullptr) -> std::optional<RangeAllocation>;
+	auto AllocateIndices(const uint16_t* indices, size_t indexCount, uint64_t* outUploadEnd = nullptr) -> std::optional<RangeAllocation>;
+	void FreeVertices(const RangeAllocation& allocation);
+	void FreeIndices(const RangeAllocation& allocation);
+
+	/**
+	 * Call once per frame, before recording draws. Grows the GPU buffers if allocations outgrew them, then copies the next
+	 * `budget` bytes of queued data (at most the `uploadBudget` given to Init()).
+	 */
+	void ProcessUploads(uint64_t budget);
+	/**
+	 * True once every upload queued up to `uploadEnd` has been submitted. Draws submitted afterwards see the data.
+	 */
+	bool IsUploaded(uint64_t uploadEnd) const { return m_uploadedBytes.load(std::memory_order_acquire) >= uploadEnd; }
+	/**
+	 * Call once per frame. Releases ranges freed more than `GEOMETRY_FREE_LATENCY` frames ago.
+	 */
+	void NewFrame();
+
+	void LogStats() const;
+
+	//////////////////////////////////////////////////
+	/// Getters
+	//////////////////////////////////////////////////
+
+	auto GetVertexBuffer() const -> const auto& { return m_vertexArena.buffer; }
+	auto GetIndexBuffer() const -> const auto& { return m_indexArena.buffer; }
+	auto GetVertexStats() const -> RangeAllocatorStats;
+	auto GetIndexStats() const -> RangeAllocatorStats;
+	auto GetUploadStats() const -> GeometryUploadStats;
+
+private:
+	struct PendingFree
+	{
+		uint64_t frameIndex;
+		RangeAllocation allocation;
+	};
+	struct Arena
+	{
+		VkMana::BufferHandle buffer = nullptr; // May be smaller than the allocator until the next ProcessUploads()
+		RangeAllocator allocator;
+		std::vector<PendingFree> pendingFrees;
+		bool isIndexBuffer = false;
+	};
+	struct PendingUpload
+	{
+		Arena* arena;
+		uint64_t dstOffset;
+		std::vector<uint8_t> data;
+		uint64_t uploadedSize = 0; // Bytes already copied, when split across frames
+	};
+
+	auto CreateArenaBuffer(bool isIndexBuffer, uint64_t capacity) const -> VkMana::BufferHandle;
+	auto Allocate(Arena& arena, const void* data, uint64_t size, uint64_t alignment, uint64_t* outUploadEnd) -> std::optional<RangeAllocation>;
+	bool GrowBuffer(Arena& arena);
+
+private:
+	VkMana::Context* m_ctx = nullptr;
+
+	mutable std::mutex m_mutex; // Guards everything below, except the buffers and the staging ring (ProcessUploads() thread only)
+	Arena m_vertexArena;
+	Arena m_indexArena;
+	uint64_t m_frameIndex = 0;
+
+	FrameRingBuffer m_stagingRing;
+	uint64_t m_uploadBudget = 0; // Bytes per frame
+	std::deque<PendingUpload> m_uploads;
+	uint64_t m_queuedBytes = 0; // Since Init(), the upload ids handed out by Allocate*()
+	std::atomic<uint64_t> m_uploadedBytes = 0;
+	GeometryUploadStats m_uploadStats{};
+};
@@ -0,0 +1,131 @@
+#include "GpuFrameTimer.hpp"
+
+#include "Core/Logging.hpp"
+
+#include <algorithm>
+#include <vector>
+
+GpuFrameTimer::~GpuFrameTimer()
+{
+	Shutdown();
+}
+
+bool GpuFrameTimer::Init(vk::PhysicalDevice physicalDevice, vk::Device device)
+{
+	m_device = device;
+
+	const auto properties = physicalDevice.getProperties();
+	if (!properties.limits.timestampComputeAndGraphics || properties.limits.timestampPeriod <= 0.0f)
+	{
+		LOG_WARN("GPU timestamps are not supported, GPU frame times will not be available");
+		return false;
+	}
+	m_timestampPeriodNs = properties.limits.timestampPeriod;
+
+	vk::QueryPoolCreateInfo poolInfo{};
+	poolInfo.setQueryType(vk::QueryType::eTimestamp);
+	poolInfo.setQueryCount(FRAME_RING_FRAME_COUNT * GPU_TIMER_MAX_ZONES * 2);
+	const auto result = m_device.createQueryPool(&poolInfo, nullptr, &m_queryPool);
+	if (result != vk::Result::eSuccess)
+	{
+		LOG_ERR("Failed to create timestamp query pool: {}", vk::to_string(result));
+		m_queryPool = nullptr;
+		return false;
+	}
+	return true;
+}
+
+void GpuFrameTimer::Shutdown()
+{
+	if (m_queryPool)
+		m_device.destroyQueryPool(m_queryPool);
+	m_queryPool = nullptr;
+}
+
+void GpuFrameTimer::BeginFrame(vk::CommandBuffer cmd)
+{
+	if (!m_queryPool)
+		return;
+
+	m_frameIndex = (m_frameIndex + 1) % FRAME_RING_FRAME_COUNT;
+	auto& slot = m_slots[m_frameIndex];
+	if (slot.isPending)
+		ResolveFrame(m_frameIndex);
+
+	const auto firstQuery = m_frameIndex * GPU_TIMER_MAX_ZONES * 2;
+	cmd.resetQueryPool(m_queryPool, firstQuery, GPU_TIMER_MAX_ZONES * 2);
+	slot.zoneCount.store(0, std::memory_order_relaxed);
+	BeginZone(cmd, "MainPass"); // Zone 0, the frame time
+}
+
+void GpuFrameTimer::EndFrame(vk::CommandBuffer cmd)
+{
+	if (!m_queryPool)
+		return;
+
+	EndZone(cmd, 0);
+	auto& slot = m_slots[m_frameIndex];
+	slot.isPending = true;
+#ifdef GS_PROFILER_ENABLED
+	slot.submitTimeNs = Profiler::Get().Now();
+#endif
+}
+
+auto GpuFrameTimer::BeginZone(vk::CommandBuffer cmd, const char* name) -> uint32_t
+{
+	if (!m_queryPool)
+		return ~0u;
+
+	auto& slot = m_slots[m_frameIndex];
+	const auto zone = slot.zoneCount.fetch_add(1, std::memory_order_relaxed);
+	if (zone >= GPU_TIMER_MAX_ZONES)
+		return ~0u;
+
+	slot.zoneNames[zone] = name;
+	cmd.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, m_queryPool, (m_frameIndex * GPU_TIMER_MAX_ZONES + zone) * 2);
+	return zone;
+}
+
+void GpuFrameTimer::EndZone(vk::CommandBuffer cmd, uint32_t zone)
+{
+	if (!m_queryPool || zone >= GPU_TIMER_MAX_ZONES)
+		return;
+
+	cmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, m_queryPool, (m_frameIndex * GPU_TIMER_MAX_ZONES + zone) * 2 + 1);
+}
+
+void GpuFrameTimer::ResolveFrame(uint32_t slotIndex)
+{
+	auto& slot = m_slots[slotIndex];
+	slot.isPending = false;
+
+	/* The frame that used this slot has retired (same assumption as the frame ring buffer), so this should never have to wait. */
+	const auto zoneCount = std::min(slot.zoneCount.load(std::memory_order_relaxed), GPU_TIMER_MAX_ZONES);
+	std::vector<uint64_t> timestamps(zoneCount * 2);
+	const auto result = m_device.getQueryPoolResults(m_queryPool,
+		slotIndex * GPU_TIMER_MAX_ZONES * 2,
+		zoneCount * 2,
+		timestamps.size() * sizeof(uint64_t),
+		timestamps.data(),
+		sizeof(uint64_t),
+		vk::QueryResultFlagBits::e64);
+	if (result != vk::Result::eSuccess)
+		return;
+
+	const auto ToNs = [this](uint64_t ticks) { return uint64_t(double(ticks) * m_timestampPeriodNs); };
+	m_lastTimeMs = double(ToNs(timestamps[1] - timestamps[0])) / 1000000.0;
+
+#ifdef GS_PROFILER_ENABLED
+	// GPU and CPU clocks are not calibrated against each other. The frame is placed so it ends when it was submitted, which keeps the
+	// GPU track next to the CPU work that produced it. Durations and the spacing of zones within the frame are exact.
+	std::vector<ProfileZone> zones(zoneCount);
+	const auto frameStartNs = slot.submitTimeNs - std::min(slot.submitTimeNs, ToNs(timestamps[1] - timestamps[0]));
+	for (auto i = 0u; i < zoneCount; ++i)
+	{
+		zones[i].name = slot.zoneNames[i];
+		zones[i].startNs = frameStartNs + ToNs(timestamps[i * 2] - timestamps[0]);
+		zones[i].endNs = frameStartNs + ToNs(timestamps[i * 2 + 1] - timestamps[0]);
+	}
+	Profiler::Get().AddGpuZones(zones);
+#endif
+}
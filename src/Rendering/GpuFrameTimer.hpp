@@ -0,0 +1,106 @@
+#pragma once
+
+#include "FrameRingBuffer.hpp"
+
+#include "Core/Profiler.hpp"
+
+#include <VkMana/Context.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+constexpr uint32_t GPU_TIMER_MAX_ZONES = 64; // Per frame, including the main pass itself
+
+/**
+ * Records a GPU zone around the scope's commands. Compiles to nothing unless GS_PROFILER_ENABLED is defined.
+ */
+#ifdef GS_PROFILER_ENABLED
+	#define PROFILE_GPU_SCOPE(timer, cmd, name) const GpuProfileScope GS_PROFILE_CONCAT(gpuProfileScope, __LINE__)(timer, cmd, name)
+#else
+	#define PROFILE_GPU_SCOPE(timer, cmd, name)
+#endif
+
+/**
+ * Measures the GPU time of each frame's main pass with a pair of timestamp queries, plus any named zones within it (see
+ * PROFILE_GPU_SCOPE()). Zones are forwarded to the Profiler.
+ *
+ * Results are read back without waiting, when the frame's query slot is reused FRAME_RING_FRAME_COUNT frames later, so the reported
+ * time always belongs to an earlier frame.
+ */
+class GpuFrameTimer
+{
+public:
+	GpuFrameTimer() = default;
+	~GpuFrameTimer();
+
+	GpuFrameTimer(const GpuFrameTimer&) = delete;
+	auto operator=(const GpuFrameTimer&) -> GpuFrameTimer& = delete;
+
+	/**
+	 * Returns false if the device cannot write timestamps from graphics queues. The timer is then a no-op.
+	 */
+	bool Init(vk::PhysicalDevice physicalDevice, vk::Device device);
+	void Shutdown();
+
+	/**
+	 * Resolves the results of the frame previously using this slot, then writes the start timestamp. Must be recorded outside a render pass.
+	 */
+	void BeginFrame(vk::CommandBuffer cmd);
+	void EndFrame(vk::CommandBuffer cmd);
+
+	/**
+	 * Zones can be begun from any thread recording the frame. Returns the zone to end, or ~0u when the frame is out of zones.
+	 */
+	auto BeginZone(vk::CommandBuffer cmd, const char* name) -> uint32_t;
+	void EndZone(vk::CommandBuffer cmd, uint32_t zone);
+
+	//////////////////////////////////////////////////
+	/// Getters
+	//////////////////////////////////////////////////
+
+	bool IsSupported() const { return m_queryPool; }
+	/* Time of the most recently resolved frame, negative until one has been resolved. */
+	auto GetLastTimeMs() const -> double { return m_lastTimeMs; }
+
+private:
+	struct FrameSlot
+	{
+		bool isPending = false; // Has timestamps written that were not read yet
+		std::atomic<uint32_t> zoneCount = 0;
+		std::array<const char*, GPU_TIMER_MAX_ZONES> zoneNames{};
+		uint64_t submitTimeNs = 0; // Profiler time, anchors the GPU zones on the trace's timeline
+	};
+
+	void ResolveFrame(uint32_t slotIndex);
+
+private:
+	vk::Device m_device = nullptr;
+	vk::QueryPool m_queryPool = nullptr;
+	double m_timestampPeriodNs = 0.0;
+
+	uint32_t m_frameIndex = 0;
+	std::array<FrameSlot, FRAME_RING_FRAME_COUNT> m_slots;
+	double m_lastTimeMs = -1.0;
+};
+
+/**
+ * Use through PROFILE_GPU_SCOPE().
+ */
+class GpuProfileScope
+{
+public:
+	GpuProfileScope(GpuFrameTimer& timer, vk::CommandBuffer cmd, const char* name)
+		: m_timer(timer), m_cmd(cmd), m_zone(timer.BeginZone(cmd, name))
+	{
+	}
+	~GpuProfileScope() { m_timer.EndZone(m_cmd, m_zone); }
+
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	auto operator=(const GpuProfileScope&) -> GpuProfileScope& = delete;
+
+private:
+	GpuFrameTimer& m_timer;
+	vk::CommandBuffer m_cmd;
+	uint32_t m_zone;
+};
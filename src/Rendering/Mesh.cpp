@@ -1,14 +1,24 @@
 #include "Mesh.hpp"
 
+#include "AssetRegistry.hpp"
+#include "Core/Hash.hpp"
+#include "Core/JobSystem.hpp"
 #include "Core/Logging.hpp"
+#include "Core/Profiler.hpp"
+#include "MeshCache.hpp"
+#include "MeshOptimizer.hpp"
 #include "Vertex.hpp"
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+
 constexpr auto MESH_IMPORT_FLAGS = aiProcessPreset_TargetRealtime_Quality;
 
 namespace
@@ -17,14 +27,66 @@ namespace
 	{
 		return glm::transpose(glm::make_mat4(&m.a1));
 	}
+
+	/* Identifies everything that affects the import output, so cooked meshes are re-cooked when it changes. */
+	inline auto GetImportKey(const MeshImportOptions& options) -> uint64_t
+	{
+		return HashCombine(HashCombine(HASH_FNV1A_OFFSET, uint32_t(MESH_IMPORT_FLAGS)), options.GetKey());
+	}
+
+	inline auto GetVertexStride(VertexFormat format) -> uint32_t
+	{
+		return format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+	}
 } // namespace
 
-Mesh::Mesh(VkMana::Context& ctx) : m_ctx(&ctx) {}
+auto MeshImportOptions::GetKey() const -> uint64_t
+{
+	auto key = HashCombine(HashCombine(HASH_FNV1A_OFFSET, vertexFormat), optimize);
+	key = HashCombine(HashCombine(HashCombine(key, lodCount), lodReduction), lodMaxError);
+	return key;
+}
+
+Mesh::Mesh(GeometryBuffer& geometry, AssetRegistry& assets) : m_geometry(&geometry), m_assets(&assets) {}
 
-bool Mesh::LoadFromFile(const std::filesystem::path& filename)
+Mesh::~Mesh()
 {
+	if (m_vertexAllocation)
+		m_geometry->FreeVertices(m_vertexAllocation.value());
+	if (m_indexAllocation)
+		m_geometry->FreeIndices(m_indexAllocation.value());
+}
+
+bool Mesh::LoadFromFile(const std::filesystem::path& filename, const MeshImportOptions& options)
+{
+	const auto sourceHash = HashFile(filename);
+	if (!sourceHash)
+	{
+		LOG_ERR("Failed to read mesh file: {}", filename.string());
+		return false;
+	}
+
+	return LoadFromFile(filename, sourceHash.value(), options);
+}
+
+bool Mesh::LoadFromFile(const std::filesystem::path& filename, uint64_t sourceHash, const MeshImportOptions& options)
+{
+	PROFILE_SCOPE("Mesh::LoadFromFile");
+	if (!Import(filename, sourceHash, options))
+		return false;
+
+	FinishLoad();
+	return true;
+}
+
+bool Mesh::Import(const std::filesystem::path& filename, uint64_t sourceHash, const MeshImportOptions& options)
+{
+	PROFILE_SCOPE("Mesh::Import");
 	const auto& filenameStr = filename.string();
 
+	if (ImportCookedFile(filename, sourceHash, options))
+		return true;
+
 	Assimp::Importer import;
 	const aiScene* scene = import.ReadFile(filenameStr.c_str(), MESH_IMPORT_FLAGS);
 
@@ -35,42 +97,179 @@ bool Mesh::LoadFromFile(const std::filesystem::path& filename)
 	}
 	const auto rootDirectory = filename.parent_path();
 
-	std::vector<Vertex> vertices;
-	std::vector<uint16_t> indices;
-	std::vector<Submesh> submeshes;
-	std::vector<Material> materials;
-
-	ProcessNode(scene->mRootNode, scene, glm::mat4(1.0f), vertices, indices, submeshes);
+	ImportData importData{};
+	std::vector<CookedMaterial> cookedMaterials;
 
 	for (auto i = 0; i < scene->mNumMaterials; ++i)
 	{
 		const auto* material = scene->mMaterials[i];
 
-		auto& newMaterial = materials.emplace_back();
-		newMaterial.albedo = LoadMaterialTexture(material, aiTextureType_DIFFUSE, rootDirectory);
-		newMaterial.normalMap = LoadMaterialTexture(material, aiTextureType_HEIGHT, rootDirectory);
+		auto& cookedMaterial = cookedMaterials.emplace_back();
+		cookedMaterial.albedoFilename = GetMaterialTextureFilename(material, aiTextureType_DIFFUSE);
+		cookedMaterial.normalMapFilename = GetMaterialTextureFilename(material, aiTextureType_HEIGHT);
+	}
+
+	// Textures decode on worker threads while the geometry is processed.
+	m_pendingMaterials.rootDir = rootDirectory;
+	m_pendingMaterials.textures = DecodeMaterialTextures(rootDirectory, cookedMaterials);
+
+	// Meshes are processed (optimised, simplified, packed) independently on the workers, then merged in scene order.
+	std::vector<NodeMesh> nodeMeshes;
+	ProcessNode(scene->mRootNode, scene, glm::mat4(1.0f), nodeMeshes);
+	std::vector<ImportData> meshData(nodeMeshes.size());
+	JobSystem::Get().ParallelFor(0, nodeMeshes.size(), 1, [&](size_t begin, size_t end) {
+		for (auto i = begin; i < end; ++i)
+			ProcessMesh(nodeMeshes[i].mesh, nodeMeshes[i].transform, options, meshData[i]);
+	});
+	for (auto& data : meshData)
+		MergeImportData(data, importData);
+
+	const auto isPacked = options.vertexFormat == VertexFormat::Packed;
+	if (isPacked)
+	{
+		const auto& error = importData.quantizationError;
+		LOG_INFO("Packed {} vertices ({} -> {} bytes). Max error: position {:.6f}, uv {:.6f}, normal {:.3f} deg, tangent {:.3f} deg",
+			error.vertexCount,
+			sizeof(Vertex) * error.vertexCount,
+			sizeof(PackedVertex) * error.vertexCount,
+			error.maxPositionError,
+			error.maxTexCoordError,
+			error.maxNormalError,
+			error.maxTangentError);
 	}
 
-	SetVertices(vertices);
-	SetIndices(indices);
-	SetSubmeshes(submeshes);
-	SetMaterials(materials);
+	const auto* vertexData = isPacked ? static_cast<const void*>(importData.packedVertices.data()) : importData.vertices.data();
+	const auto vertexCount = uint32_t(importData.vertices.size());
+	const auto vertexStride = GetVertexStride(options.vertexFormat);
+
+	const auto cookedFilename = CookedMesh::GetCookedFilename(filename);
+	if (!CookedMesh::Write(
+			cookedFilename, sourceHash, GetImportKey(options), vertexData, vertexStride, vertexCount, importData.indices, importData.submeshes, cookedMaterials))
+		LOG_WARN("Failed to write cooked mesh: {}", cookedFilename.string());
+
+	SetVertexData(vertexData, uint64_t(vertexStride) * vertexCount, options.vertexFormat);
+	SetIndices(importData.indices);
+	SetSubmeshes(importData.submeshes);
+	m_pendingMaterials.materials = std::move(cookedMaterials);
+
+	return true;
+}
+
+void Mesh::FinishLoad()
+{
+	SetMaterials(LoadMaterials(m_pendingMaterials.rootDir, m_pendingMaterials.materials, m_pendingMaterials.textures));
+	m_pendingMaterials = {};
+	m_isLoading = false;
+}
+
+bool Mesh::AreTexturesDecoded() const
+{
+	for (const auto& [key, pendingTexture] : m_pendingMaterials.textures)
+	{
+		if (!pendingTexture.texture && !pendingTexture.decoding->IsDone())
+			return false;
+	}
+	return true;
+}
+
+auto Mesh::GetPendingTextureSize() const -> uint64_t
+{
+	uint64_t size = 0;
+	for (const auto& [key, pendingTexture] : m_pendingMaterials.textures)
+	{
+		if (pendingTexture.texture)
+			continue;
+
+		const auto& decoded = pendingTexture.decoded.get();
+		if (decoded.data)
+			size += decoded.data->GetSize();
+	}
+	return size;
+}
+
+bool Mesh::ImportCookedFile(const std::filesystem::path& filename, uint64_t sourceHash, const MeshImportOptions& options)
+{
+	const auto vertexStride = GetVertexStride(options.vertexFormat);
+
+	CookedMesh cookedMesh;
+	if (!cookedMesh.Load(CookedMesh::GetCookedFilename(filename), sourceHash, GetImportKey(options), vertexStride))
+		return false;
+
+	const auto rootDirectory = filename.parent_path();
+
+	// Textures decode on worker threads while the geometry is queued for upload.
+	m_pendingMaterials.rootDir = rootDirectory;
+	m_pendingMaterials.materials = cookedMesh.GetMaterials();
+	m_pendingMaterials.textures = DecodeMaterialTextures(rootDirectory, cookedMesh.GetMaterials());
+
+	SetVertexData(cookedMesh.GetVertexData(), uint64_t(vertexStride) * cookedMesh.GetVertexCount(), options.vertexFormat);
+	SetIndices(cookedMesh.GetIndices(), cookedMesh.GetIndexCount());
+	SetSubmeshes(std::vector<Submesh>(cookedMesh.GetSubmeshes(), cookedMesh.GetSubmeshes() + cookedMesh.GetSubmeshCount()));
 
 	return true;
 }
 
 void Mesh::SetVertices(const std::vector<Vertex>& vertices)
 {
-	const auto bufferInfo = VkMana::BufferCreateInfo::Vertex(sizeof(Vertex) * vertices.size());
-	const VkMana::BufferDataSource dataSrc(bufferInfo.Size, vertices.data());
-	m_vertexBuffer = m_ctx->CreateBuffer(bufferInfo, &dataSrc);
+	SetVertices(vertices.data(), vertices.size());
+}
+
+void Mesh::SetVertices(const Vertex* vertices, size_t vertexCount)
+{
+	SetVertexData(vertices, sizeof(Vertex) * vertexCount, VertexFormat::Full);
+}
+
+void Mesh::SetVertices(const std::vector<PackedVertex>& vertices)
+{
+	SetVertices(vertices.data(), vertices.size());
+}
+
+void Mesh::SetVertices(const PackedVertex* vertices, size_t vertexCount)
+{
+	SetVertexData(vertices, sizeof(PackedVertex) * vertexCount, VertexFormat::Packed);
+}
+
+void Mesh::SetVertexData(const void* data, uint64_t size, VertexFormat format)
+{
+	if (m_vertexAllocation)
+		m_geometry->FreeVertices(m_vertexAllocation.value());
+
+	const auto vertexStride = GetVertexStride(format);
+	uint64_t uploadEnd = 0;
+	m_vertexAllocation = m_geometry->AllocateVertices(data, size, vertexStride, &uploadEnd);
+	m_uploadEnd = std::max(m_uploadEnd, uploadEnd);
+	m_firstVertex = m_vertexAllocation ? uint32_t(m_vertexAllocation->offset / vertexStride) : 0;
+	m_vertexFormat = format;
+	if (!m_vertexAllocation)
+		LOG_ERR("Failed to allocate {} bytes of vertex data", size);
 }
 
 void Mesh::SetIndices(const std::vector<uint16_t>& indices)
 {
-	const auto bufferInfo = VkMana::BufferCreateInfo::Index(sizeof(uint16_t) * indices.size());
-	const VkMana::BufferDataSource dataSrc(bufferInfo.Size, indices.data());
-	m_indexBuffer = m_ctx->CreateBuffer(bufferInfo, &dataSrc);
+	SetIndices(indices.data(), indices.size());
+}
+
+void Mesh::SetIndices(const uint16_t* indices, size_t indexCount)
+{
+	if (m_indexAllocation)
+		m_geometry->FreeIndices(m_indexAllocation.value());
+
+	uint64_t uploadEnd = 0;
+	m_indexAllocation = m_geometry->AllocateIndices(indices, indexCount, &uploadEnd);
+	m_uploadEnd = std::max(m_uploadEnd, uploadEnd);
+	m_firstIndex = m_indexAllocation ? uint32_t(m_indexAllocation->offset / sizeof(uint16_t)) : 0;
+	if (!m_indexAllocation)
+		LOG_ERR("Failed to allocate {} indices", indexCount);
+}
+
+auto Mesh::GetMemorySize() const -> uint64_t
+{
+	uint64_t size = 0;
+	if (m_vertexAllocation)
+		size += m_vertexAllocation->size;
+	if (m_indexAllocation)
+		size += m_indexAllocation->size;
+	return size;
 }
 
 void Mesh::SetSubmeshes(const std::vector<Submesh>& submeshes)
@@ -83,12 +282,7 @@ void Mesh::SetMaterials(const std::vector<Material>& materials)
 	m_materials = materials;
 }
 
-void Mesh::ProcessNode(const aiNode* node,
-	const aiScene* scene,
-	const glm::mat4& parentTransform,
-	std::vector<Vertex>& outVertices,
-	std::vector<uint16_t>& outIndices,
-	std::vector<Submesh>& outSubmeshes)
+void Mesh::ProcessNode(const aiNode* node, const aiScene* scene, const glm::mat4& parentTransform, std::vector<NodeMesh>& outMeshes)
 {
 	const auto& transform = node->mTransformation;
 	auto nodeTransform = parentTransform * mat4_cast(transform);
@@ -96,19 +290,21 @@ void Mesh::ProcessNode(const aiNode* node,
 	for (auto i = 0; i < node->mNumMeshes; ++i)
 	{
 		const auto* mesh = scene->mMeshes[node->mMeshes[i]];
-		ProcessMesh(mesh, nodeTransform, outVertices, outIndices, outSubmeshes);
+		outMeshes.push_back({ mesh, nodeTransform });
 	}
 
 	for (auto i = 0; i < node->mNumChildren; ++i)
 	{
-		ProcessNode(node->mChildren[i], scene, nodeTransform, outVertices, outIndices, outSubmeshes);
+		ProcessNode(node->mChildren[i], scene, nodeTransform, outMeshes);
 	}
 }
 
-void Mesh::ProcessMesh(
-	const aiMesh* mesh, const glm::mat4& transform, std::vector<Vertex>& outVertices, std::vector<uint16_t>& outIndices, std::vector<Submesh>& outSubmeshes)
+void Mesh::ProcessMesh(const aiMesh* mesh, const glm::mat4& transform, const MeshImportOptions& options, ImportData& outData)
 {
-	outSubmeshes.emplace_back(Submesh{
+	auto& outVertices = outData.vertices;
+	auto& outIndices = outData.indices;
+
+	auto& submesh = outData.submeshes.emplace_back(Submesh{
 		.indexOffset = uint32_t(outIndices.size()),
 		.indexCount = mesh->mNumFaces * 3,
 		.vertexOffset = uint32_t(outVertices.size()),
@@ -159,20 +355,194 @@ void Mesh::ProcessMesh(
 		for (auto j = 0; j < face.mNumIndices; ++j)
 			outIndices.push_back(face.mIndices[j]);
 	}
+
+	if (options.optimize)
+		OptimizeSubmesh(mesh->mName.C_Str(), submesh, outData);
+
+	const auto* submeshVertices = outVertices.data() + submesh.vertexOffset;
+	if (submesh.vertexCount > 0)
+	{
+		submesh.boundsMin = submesh.boundsMax = submeshVertices[0].position;
+		for (auto i = 1u; i < submesh.vertexCount; ++i)
+		{
+			submesh.boundsMin = glm::min(submesh.boundsMin, submeshVertices[i].position);
+			submesh.boundsMax = glm::max(submesh.boundsMax, submeshVertices[i].position);
+		}
+
+		submesh.sphereCenter = (submesh.boundsMin + submesh.boundsMax) * 0.5f;
+		for (auto i = 0u; i < submesh.vertexCount; ++i)
+			submesh.sphereRadius = std::max(submesh.sphereRadius, glm::length(submeshVertices[i].position - submesh.sphereCenter));
+	}
+
+	submesh.lods[0] = { submesh.indexOffset, submesh.indexCount, 0.0f };
+	submesh.lodCount = 1;
+	if (options.lodCount > 1)
+		GenerateSubmeshLods(mesh->mName.C_Str(), submesh, options, outData);
+
+	if (options.vertexFormat == VertexFormat::Packed)
+	{
+		outData.packedVertices.resize(outVertices.size());
+		const auto error =
+			PackVertices(submeshVertices, submesh.vertexCount, submesh.boundsMin, submesh.boundsMax, outData.packedVertices.data() + submesh.vertexOffset);
+		outData.quantizationError.Merge(error);
+	}
+}
+
+void Mesh::OptimizeSubmesh(const std::string& name, const Submesh& submesh, ImportData& data)
+{
+	auto* indices = data.indices.data() + submesh.indexOffset;
+	auto* vertices = data.vertices.data() + submesh.vertexOffset;
+
+	const auto before = AnalyzeVertexCache(indices, submesh.indexCount, submesh.vertexCount);
+	OptimizeVertexCache(indices, submesh.indexCount, submesh.vertexCount);
+	OptimizeOverdraw(indices, submesh.indexCount, vertices, submesh.vertexCount);
+	OptimizeVertexFetch(indices, submesh.indexCount, vertices, submesh.vertexCount);
+	const auto after = AnalyzeVertexCache(indices, submesh.indexCount, submesh.vertexCount);
+
+	LOG_INFO("Optimized submesh '{}' ({} tris): ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+		name,
+		submesh.indexCount / 3,
+		before.acmr,
+		after.acmr,
+		before.atvr,
+		after.atvr);
+}
+
+void Mesh::GenerateSubmeshLods(const std::string& name, Submesh& submesh, const MeshImportOptions& options, ImportData& data)
+{
+	// Each LOD is simplified from LOD 0 (rather than the previous LOD), so its error is measured against the original surface.
+	const std::vector<uint16_t> baseIndices(data.indices.begin() + submesh.indexOffset, data.indices.begin() + submesh.indexOffset + submesh.indexCount);
+	const auto* vertices = data.vertices.data() + submesh.vertexOffset;
+	const auto maxError = options.lodMaxError * glm::length(submesh.boundsMax - submesh.boundsMin);
+
+	const auto lodCount = std::min(options.lodCount, MAX_SUBMESH_LODS);
+	auto targetIndexCount = float(submesh.indexCount);
+	while (submesh.lodCount < lodCount)
+	{
+		const auto& prevLod = submesh.lods[submesh.lodCount - 1];
+		targetIndexCount *= options.lodReduction;
+
+		float error = 0.0f;
+		auto lodIndices =
+			SimplifyMesh(baseIndices.data(), baseIndices.size(), vertices, submesh.vertexCount, size_t(targetIndexCount) / 3 * 3, maxError, &error);
+
+		// Stop once the error bound (or locked borders/seams) prevents a meaningful reduction.
+		if (lodIndices.empty() || float(lodIndices.size()) > float(prevLod.indexCount) * 0.9f)
+			break;
+
+		OptimizeVertexCache(lodIndices.data(), lodIndices.size(), submesh.vertexCount);
+
+		auto& lod = submesh.lods[submesh.lodCount++];
+		lod.indexOffset = uint32_t(data.indices.size());
+		lod.indexCount = uint32_t(lodIndices.size());
+		lod.error = std::max(error, prevLod.error);
+		data.indices.insert(data.indices.end(), lodIndices.begin(), lodIndices.end());
+	}
+
+	std::string lodTriangles;
+	for (auto i = 0u; i < submesh.lodCount; ++i)
+		lodTriangles += fmt::format("{}{}", i == 0 ? "" : " / ", submesh.lods[i].indexCount / 3);
+	LOG_INFO("Submesh '{}' LODs: {} tris", name, lodTriangles);
 }
 
-auto Mesh::LoadMaterialTexture(const aiMaterial* material, aiTextureType textureType, const std::filesystem::path& rootDir) const -> std::shared_ptr<Texture>
+void Mesh::MergeImportData(ImportData& data, ImportData& outData)
+{
+	// Indices are relative to their submesh's first vertex, only the offsets move.
+	const auto vertexBase = uint32_t(outData.vertices.size());
+	const auto indexBase = uint32_t(outData.indices.size());
+	for (auto& submesh : data.submeshes)
+	{
+		submesh.vertexOffset += vertexBase;
+		submesh.indexOffset += indexBase;
+		for (auto lod = 0u; lod < submesh.lodCount; ++lod)
+			submesh.lods[lod].indexOffset += indexBase;
+		outData.submeshes.push_back(submesh);
+	}
+
+	outData.vertices.insert(outData.vertices.end(), data.vertices.begin(), data.vertices.end());
+	outData.packedVertices.insert(outData.packedVertices.end(), data.packedVertices.begin(), data.packedVertices.end());
+	outData.indices.insert(outData.indices.end(), data.indices.begin(), data.indices.end());
+	outData.quantizationError.Merge(data.quantizationError);
+}
+
+auto Mesh::GetMaterialTextureFilename(const aiMaterial* material, aiTextureType textureType) -> std::string
 {
 	if (material->GetTextureCount(textureType) == 0)
-		return nullptr;
+		return {};
 
 	aiString str;
 	material->GetTexture(textureType, 0, &str);
+	return str.C_Str();
+}
+
+auto Mesh::DecodeMaterialTextures(const std::filesystem::path& rootDir, const std::vector<CookedMaterial>& materials) const -> PendingTextureMap
+{
+	PendingTextureMap pendingTextures;
+	const auto decodeTexture = [&](const std::string& filename, TextureUsage usage) {
+		const auto key = std::make_pair(filename, usage);
+		if (filename.empty() || pendingTextures.count(key) != 0)
+			return;
 
-	const auto textureFilename = rootDir / str.C_Str();
-	auto texture = std::make_shared<Texture>(*m_ctx);
-	if (!texture->LoadFromFile(textureFilename))
+		auto textureFilename = rootDir / filename;
+		auto& pendingTexture = pendingTextures[key];
+		pendingTexture.texture = m_isLoading ? nullptr : m_assets->FindTexture(textureFilename, usage);
+		if (pendingTexture.texture)
+			return;
+
+		pendingTexture.decoding = std::make_unique<JobCounter>();
+		pendingTexture.decoded = JobSystem::Get().Enqueue(
+			[textureFilename, usage] {
+				DecodedTexture decoded{};
+				decoded.data = Texture::LoadData(textureFilename, usage, &decoded.contentHash);
+				return decoded;
+			},
+			pendingTexture.decoding.get()).share();
+	};
+
+	for (const auto& material : materials)
+	{
+		decodeTexture(material.albedoFilename, TextureUsage::Color);
+		decodeTexture(material.normalMapFilename, TextureUsage::NormalMap);
+	}
+	return pendingTextures;
+}
+
+auto Mesh::LoadMaterials(const std::filesystem::path& rootDir, const std::vector<CookedMaterial>& materials, PendingTextureMap& pendingTextures) const
+	-> std::vector<Material>
+{
+	// GPU images are created in one batch on this thread once each decode finishes.
+	std::map<std::pair<std::string, TextureUsage>, std::shared_ptr<Texture>> textures;
+	for (auto& [key, pendingTexture] : pendingTextures)
+		textures[key] = LoadMaterialTexture(rootDir / key.first, key.second, pendingTexture);
+
+	const auto getTexture = [&textures](const std::string& filename, TextureUsage usage) -> std::shared_ptr<Texture> {
+		const auto it = textures.find(std::make_pair(filename, usage));
+		return it != textures.end() ? it->second : nullptr;
+	};
+
+	std::vector<Material> outMaterials;
+	outMaterials.reserve(materials.size());
+	for (const auto& material : materials)
+	{
+		auto& newMaterial = outMaterials.emplace_back();
+		newMaterial.albedo = getTexture(material.albedoFilename, TextureUsage::Color);
+		newMaterial.normalMap = getTexture(material.normalMapFilename, TextureUsage::NormalMap);
+	}
+	return outMaterials;
+}
+
+auto Mesh::LoadMaterialTexture(const std::filesystem::path& filename, TextureUsage usage, PendingTexture& pendingTexture) const -> std::shared_ptr<Texture>
+{
+	if (pendingTexture.texture)
+		return pendingTexture.texture;
+
+	JobSystem::Get().Wait(*pendingTexture.decoding);
+	const auto& decoded = pendingTexture.decoded.get();
+	if (!decoded.data)
+	{
+		LOG_WARN("Failed to load texture: {}", filename.string());
 		return nullptr;
+	}
 
-	return texture;
+	return m_assets->AddTexture(filename, usage, decoded.contentHash, decoded.data.value());
 }
@@ -1,27 +1,76 @@
 #pragma once
 
+#include "Core/JobSystem.hpp"
+#include "GeometryBuffer.hpp"
 #include "Material.hpp"
+#include "MeshCache.hpp"
 #include "Submesh.hpp"
 #include "Vertex.hpp"
+#include "VertexPacking.hpp"
 
 #include <filesystem>
+#include <future>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
 #include <vector>
 
-#include <VkMana/Buffer.hpp>
-#include <VkMana/Context.hpp>
-
 #include <assimp/scene.h>
 
+class AssetRegistry;
+
+struct MeshImportOptions
+{
+	VertexFormat vertexFormat = VertexFormat::Full;
+	bool optimize = true; // Reorder triangles/vertices for the vertex cache, overdraw and fetch locality.
+	uint32_t lodCount = MAX_SUBMESH_LODS; // Including the full-resolution LOD 0. 1 disables LOD generation.
+	float lodReduction = 0.5f;			  // Target triangle count of each LOD, relative to the previous one.
+	float lodMaxError = 0.02f;			  // Simplification error bound, relative to the submesh's bounds diagonal.
+
+	/**
+	 * Identifies the options, so assets imported with different options are cached separately.
+	 */
+	auto GetKey() const -> uint64_t;
+};
+
 class Mesh
 {
 public:
-	explicit Mesh(VkMana::Context& ctx);
-	~Mesh() = default;
+	Mesh(GeometryBuffer& geometry, AssetRegistry& assets);
+	~Mesh();
+
+	Mesh(const Mesh&) = delete;
+	auto operator=(const Mesh&) -> Mesh& = delete;
+
+	bool LoadFromFile(const std::filesystem::path& filename, const MeshImportOptions& options = {});
+	bool LoadFromFile(const std::filesystem::path& filename, uint64_t sourceHash, const MeshImportOptions& options = {});
 
-	bool LoadFromFile(const std::filesystem::path& filename);
+	/**
+	 * LoadFromFile() in steps, for loading on the job system (see AssetRegistry::LoadMeshAsync()).
+	 * BeginLoad() marks the mesh as loading. Import() only touches the mesh and the geometry buffer, so it can run on any thread.
+	 * FinishLoad() then creates the material textures, on the asset registry's thread.
+	 */
+	void BeginLoad() { m_isLoading = true; }
+	bool Import(const std::filesystem::path& filename, uint64_t sourceHash, const MeshImportOptions& options);
+	void FinishLoad();
+	/**
+	 * True once every material texture Import() started decoding is done, so FinishLoad() does not wait.
+	 */
+	bool AreTexturesDecoded() const;
+	/**
+	 * Bytes of texture data FinishLoad() creates images from. An upper bound, textures the registry turns out to have already are
+	 * counted too. Only valid once AreTexturesDecoded().
+	 */
+	auto GetPendingTextureSize() const -> uint64_t;
 
 	void SetVertices(const std::vector<Vertex>& vertices);
+	void SetVertices(const Vertex* vertices, size_t vertexCount);
+	void SetVertices(const std::vector<PackedVertex>& vertices);
+	void SetVertices(const PackedVertex* vertices, size_t vertexCount);
 	void SetIndices(const std::vector<uint16_t>& indices);
+	void SetIndices(const uint16_t* indices, size_t indexCount);
 	void SetSubmeshes(const std::vector<Submesh>& submeshes);
 	void SetMaterials(const std::vector<Material>& materials);
 
@@ -29,31 +78,102 @@ public:
 	/// Getters
 	//////////////////////////////////////////////////
 
-	auto GetVertexBuffer() const -> const auto& { return m_vertexBuffer; }
-	auto GetIndexBuffer() const -> const auto& { return m_indexBuffer; }
+	auto GetVertexFormat() const -> VertexFormat { return m_vertexFormat; }
+	auto GetVertexBuffer() const -> const auto& { return m_geometry->GetVertexBuffer(); }
+	auto GetIndexBuffer() const -> const auto& { return m_geometry->GetIndexBuffer(); }
+	/**
+	 * Position of the mesh's vertices/indices in the shared geometry buffers. Submesh offsets are relative to these.
+	 */
+	auto GetFirstVertex() const -> uint32_t { return m_firstVertex; }
+	auto GetFirstIndex() const -> uint32_t { return m_firstIndex; }
 	auto GetSubmeshes() const -> const auto& { return m_submeshes; }
 	auto GetMaterials() -> auto& { return m_materials; }
+	auto GetMaterials() const -> const auto& { return m_materials; }
+	bool IsLoading() const { return m_isLoading; }
+	/**
+	 * Loaded, and its vertex/index data uploaded. Only resident meshes can be drawn.
+	 */
+	bool IsResident() const { return !m_isLoading && m_geometry->IsUploaded(m_uploadEnd); }
+	/**
+	 * GPU memory of the vertex and index ranges, in bytes.
+	 */
+	auto GetMemorySize() const -> uint64_t;
 
 private:
-	static void ProcessNode(const aiNode* node,
-		const aiScene* scene,
-		const glm::mat4& transform,
-		std::vector<Vertex>& outVertices,
-		std::vector<uint16_t>& outIndices,
-		std::vector<Submesh>& outSubmeshes);
-	static void ProcessMesh(const aiMesh* mesh,
-		const glm::mat4& transform,
-		std::vector<Vertex>& outVertices,
-		std::vector<uint16_t>& outIndices,
-		std::vector<Submesh>& outSubmeshes);
-
-	auto LoadMaterialTexture(const aiMaterial* material, aiTextureType textureType, const std::filesystem::path& rootDir) const -> std::shared_ptr<Texture>;
+	struct ImportData
+	{
+		std::vector<Vertex> vertices;
+		std::vector<PackedVertex> packedVertices; // Only filled for VertexFormat::Packed
+		std::vector<uint16_t> indices;
+		std::vector<Submesh> submeshes;
+		VertexQuantizationError quantizationError{};
+	};
+
+	struct NodeMesh
+	{
+		const aiMesh* mesh;
+		glm::mat4 transform;
+	};
+
+	/* Flattens the node tree into its meshes, in depth-first order. */
+	static void ProcessNode(const aiNode* node, const aiScene* scene, const glm::mat4& transform, std::vector<NodeMesh>& outMeshes);
+	static void ProcessMesh(const aiMesh* mesh, const glm::mat4& transform, const MeshImportOptions& options, ImportData& outData);
+	static void OptimizeSubmesh(const std::string& name, const Submesh& submesh, ImportData& data);
+	static void GenerateSubmeshLods(const std::string& name, Submesh& submesh, const MeshImportOptions& options, ImportData& data);
+	/* Appends `data` to `outData`, rebasing its submesh (and LOD) offsets. */
+	static void MergeImportData(ImportData& data, ImportData& outData);
+
+	bool ImportCookedFile(const std::filesystem::path& filename, uint64_t sourceHash, const MeshImportOptions& options);
+
+	void SetVertexData(const void* data, uint64_t size, VertexFormat format);
+
+	struct DecodedTexture
+	{
+		uint64_t contentHash = 0;
+		std::optional<TextureData> data;
+	};
+	struct PendingTexture
+	{
+		~PendingTexture()
+		{
+			// The decode job signals the counter, it must be done before the counter goes.
+			if (decoding)
+				JobSystem::Get().Wait(*decoding);
+		}
+
+		std::shared_ptr<Texture> texture = nullptr; // Set if the registry already has the texture loaded.
+		std::shared_future<DecodedTexture> decoded; // Shared so GetPendingTextureSize() can read it before FinishLoad()
+		std::unique_ptr<JobCounter> decoding; // Waited on before `decoded`, so the waiting thread runs jobs meanwhile
+	};
+	using PendingTextureMap = std::map<std::pair<std::string, TextureUsage>, PendingTexture>;
+	/* Filled by Import(), turned into `m_materials` by FinishLoad(). */
+	struct PendingMaterials
+	{
+		std::filesystem::path rootDir;
+		std::vector<CookedMaterial> materials;
+		PendingTextureMap textures;
+	};
+
+	static auto GetMaterialTextureFilename(const aiMaterial* material, aiTextureType textureType) -> std::string;
+	/* Skips the registry lookup of already loaded textures while loading asynchronously, the registry is not thread-safe. */
+	auto DecodeMaterialTextures(const std::filesystem::path& rootDir, const std::vector<CookedMaterial>& materials) const -> PendingTextureMap;
+	auto LoadMaterials(const std::filesystem::path& rootDir, const std::vector<CookedMaterial>& materials, PendingTextureMap& pendingTextures) const
+		-> std::vector<Material>;
+	auto LoadMaterialTexture(const std::filesystem::path& filename, TextureUsage usage, PendingTexture& pendingTexture) const -> std::shared_ptr<Texture>;
 
 private:
-	VkMana::Context* m_ctx = nullptr;
+	GeometryBuffer* m_geometry = nullptr;
+	AssetRegistry* m_assets = nullptr;
 
-	VkMana::BufferHandle m_vertexBuffer = nullptr;
-	VkMana::BufferHandle m_indexBuffer = nullptr;
+	VertexFormat m_vertexFormat = VertexFormat::Full;
+	std::optional<RangeAllocation> m_vertexAllocation;
+	std::optional<RangeAllocation> m_indexAllocation;
+	uint32_t m_firstVertex = 0;
+	uint32_t m_firstIndex = 0;
 	std::vector<Submesh> m_submeshes;
 	std::vector<Material> m_materials;
+
+	bool m_isLoading = false;
+	uint64_t m_uploadEnd = 0; // Upload of the vertex/index data, see GeometryBuffer::IsUploaded()
+	PendingMaterials m_pendingMaterials;
 };
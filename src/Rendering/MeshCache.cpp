@@ -0,0 +1,219 @@
+#include "MeshCache.hpp"
+
+#include "Core/Logging.hpp"
+#include "Core/TempFile.hpp"
+
+#include <fstream>
+#include <system_error>
+#include <type_traits>
+
+namespace
+{
+	constexpr uint32_t COOKED_MESH_MAGIC = 0x43534D47; // "GMSC"
+	constexpr uint32_t COOKED_MESH_VERSION = 4;
+	constexpr uint64_t COOKED_MESH_BLOCK_ALIGNMENT = 16;
+
+	static_assert(std::is_trivially_copyable_v<Submesh>);
+
+	struct CookedMeshHeader
+	{
+		uint32_t magic = COOKED_MESH_MAGIC;
+		uint32_t version = COOKED_MESH_VERSION;
+		uint64_t sourceHash = 0;
+		uint64_t importKey = 0;
+		uint32_t vertexStride = 0;
+		uint32_t submeshStride = sizeof(Submesh);
+		uint32_t vertexCount = 0;
+		uint32_t indexCount = 0;
+		uint32_t submeshCount = 0;
+		uint32_t materialCount = 0;
+		uint64_t vertexBlockOffset = 0;
+		uint64_t indexBlockOffset = 0;
+		uint64_t submeshBlockOffset = 0;
+		uint64_t materialBlockOffset = 0;
+		uint64_t stringBlockOffset = 0;
+		uint64_t stringBlockSize = 0;
+	};
+
+	/* Offset/length pair into the string block. */
+	struct CookedString
+	{
+		uint32_t offset = 0;
+		uint32_t length = 0;
+	};
+
+	struct CookedMaterialRef
+	{
+		CookedString albedoFilename;
+		CookedString normalMapFilename;
+	};
+
+	inline auto AlignUp(uint64_t value, uint64_t alignment) -> uint64_t
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	/* Returns true if the block [offset, offset + size) lies inside a file of `fileSize` bytes. */
+	inline bool IsBlockInBounds(uint64_t offset, uint64_t size, uint64_t fileSize)
+	{
+		return offset <= fileSize && size <= fileSize - offset;
+	}
+
+	class BlockWriter
+	{
+	public:
+		explicit BlockWriter(std::ofstream& stream) : m_stream(stream) {}
+
+		auto Write(const void* data, uint64_t size) -> uint64_t
+		{
+			const auto alignedOffset = AlignUp(m_offset, COOKED_MESH_BLOCK_ALIGNMENT);
+			constexpr char zeroes[COOKED_MESH_BLOCK_ALIGNMENT] = {};
+			m_stream.write(zeroes, std::streamsize(alignedOffset - m_offset));
+			m_stream.write(static_cast<const char*>(data), std::streamsize(size));
+			m_offset = alignedOffset + size;
+			return alignedOffset;
+		}
+
+	private:
+		std::ofstream& m_stream;
+		uint64_t m_offset = 0;
+	};
+
+} // namespace
+
+auto CookedMesh::GetCookedFilename(const std::filesystem::path& sourceFilename) -> std::filesystem::path
+{
+	auto cookedFilename = sourceFilename;
+	cookedFilename += ".meshcache";
+	return cookedFilename;
+}
+
+bool CookedMesh::Write(const std::filesystem::path& filename,
+	uint64_t sourceHash,
+	uint64_t importKey,
+	const void* vertexData,
+	uint32_t vertexStride,
+	uint32_t vertexCount,
+	const std::vector<uint16_t>& indices,
+	const std::vector<Submesh>& submeshes,
+	const std::vector<CookedMaterial>& materials)
+{
+	std::string strings;
+	const auto addString = [&strings](const std::string& str) {
+		const CookedString cookedStr{ uint32_t(strings.size()), uint32_t(str.size()) };
+		strings += str;
+		return cookedStr;
+	};
+
+	std::vector<CookedMaterialRef> materialRefs;
+	materialRefs.reserve(materials.size());
+	for (const auto& material : materials)
+	{
+		auto& materialRef = materialRefs.emplace_back();
+		materialRef.albedoFilename = addString(material.albedoFilename);
+		materialRef.normalMapFilename = addString(material.normalMapFilename);
+	}
+
+	// Write to a temporary file and rename it into place, so a concurrent/crashed cook never leaves a partial cache behind.
+	const auto tempFilename = GetTempFilename(filename);
+	{
+		std::ofstream stream(tempFilename, std::ios::binary | std::ios::trunc);
+		if (!stream)
+			return false;
+
+		CookedMeshHeader header{};
+		header.sourceHash = sourceHash;
+		header.importKey = importKey;
+		header.vertexStride = vertexStride;
+		header.vertexCount = vertexCount;
+		header.indexCount = uint32_t(indices.size());
+		header.submeshCount = uint32_t(submeshes.size());
+		header.materialCount = uint32_t(materialRefs.size());
+
+		BlockWriter writer(stream);
+		writer.Write(&header, sizeof(header)); // Placeholder, rewritten once the block offsets are known.
+		header.vertexBlockOffset = writer.Write(vertexData, uint64_t(vertexStride) * vertexCount);
+		header.indexBlockOffset = writer.Write(indices.data(), sizeof(uint16_t) * indices.size());
+		header.submeshBlockOffset = writer.Write(submeshes.data(), sizeof(Submesh) * submeshes.size());
+		header.materialBlockOffset = writer.Write(materialRefs.data(), sizeof(CookedMaterialRef) * materialRefs.size());
+		header.stringBlockOffset = writer.Write(strings.data(), strings.size());
+		header.stringBlockSize = strings.size();
+
+		stream.seekp(0);
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		if (!stream)
+		{
+			stream.close();
+			std::error_code err;
+			std::filesystem::remove(tempFilename, err);
+			return false;
+		}
+	}
+
+	std::error_code err;
+	std::filesystem::rename(tempFilename, filename, err);
+	if (err)
+	{
+		std::filesystem::remove(tempFilename, err);
+		return false;
+	}
+
+	return true;
+}
+
+bool CookedMesh::Load(const std::filesystem::path& filename, uint64_t sourceHash, uint64_t importKey, uint32_t vertexStride)
+{
+	if (!m_file.Open(filename))
+		return false;
+
+	const auto fileSize = uint64_t(m_file.GetSize());
+	const auto* data = m_file.GetData();
+	if (fileSize < sizeof(CookedMeshHeader))
+	{
+		m_file.Close();
+		return false;
+	}
+
+	const auto& header = *reinterpret_cast<const CookedMeshHeader*>(data);
+	if (header.magic != COOKED_MESH_MAGIC || header.version != COOKED_MESH_VERSION || header.sourceHash != sourceHash || header.importKey != importKey
+		|| header.vertexStride != vertexStride || header.submeshStride != sizeof(Submesh))
+	{
+		m_file.Close();
+		return false;
+	}
+
+	if (!IsBlockInBounds(header.vertexBlockOffset, uint64_t(header.vertexCount) * vertexStride, fileSize)
+		|| !IsBlockInBounds(header.indexBlockOffset, uint64_t(header.indexCount) * sizeof(uint16_t), fileSize)
+		|| !IsBlockInBounds(header.submeshBlockOffset, uint64_t(header.submeshCount) * sizeof(Submesh), fileSize)
+		|| !IsBlockInBounds(header.materialBlockOffset, uint64_t(header.materialCount) * sizeof(CookedMaterialRef), fileSize)
+		|| !IsBlockInBounds(header.stringBlockOffset, header.stringBlockSize, fileSize))
+	{
+		LOG_WARN("Cooked mesh is truncated or corrupt: {}", filename.string());
+		m_file.Close();
+		return false;
+	}
+
+	m_vertexData = data + header.vertexBlockOffset;
+	m_vertexCount = header.vertexCount;
+	m_indices = reinterpret_cast<const uint16_t*>(data + header.indexBlockOffset);
+	m_indexCount = header.indexCount;
+	m_submeshes = reinterpret_cast<const Submesh*>(data + header.submeshBlockOffset);
+	m_submeshCount = header.submeshCount;
+
+	const std::string_view strings(reinterpret_cast<const char*>(data + header.stringBlockOffset), header.stringBlockSize);
+	const auto getString = [&strings](const CookedString& str) {
+		if (uint64_t(str.offset) + str.length > strings.size())
+			return std::string();
+		return std::string(strings.substr(str.offset, str.length));
+	};
+
+	const auto* materialRefs = reinterpret_cast<const CookedMaterialRef*>(data + header.materialBlockOffset);
+	m_materials.resize(header.materialCount);
+	for (auto i = 0u; i < header.materialCount; ++i)
+	{
+		m_materials[i].albedoFilename = getString(materialRefs[i].albedoFilename);
+		m_materials[i].normalMapFilename = getString(materialRefs[i].normalMapFilename);
+	}
+
+	return true;
+}
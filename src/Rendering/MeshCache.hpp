@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Core/MappedFile.hpp"
+#include "Submesh.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Texture references of a material, relative to the directory of the source asset.
+ */
+struct CookedMaterial
+{
+	std::string albedoFilename;
+	std::string normalMapFilename;
+};
+
+/**
+ * A "cooked" mesh is the already-flattened (and optionally packed) output of the Assimp import (vertices, indices, submeshes, material references)
+ * written to a versioned binary file next to the source asset.
+ * Loading memory-maps the file and exposes the blocks in place, so they can be handed straight to the GPU upload.
+ *
+ * The cache is invalidated when the format version, the source file hash or the import key (import flags/options) change.
+ */
+class CookedMesh
+{
+public:
+	static auto GetCookedFilename(const std::filesystem::path& sourceFilename) -> std::filesystem::path;
+
+	static bool Write(const std::filesystem::path& filename,
+		uint64_t sourceHash,
+		uint64_t importKey,
+		const void* vertexData,
+		uint32_t vertexStride,
+		uint32_t vertexCount,
+		const std::vector<uint16_t>& indices,
+		const std::vector<Submesh>& submeshes,
+		const std::vector<CookedMaterial>& materials);
+
+	bool Load(const std::filesystem::path& filename, uint64_t sourceHash, uint64_t importKey, uint32_t vertexStride);
+
+	//////////////////////////////////////////////////
+	/// Getters
+	//////////////////////////////////////////////////
+
+	auto GetVertexData() const -> const void* { return m_vertexData; }
+	auto GetVertexCount() const -> uint32_t { return m_vertexCount; }
+	auto GetIndices() const -> const uint16_t* { return m_indices; }
+	auto GetIndexCount() const -> uint32_t { return m_indexCount; }
+	auto GetSubmeshes() const -> const Submesh* { return m_submeshes; }
+	auto GetSubmeshCount() const -> uint32_t { return m_submeshCount; }
+	auto GetMaterials() const -> const auto& { return m_materials; }
+
+private:
+	MappedFile m_file;
+
+	const void* m_vertexData = nullptr;
+	uint32_t m_vertexCount = 0;
+	const uint16_t* m_indices = nullptr;
+	uint32_t m_indexCount = 0;
+	const Submesh* m_submeshes = nullptr;
+	uint32_t m_submeshCount = 0;
+	std::vector<CookedMaterial> m_materials;
+};
@@ -0,0 +1,543 @@
+#include "MeshOptimizer.hpp"
+
+#include <glm/ext/vector_double3.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <numeric>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+	constexpr uint32_t OVERDRAW_CACHE_SIZE = 16;
+	constexpr uint32_t INVALID_INDEX = ~0u;
+
+	auto FindVertexScore(uint32_t cachePosition, uint32_t remainingValence) -> float
+	{
+		constexpr float CACHE_DECAY_POWER = 1.5f;
+		constexpr float LAST_TRI_SCORE = 0.75f;
+		constexpr float VALENCE_BOOST_SCALE = 2.0f;
+		constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+		if (remainingValence == 0)
+			return -1.0f; // No triangles left to use this vertex.
+
+		float score = 0.0f;
+		if (cachePosition < 3)
+		{
+			// Used by the last triangle. Fixed score, so it isn't favoured over the others in the cache.
+			score = LAST_TRI_SCORE;
+		}
+		else if (cachePosition < FORSYTH_CACHE_SIZE)
+		{
+			const auto scaler = 1.0f / float(FORSYTH_CACHE_SIZE - 3);
+			score = std::pow(1.0f - float(cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+		}
+
+		// Boost vertices with few triangles left, so lone triangles don't get left behind.
+		score += VALENCE_BOOST_SCALE * std::pow(float(remainingValence), -VALENCE_BOOST_POWER);
+		return score;
+	}
+
+	/* Per-triangle FIFO cache miss count of the given order. */
+	auto SimulateCacheMisses(const uint16_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize) -> std::vector<uint32_t>
+	{
+		std::vector<uint32_t> timestamps(vertexCount, 0);
+		uint32_t timestamp = cacheSize + 1;
+
+		std::vector<uint32_t> misses(indexCount / 3, 0);
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			const auto index = indices[i];
+			if (timestamp - timestamps[index] > cacheSize)
+			{
+				timestamps[index] = timestamp++;
+				++misses[i / 3];
+			}
+		}
+		return misses;
+	}
+
+	/* Symmetric 4x4 matrix accumulating the squared distance to a set of planes, weighted by triangle area. */
+	struct Quadric
+	{
+		double xx = 0, xy = 0, xz = 0, xw = 0, yy = 0, yz = 0, yw = 0, zz = 0, zw = 0, ww = 0;
+		double weight = 0;
+
+		void AddPlane(const glm::dvec3& n, double d, double w)
+		{
+			xx += w * n.x * n.x;
+			xy += w * n.x * n.y;
+			xz += w * n.x * n.z;
+			xw += w * n.x * d;
+			yy += w * n.y * n.y;
+			yz += w * n.y * n.z;
+			yw += w * n.y * d;
+			zz += w * n.z * n.z;
+			zw += w * n.z * d;
+			ww += w * d * d;
+			weight += w;
+		}
+
+		void Add(const Quadric& q)
+		{
+			xx += q.xx;
+			xy += q.xy;
+			xz += q.xz;
+			xw += q.xw;
+			yy += q.yy;
+			yz += q.yz;
+			yw += q.yw;
+			zz += q.zz;
+			zw += q.zw;
+			ww += q.ww;
+			weight += q.weight;
+		}
+
+		/* Mean squared distance of `p` to the accumulated planes. */
+		auto Evaluate(const glm::vec3& p) const -> double
+		{
+			if (weight <= 0.0)
+				return 0.0;
+
+			const double x = p.x, y = p.y, z = p.z;
+			const auto error = xx * x * x + 2 * xy * x * y + 2 * xz * x * z + 2 * xw * x + yy * y * y + 2 * yz * y * z + 2 * yw * y + zz * z * z
+				+ 2 * zw * z + ww;
+			return std::max(error, 0.0) / weight;
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double cost;
+	};
+
+	inline auto GetEdgeKey(uint32_t a, uint32_t b) -> uint64_t
+	{
+		return (uint64_t(a) << 32) | b;
+	}
+
+} // namespace
+
+auto AnalyzeVertexCache(const uint16_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize) -> VertexCacheStats
+{
+	if (indexCount < 3)
+		return {};
+
+	const auto misses = SimulateCacheMisses(indices, indexCount, vertexCount, cacheSize);
+	const auto totalMisses = std::accumulate(misses.begin(), misses.end(), 0u);
+
+	std::vector<bool> used(vertexCount, false);
+	for (size_t i = 0; i < indexCount; ++i)
+		used[indices[i]] = true;
+	const auto uniqueVertices = uint32_t(std::count(used.begin(), used.end(), true));
+
+	VertexCacheStats stats{};
+	stats.acmr = float(totalMisses) / float(indexCount / 3);
+	stats.atvr = float(totalMisses) / float(uniqueVertices);
+	return stats;
+}
+
+void OptimizeVertexCache(uint16_t* indices, size_t indexCount, uint32_t vertexCount)
+{
+	const auto triCount = uint32_t(indexCount / 3);
+	if (triCount == 0)
+		return;
+
+	// Vertex -> triangle adjacency. The first `remaining[v]` entries of each vertex's range are the triangles not yet emitted.
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (size_t i = 0; i < indexCount; ++i)
+		++remaining[indices[i]];
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (auto v = 0u; v < vertexCount; ++v)
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remaining[v];
+
+	std::vector<uint32_t> adjacency(indexCount);
+	{
+		auto cursors = adjacencyOffsets;
+		for (size_t i = 0; i < indexCount; ++i)
+			adjacency[cursors[indices[i]]++] = uint32_t(i / 3);
+	}
+
+	std::vector<uint32_t> cachePositions(vertexCount, INVALID_INDEX);
+	std::vector<float> vertexScores(vertexCount);
+	for (auto v = 0u; v < vertexCount; ++v)
+		vertexScores[v] = FindVertexScore(INVALID_INDEX, remaining[v]);
+
+	std::vector<float> triScores(triCount);
+	std::vector<bool> triEmitted(triCount, false);
+	for (auto t = 0u; t < triCount; ++t)
+		triScores[t] = vertexScores[indices[t * 3 + 0]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+	auto bestTri = uint32_t(std::max_element(triScores.begin(), triScores.end()) - triScores.begin());
+	uint32_t scanCursor = 0;
+
+	std::vector<uint16_t> output;
+	output.reserve(indexCount);
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+	while (output.size() < indexCount)
+	{
+		if (bestTri == INVALID_INDEX)
+		{
+			// Nothing in the cache has triangles left, continue with the next unemitted triangle.
+			while (triEmitted[scanCursor])
+				++scanCursor;
+			bestTri = scanCursor;
+		}
+
+		triEmitted[bestTri] = true;
+		const uint16_t* tri = &indices[size_t(bestTri) * 3];
+		newCache.assign(tri, tri + 3);
+		for (auto i = 0; i < 3; ++i)
+		{
+			const auto v = tri[i];
+			output.push_back(v);
+
+			// Move the emitted triangle past the end of the vertex's remaining range.
+			auto* begin = &adjacency[adjacencyOffsets[v]];
+			auto* end = begin + remaining[v];
+			auto* it = std::find(begin, end, bestTri);
+			std::swap(*it, *(end - 1));
+			--remaining[v];
+		}
+
+		// LRU: the new triangle's vertices go to the front, the rest keep their order.
+		for (const auto v : cache)
+		{
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache.push_back(v);
+		}
+		for (auto i = FORSYTH_CACHE_SIZE; i < newCache.size(); ++i)
+		{
+			cachePositions[newCache[i]] = INVALID_INDEX;
+			vertexScores[newCache[i]] = FindVertexScore(INVALID_INDEX, remaining[newCache[i]]);
+		}
+		newCache.resize(std::min<size_t>(newCache.size(), FORSYTH_CACHE_SIZE));
+		std::swap(cache, newCache);
+
+		for (auto i = 0u; i < cache.size(); ++i)
+		{
+			cachePositions[cache[i]] = i;
+			vertexScores[cache[i]] = FindVertexScore(i, remaining[cache[i]]);
+		}
+
+		// Rescore the remaining triangles of the cached vertices, and pick the best one as the next triangle.
+		bestTri = INVALID_INDEX;
+		float bestScore = -1.0f;
+		for (const auto v : cache)
+		{
+			for (auto i = 0u; i < remaining[v]; ++i)
+			{
+				const auto t = adjacency[adjacencyOffsets[v] + i];
+				triScores[t] = vertexScores[indices[t * 3 + 0]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+				if (triScores[t] > bestScore)
+				{
+					bestScore = triScores[t];
+					bestTri = t;
+				}
+			}
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void OptimizeOverdraw(uint16_t* indices, size_t indexCount, const Vertex* vertices, uint32_t vertexCount, float threshold)
+{
+	const auto triCount = uint32_t(indexCount / 3);
+	if (triCount < 2)
+		return;
+
+	// Split into clusters at "hard" boundaries, triangles that miss the cache on all 3 vertices.
+	// Reordering whole clusters keeps the cache behaviour inside each cluster intact.
+	const auto misses = SimulateCacheMisses(indices, indexCount, vertexCount, OVERDRAW_CACHE_SIZE);
+	std::vector<uint32_t> clusterStarts;
+	for (auto t = 0u; t < triCount; ++t)
+	{
+		if (t == 0 || misses[t] == 3)
+			clusterStarts.push_back(t);
+	}
+	if (clusterStarts.size() < 2)
+		return;
+	clusterStarts.push_back(triCount);
+
+	const auto clusterCount = uint32_t(clusterStarts.size() - 1);
+
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+	for (auto c = 0u; c < clusterCount; ++c)
+	{
+		float clusterArea = 0.0f;
+		for (auto t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+		{
+			const auto& p0 = vertices[indices[t * 3 + 0]].position;
+			const auto& p1 = vertices[indices[t * 3 + 1]].position;
+			const auto& p2 = vertices[indices[t * 3 + 2]].position;
+
+			// Area-weighted: the cross product's length is twice the triangle's area.
+			const auto normal = glm::cross(p1 - p0, p2 - p0);
+			const auto area = glm::length(normal);
+			const auto centroid = (p0 + p1 + p2) / 3.0f;
+
+			clusterCentroids[c] += centroid * area;
+			clusterNormals[c] += normal;
+			clusterArea += area;
+		}
+
+		meshCentroid += clusterCentroids[c];
+		meshArea += clusterArea;
+		if (clusterArea > 0.0f)
+			clusterCentroids[c] /= clusterArea;
+	}
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	// Clusters facing away from the mesh centre are likely to occlude the rest, so draw them first.
+	std::vector<float> sortKeys(clusterCount);
+	for (auto c = 0u; c < clusterCount; ++c)
+	{
+		const auto normalLength = glm::length(clusterNormals[c]);
+		const auto normal = normalLength > 0.0f ? clusterNormals[c] / normalLength : glm::vec3(0.0f);
+		sortKeys[c] = glm::dot(clusterCentroids[c] - meshCentroid, normal);
+	}
+
+	std::vector<uint32_t> clusterOrder(clusterCount);
+	std::iota(clusterOrder.begin(), clusterOrder.end(), 0u);
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint16_t> output;
+	output.reserve(indexCount);
+	for (const auto c : clusterOrder)
+		output.insert(output.end(), indices + size_t(clusterStarts[c]) * 3, indices + size_t(clusterStarts[c + 1]) * 3);
+
+	const auto inputStats = AnalyzeVertexCache(indices, indexCount, vertexCount, OVERDRAW_CACHE_SIZE);
+	const auto outputStats = AnalyzeVertexCache(output.data(), output.size(), vertexCount, OVERDRAW_CACHE_SIZE);
+	if (outputStats.acmr > inputStats.acmr * threshold)
+		return;
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void OptimizeVertexFetch(uint16_t* indices, size_t indexCount, Vertex* vertices, uint32_t vertexCount)
+{
+	std::vector<uint32_t> remap(vertexCount, INVALID_INDEX);
+	uint32_t nextVertex = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		auto& newIndex = remap[indices[i]];
+		if (newIndex == INVALID_INDEX)
+			newIndex = nextVertex++;
+		indices[i] = uint16_t(newIndex);
+	}
+	for (auto v = 0u; v < vertexCount; ++v)
+	{
+		if (remap[v] == INVALID_INDEX)
+			remap[v] = nextVertex++;
+	}
+
+	std::vector<Vertex> reordered(vertexCount);
+	for (auto v = 0u; v < vertexCount; ++v)
+		reordered[remap[v]] = vertices[v];
+	std::copy(reordered.begin(), reordered.end(), vertices);
+}
+
+auto SimplifyMesh(const uint16_t* indices,
+	size_t indexCount,
+	const Vertex* vertices,
+	uint32_t vertexCount,
+	size_t targetIndexCount,
+	float targetError,
+	float* outError) -> std::vector<uint16_t>
+{
+	std::vector<uint16_t> result(indices, indices + indexCount);
+	if (outError)
+		*outError = 0.0f;
+
+	// Vertices that only differ by attributes (UV/normal seams) share a position, and therefore a quadric.
+	std::vector<uint32_t> positionRemap(vertexCount);
+	std::vector<bool> locked(vertexCount, false);
+	{
+		std::map<std::array<float, 3>, uint32_t> firstByPosition;
+		for (auto v = 0u; v < vertexCount; ++v)
+		{
+			const auto& p = vertices[v].position;
+			const auto [it, inserted] = firstByPosition.emplace(std::array<float, 3>{ p.x, p.y, p.z }, v);
+			positionRemap[v] = it->second;
+			if (!inserted)
+				locked[v] = locked[it->second] = true; // Seam
+		}
+	}
+
+	// Edges (in position space) used by a single triangle are borders. Collapsing their vertices would open holes in the silhouette.
+	{
+		std::unordered_set<uint64_t> edges;
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			for (auto e = 0; e < 3; ++e)
+				edges.insert(GetEdgeKey(positionRemap[indices[i + e]], positionRemap[indices[i + (e + 1) % 3]]));
+		}
+		for (const auto edge : edges)
+		{
+			const auto a = uint32_t(edge >> 32);
+			const auto b = uint32_t(edge & 0xFFFFFFFF);
+			if (edges.count(GetEdgeKey(b, a)) == 0)
+				locked[a] = locked[b] = true;
+		}
+		// Propagate to the seam copies of locked positions.
+		for (auto v = 0u; v < vertexCount; ++v)
+			locked[v] = locked[v] || locked[positionRemap[v]];
+	}
+
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < indexCount; i += 3)
+	{
+		const glm::dvec3 p0(vertices[indices[i + 0]].position);
+		const glm::dvec3 p1(vertices[indices[i + 1]].position);
+		const glm::dvec3 p2(vertices[indices[i + 2]].position);
+
+		auto normal = glm::cross(p1 - p0, p2 - p0);
+		const auto length = glm::length(normal);
+		if (length <= 0.0)
+			continue;
+		normal /= length;
+
+		const auto area = length * 0.5;
+		for (auto j = 0; j < 3; ++j)
+			quadrics[positionRemap[indices[i + j]]].AddPlane(normal, -glm::dot(normal, p0), area);
+	}
+
+	const auto maxCost = double(targetError) * double(targetError);
+	double resultCost = 0.0;
+
+	std::vector<uint32_t> collapseRemap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+	std::vector<uint32_t> adjacency;
+	std::vector<Collapse> collapses;
+	while (result.size() > targetIndexCount)
+	{
+		// Vertex -> triangle adjacency of the current result, for the flip test.
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (const auto index : result)
+			++adjacencyOffsets[index + 1];
+		std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+		adjacency.resize(result.size());
+		{
+			auto cursors = adjacencyOffsets;
+			for (size_t i = 0; i < result.size(); ++i)
+				adjacency[cursors[result[i]]++] = uint32_t(i / 3);
+		}
+
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (auto e = 0; e < 3; ++e)
+			{
+				const auto a = result[i + e];
+				const auto b = result[i + (e + 1) % 3];
+				// The opposite half-edge, in the neighbouring triangle, adds the b -> a collapse.
+				if (locked[a])
+					continue;
+
+				auto quadric = quadrics[positionRemap[a]];
+				quadric.Add(quadrics[positionRemap[b]]);
+				collapses.push_back({ a, b, quadric.Evaluate(vertices[b].position) });
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) { return lhs.cost < rhs.cost; });
+
+		std::iota(collapseRemap.begin(), collapseRemap.end(), 0u);
+		std::fill(touched.begin(), touched.end(), false);
+
+		// Each collapse removes the two triangles sharing the edge (one on a border). Collapses in a pass never share a triangle.
+		auto triangleCount = result.size() / 3;
+		const auto targetTriangleCount = targetIndexCount / 3;
+		auto collapseCount = 0u;
+		for (const auto& collapse : collapses)
+		{
+			if (collapse.cost > maxCost || triangleCount <= targetTriangleCount)
+				break;
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+
+			const auto from = collapse.from;
+			const auto to = collapse.to;
+			const auto& toPosition = vertices[to].position;
+
+			// Reject collapses that would flip a remaining triangle.
+			auto removedTriangles = 0u;
+			auto isValid = true;
+			for (auto i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1] && isValid; ++i)
+			{
+				const auto* tri = &result[size_t(adjacency[i]) * 3];
+				if (tri[0] == to || tri[1] == to || tri[2] == to)
+				{
+					++removedTriangles;
+					continue;
+				}
+
+				glm::vec3 before[3];
+				glm::vec3 after[3];
+				for (auto j = 0; j < 3; ++j)
+				{
+					before[j] = vertices[tri[j]].position;
+					after[j] = tri[j] == from ? toPosition : before[j];
+				}
+				const auto normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				const auto normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+				isValid = glm::dot(normalBefore, normalAfter) > 0.0f;
+			}
+			if (!isValid)
+				continue;
+
+			collapseRemap[from] = to;
+			quadrics[positionRemap[to]].Add(quadrics[positionRemap[from]]);
+			resultCost = std::max(resultCost, collapse.cost);
+			triangleCount -= std::min<size_t>(removedTriangles, triangleCount);
+			++collapseCount;
+
+			// Lock the whole neighbourhood for this pass, so later flip tests see up-to-date triangles.
+			for (auto i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; ++i)
+			{
+				const auto* tri = &result[size_t(adjacency[i]) * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+			}
+		}
+
+		if (collapseCount == 0)
+			break;
+
+		size_t writeIndex = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			const auto a = uint16_t(collapseRemap[result[i + 0]]);
+			const auto b = uint16_t(collapseRemap[result[i + 1]]);
+			const auto c = uint16_t(collapseRemap[result[i + 2]]);
+			if (a == b || b == c || c == a)
+				continue;
+
+			result[writeIndex++] = a;
+			result[writeIndex++] = b;
+			result[writeIndex++] = c;
+		}
+		result.resize(writeIndex);
+	}
+
+	if (outError)
+		*outError = float(std::sqrt(resultCost));
+	return result;
+}
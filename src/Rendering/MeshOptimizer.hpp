@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Vertex.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Import-time index/vertex reordering. CPU only (no GPU/VkMana dependency).
+ * All functions work on a single submesh: indices are triangle lists relative to the submesh's first vertex.
+ */
+
+struct VertexCacheStats
+{
+	float acmr = 0.0f; // Average cache miss ratio, transformed vertices per triangle. 0.5 is optimal, 3.0 is worst.
+	float atvr = 0.0f; // Average transformed vertex ratio, transformed vertices per unique vertex. 1.0 is optimal.
+};
+
+/**
+ * Simulates a FIFO post-transform cache of `cacheSize` entries.
+ */
+auto AnalyzeVertexCache(const uint16_t* indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize = 16) -> VertexCacheStats;
+
+/**
+ * Reorders triangles for post-transform cache efficiency (Forsyth, "Linear-Speed Vertex Cache Optimisation").
+ */
+void OptimizeVertexCache(uint16_t* indices, size_t indexCount, uint32_t vertexCount);
+
+/**
+ * Reorders clusters of cache-optimized triangles so outward facing clusters draw first, reducing overdraw.
+ * The reorder is rejected if it makes the ACMR worse than `threshold` times the input ACMR.
+ */
+void OptimizeOverdraw(uint16_t* indices, size_t indexCount, const Vertex* vertices, uint32_t vertexCount, float threshold = 1.05f);
+
+/**
+ * Reorders vertices into first-use order for fetch locality, and remaps the indices to match.
+ * Unreferenced vertices are kept, after all referenced ones.
+ */
+void OptimizeVertexFetch(uint16_t* indices, size_t indexCount, Vertex* vertices, uint32_t vertexCount);
+
+/**
+ * Simplifies a triangle list by quadric edge collapse (Garland & Heckbert, "Surface Simplification Using Quadric Error Metrics").
+ * Vertices are only merged into existing ones, so the result indexes the same vertices as the input.
+ * Border and attribute seam vertices are locked, so the silhouette and UV layout are kept.
+ *
+ * Stops once the index count reaches `targetIndexCount`, or when the next collapse would exceed `targetError` (RMS distance to the
+ * original surface, in mesh units). `outError` receives the largest error of the collapses made.
+ */
+auto SimplifyMesh(const uint16_t* indices,
+	size_t indexCount,
+	const Vertex* vertices,
+	uint32_t vertexCount,
+	size_t targetIndexCount,
+	float targetError,
+	float* outError = nullptr) -> std::vector<uint16_t>;
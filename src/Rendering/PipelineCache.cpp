@@ -0,0 +1,160 @@
+#include "PipelineCache.hpp"
+
+#include "Core/Hash.hpp"
+#include "Core/Logging.hpp"
+#include "Core/MappedFile.hpp"
+#include "Core/TempFile.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+namespace
+{
+	constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x43504C50; // "PLPC"
+	constexpr uint32_t PIPELINE_CACHE_VERSION = 1;
+
+	/* Wraps the driver blob, so truncated/corrupt files are caught before the driver sees them. */
+	struct PipelineCacheFileHeader
+	{
+		uint32_t magic = PIPELINE_CACHE_MAGIC;
+		uint32_t version = PIPELINE_CACHE_VERSION;
+		uint64_t dataSize = 0;
+		uint64_t dataHash = 0;
+	};
+
+	/* VkPipelineCacheHeaderVersionOne, at the start of the driver blob. */
+	struct DriverCacheHeader
+	{
+		uint32_t headerSize;
+		uint32_t headerVersion;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	};
+	static_assert(sizeof(DriverCacheHeader) == 32);
+} // namespace
+
+PipelineCache::~PipelineCache()
+{
+	Shutdown();
+}
+
+bool PipelineCache::Init(vk::PhysicalDevice physicalDevice, vk::Device device, const std::filesystem::path& filename)
+{
+	m_physicalDevice = physicalDevice;
+	m_device = device;
+	m_filename = filename;
+
+	const auto initialData = LoadValidatedData();
+	m_loadedSize = initialData.size();
+
+	vk::PipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.setInitialDataSize(initialData.size());
+	cacheInfo.setPInitialData(initialData.data());
+	const auto result = m_device.createPipelineCache(&cacheInfo, nullptr, &m_cache);
+	if (result != vk::Result::eSuccess)
+	{
+		LOG_ERR("Failed to create pipeline cache: {}", vk::to_string(result));
+		m_cache = nullptr;
+		return false;
+	}
+	return true;
+}
+
+void PipelineCache::Shutdown()
+{
+	if (m_cache)
+		m_device.destroyPipelineCache(m_cache);
+	m_cache = nullptr;
+}
+
+bool PipelineCache::Save() const
+{
+	if (!m_cache || m_filename.empty())
+		return false;
+
+	size_t dataSize = 0;
+	if (m_device.getPipelineCacheData(m_cache, &dataSize, nullptr) != vk::Result::eSuccess)
+		return false;
+	std::vector<uint8_t> data(dataSize);
+	if (m_device.getPipelineCacheData(m_cache, &dataSize, data.data()) != vk::Result::eSuccess)
+		return false;
+	data.resize(dataSize);
+
+	PipelineCacheFileHeader header{};
+	header.dataSize = data.size();
+	header.dataHash = HashBytes(data.data(), data.size());
+
+	std::error_code err;
+	std::filesystem::create_directories(m_filename.parent_path(), err);
+
+	// Write to a temporary file and rename it into place, so a crash mid-write never leaves a partial cache behind. Another process
+	// may be saving at the same time, the last rename wins.
+	const auto tempFilename = GetTempFilename(m_filename);
+	{
+		std::ofstream stream(tempFilename, std::ios::binary | std::ios::trunc);
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(reinterpret_cast<const char*>(data.data()), std::streamsize(data.size()));
+		if (!stream)
+		{
+			LOG_WARN("Failed to write pipeline cache: {}", m_filename.string());
+			stream.close();
+			std::filesystem::remove(tempFilename, err);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempFilename, m_filename, err);
+	if (err)
+	{
+		std::filesystem::remove(tempFilename, err);
+		return false;
+	}
+
+	LOG_INFO("Saved pipeline cache: {} bytes", data.size());
+	return true;
+}
+
+auto PipelineCache::LoadValidatedData() const -> std::vector<uint8_t>
+{
+	MappedFile file;
+	if (!file.Open(m_filename))
+		return {};
+
+	const auto fileSize = uint64_t(file.GetSize());
+	if (fileSize < sizeof(PipelineCacheFileHeader))
+	{
+		LOG_WARN("Ignoring invalid pipeline cache: {}", m_filename.string());
+		return {};
+	}
+
+	const auto& header = *reinterpret_cast<const PipelineCacheFileHeader*>(file.GetData());
+	if (header.magic != PIPELINE_CACHE_MAGIC || header.version != PIPELINE_CACHE_VERSION
+		|| header.dataSize != fileSize - sizeof(PipelineCacheFileHeader) || header.dataSize < sizeof(DriverCacheHeader))
+	{
+		LOG_WARN("Ignoring invalid pipeline cache: {}", m_filename.string());
+		return {};
+	}
+
+	const auto* data = file.GetData() + sizeof(PipelineCacheFileHeader);
+	if (HashBytes(data, header.dataSize) != header.dataHash)
+	{
+		LOG_WARN("Ignoring corrupt pipeline cache: {}", m_filename.string());
+		return {};
+	}
+
+	DriverCacheHeader driverHeader{};
+	std::memcpy(&driverHeader, data, sizeof(driverHeader));
+
+	const auto properties = m_physicalDevice.getProperties();
+	if (driverHeader.headerSize < sizeof(DriverCacheHeader) || driverHeader.headerVersion != uint32_t(vk::PipelineCacheHeaderVersion::eOne)
+		|| driverHeader.vendorID != properties.vendorID || driverHeader.deviceID != properties.deviceID
+		|| std::memcmp(driverHeader.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE) != 0)
+	{
+		LOG_INFO("Pipeline cache was written by a different device or driver, starting empty");
+		return {};
+	}
+
+	return { data, data + header.dataSize };
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <VkMana/Context.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+/**
+ * VkPipelineCache persisted to disk between runs.
+ *
+ * On load, the driver blob is rejected (and the cache starts empty) if it is corrupt or was written by a different vendor, device or
+ * driver (pipelineCacheUUID). Drivers are not required to survive bad cache data, so it is never handed to them unchecked.
+ */
+class PipelineCache
+{
+public:
+	PipelineCache() = default;
+	~PipelineCache();
+
+	PipelineCache(const PipelineCache&) = delete;
+	auto operator=(const PipelineCache&) -> PipelineCache& = delete;
+
+	/**
+	 * Creates the cache, seeded from `filename` when it holds valid data for this device.
+	 */
+	bool Init(vk::PhysicalDevice physicalDevice, vk::Device device, const std::filesystem::path& filename);
+	void Shutdown();
+
+	/**
+	 * Writes the current cache contents back to the file given to Init().
+	 */
+	bool Save() const;
+
+	//////////////////////////////////////////////////
+	/// Getters
+	//////////////////////////////////////////////////
+
+	auto Get() const -> vk::PipelineCache { return m_cache; }
+	auto GetLoadedSize() const -> uint64_t { return m_loadedSize; }
+	bool IsWarm() const { return m_loadedSize != 0; }
+
+private:
+	auto LoadValidatedData() const -> std::vector<uint8_t>;
+
+private:
+	vk::PhysicalDevice m_physicalDevice = nullptr;
+	vk::Device m_device = nullptr;
+	vk::PipelineCache m_cache = nullptr;
+	std::filesystem::path m_filename;
+	uint64_t m_loadedSize = 0; // Bytes of driver data the cache was seeded with
+};
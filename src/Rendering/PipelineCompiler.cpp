@@ -0,0 +1,135 @@
+#include "PipelineCompiler.hpp"
+
+#include "Core/Logging.hpp"
+#include "Core/Profiler.hpp"
+
+#include <algorithm>
+
+PipelineCompiler::PipelineCompiler(VkMana::Context& ctx, ShaderCache& shaderCache, PipelineCache& pipelineCache)
+	: m_ctx(&ctx), m_shaderCache(&shaderCache), m_pipelineCache(&pipelineCache)
+{
+}
+
+PipelineCompiler::~PipelineCompiler()
+{
+	// Workers reference this compiler (and the caches), they must be done before anything is destroyed.
+	WaitForAll();
+}
+
+auto PipelineCompiler::CompileShader(const VkMana::ShaderCompileInfo& info) -> ShaderRequest
+{
+	if (m_pending.empty() && m_createdCount == 0)
+		m_startTime = std::chrono::high_resolution_clock::now();
+
+	auto compiled = std::make_shared<JobCounter>();
+	auto future = JobSystem::Get().Enqueue(
+		[shaderCache = m_shaderCache, info] {
+			PROFILE_SCOPE("CompileShader");
+			auto spirv = shaderCache->Compile(info);
+			if (!spirv)
+				LOG_ERR("Failed to compile shader: {} ({})", info.EntryPoint, vk::to_string(info.Stage));
+			return spirv;
+		},
+		compiled.get());
+	m_shaderJobs.push_back(compiled);
+	return { future.share(), info.EntryPoint, std::move(compiled) };
+}
+
+void PipelineCompiler::CreatePipeline(
+	VkMana::PipelineHandle& target, VkMana::GraphicsPipelineCreateInfo info, ShaderRequest vertex, ShaderRequest fragment, bool required)
+{
+	// Only starts once both shaders are done, so the spirv futures are ready and get() does not block.
+	auto* vertexCompiled = vertex.compiled.get();
+	auto* fragmentCompiled = fragment.compiled.get();
+	auto future = JobSystem::Get().Enqueue(
+		[this, info = std::move(info), vertex = std::move(vertex), fragment = std::move(fragment)]() mutable {
+			const auto& vertexSpirv = vertex.spirv.get();
+			const auto& fragmentSpirv = fragment.spirv.get();
+			if (!vertexSpirv || !fragmentSpirv)
+				return VkMana::PipelineHandle(nullptr);
+
+			info.Vertex = { vertexSpirv.value(), vertex.entryPoint };
+			info.Fragment = { fragmentSpirv.value(), fragment.entryPoint };
+			info.Cache = m_pipelineCache->Get();
+
+			PROFILE_SCOPE("CreateGraphicsPipeline");
+			const auto startTime = std::chrono::high_resolution_clock::now();
+			auto pipeline = m_ctx->CreateGraphicsPipeline(info);
+			const auto endTime = std::chrono::high_resolution_clock::now();
+
+			m_createTimeUs += uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count());
+			++m_createdCount;
+			return pipeline;
+		},
+		required ? &m_requiredJobs : nullptr,
+		{ vertexCompiled, fragmentCompiled });
+	m_pending.push_back({ &target, std::move(future), required });
+}
+
+bool PipelineCompiler::WaitForRequired()
+{
+	// Help with the compiles instead of blocking, the futures below are then ready.
+	JobSystem::Get().Wait(m_requiredJobs);
+
+	auto success = true;
+	for (auto& pending : m_pending)
+	{
+		if (pending.required)
+			success &= Publish(pending);
+	}
+	m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(), [](const PendingPipeline& pending) { return pending.required; }),
+		m_pending.end());
+
+	LOG_INFO("Required pipelines ready after {:.2f} ms ({} pipelines created, {:.2f} ms across threads), {} still compiling in the background",
+		GetElapsedMs(),
+		uint32_t(m_createdCount),
+		float(m_createTimeUs) / 1000.0f,
+		m_pending.size());
+	return success;
+}
+
+void PipelineCompiler::Poll()
+{
+	if (m_pending.empty())
+		return;
+
+	const auto isReady = [](const PendingPipeline& pending) {
+		return pending.future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	};
+	for (auto& pending : m_pending)
+	{
+		if (isReady(pending))
+			Publish(pending);
+	}
+	m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(), [](const PendingPipeline& pending) { return !pending.future.valid(); }),
+		m_pending.end());
+
+	if (m_pending.empty())
+		LOG_INFO("All pipelines ready after {:.2f} ms ({} pipelines, {:.2f} ms across threads)",
+			GetElapsedMs(),
+			uint32_t(m_createdCount),
+			float(m_createTimeUs) / 1000.0f);
+}
+
+void PipelineCompiler::WaitForAll()
+{
+	for (auto& pending : m_pending)
+		Publish(pending);
+	m_pending.clear();
+
+	for (auto& shaderJob : m_shaderJobs)
+		JobSystem::Get().Wait(*shaderJob);
+	m_shaderJobs.clear();
+}
+
+bool PipelineCompiler::Publish(PendingPipeline& pending)
+{
+	*pending.target = pending.future.get();
+	return bool(*pending.target);
+}
+
+auto PipelineCompiler::GetElapsedMs() const -> float
+{
+	const auto now = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<float, std::milli>(now - m_startTime).count();
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Core/JobSystem.hpp"
+#include "PipelineCache.hpp"
+#include "ShaderCache.hpp"
+
+#include <VkMana/Context.hpp>
+#include <VkMana/ShaderCompiler.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * A shader stage compiling on the job system.
+ */
+struct ShaderRequest
+{
+	std::shared_future<std::optional<std::vector<uint32_t>>> spirv;
+	std::string entryPoint;
+	std::shared_ptr<JobCounter> compiled; // Reaches zero once `spirv` is ready
+};
+
+/**
+ * Compiles shaders and creates pipelines concurrently on the job system. Pipeline jobs depend on their shaders' jobs, so no worker
+ * ever blocks on a shader.
+ *
+ * Pipelines are either required (WaitForRequired() blocks on them, eg. before the first frame) or background: those are published to
+ * their target handle by Poll() whenever they finish, so they must be null-checked before use.
+ * Target handles are only ever written on the calling thread (in WaitForRequired()/Poll()), never by the workers.
+ */
+class PipelineCompiler
+{
+public:
+	PipelineCompiler(VkMana::Context& ctx, ShaderCache& shaderCache, PipelineCache& pipelineCache);
+	~PipelineCompiler();
+
+	PipelineCompiler(const PipelineCompiler&) = delete;
+	auto operator=(const PipelineCompiler&) -> PipelineCompiler& = delete;
+
+	auto CompileShader(const VkMana::ShaderCompileInfo& info) -> ShaderRequest;
+	/**
+	 * Creates the pipeline once `vertex` and `fragment` have compiled. `info.Vertex`/`info.Fragment` are filled in from them.
+	 * `target` must outlive the compiler.
+	 */
+	void CreatePipeline(
+		VkMana::PipelineHandle& target, VkMana::GraphicsPipelineCreateInfo info, ShaderRequest vertex, ShaderRequest fragment, bool required);
+
+	/**
+	 * Blocks until every required pipeline is created. Returns false if any of them failed.
+	 */
+	bool WaitForRequired();
+	/**
+	 * Publishes the background pipelines that have finished, without blocking.
+	 */
+	void Poll();
+	/**
+	 * Blocks until every pipeline (required or not) is created.
+	 */
+	void WaitForAll();
+
+	//////////////////////////////////////////////////
+	/// Getters
+	//////////////////////////////////////////////////
+
+	bool IsIdle() const { return m_pending.empty(); }
+
+private:
+	struct PendingPipeline
+	{
+		VkMana::PipelineHandle* target;
+		std::future<VkMana::PipelineHandle> future;
+		bool required;
+	};
+
+	/* Blocks on `pending` and publishes it. Returns false if the pipeline failed. */
+	bool Publish(PendingPipeline& pending);
+	auto GetElapsedMs() const -> float;
+
+private:
+	VkMana::Context* m_ctx = nullptr;
+	ShaderCache* m_shaderCache = nullptr;
+	PipelineCache* m_pipelineCache = nullptr;
+
+	std::vector<PendingPipeline> m_pending;
+	std::vector<std::shared_ptr<JobCounter>> m_shaderJobs; // Kept until WaitForAll(), even if no pipeline uses the shader
+	JobCounter m_requiredJobs;
+	std::chrono::high_resolution_clock::time_point m_startTime{};
+
+	std::atomic_uint32_t m_createdCount = 0;
+	std::atomic_uint64_t m_createTimeUs = 0; // Summed over worker threads
+};
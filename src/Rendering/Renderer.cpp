@@ -1,11 +1,86 @@
 #include "Renderer.hpp"
 
+#include "Core/JobSystem.hpp"
 #include "Core/Logging.hpp"
+#include "Core/Profiler.hpp"
+#include "Core/RadixSort.hpp"
+
+#include "VertexPacking.hpp"
 
 #include <VkMana/ShaderCompiler.hpp>
 
+#include <glm/geometric.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+constexpr float LOD_ERROR_THRESHOLD_PIXELS = 1.0f;
+constexpr uint64_t GEOMETRY_VERTEX_CAPACITY = 64ull * 1024 * 1024;
+constexpr uint64_t GEOMETRY_INDEX_CAPACITY = 16ull * 1024 * 1024;
+constexpr uint64_t UPLOAD_BUDGET = 4ull * 1024 * 1024; // Bytes of textures and geometry uploaded per frame, the rest waits for later frames.
+constexpr uint64_t FRAME_RING_CAPACITY = 1024ull * 1024; // Per frame, grows on demand.
+constexpr auto SHADER_CACHE_DIR = "cache/shaders";
+constexpr auto PIPELINE_CACHE_FILENAME = "cache/pipelines.bin";
+constexpr uint32_t RECORD_MIN_BATCHES_PER_THREAD = 256;	 // Below this, a secondary command buffer costs more than it saves.
+constexpr size_t INSTANCE_JOB_GRAIN = 4096;				 // Instances per job when gathering sort keys and instance data.
+constexpr uint32_t RENDER_THREAD_SPIN_COUNT = 1000;		 // Yields before a hand-off wait backs off to sleeping.
+constexpr auto RENDER_THREAD_BACKOFF_SLEEP = std::chrono::microseconds(50);
+
+namespace
+{
+	/**
+	 * Draw order, most significant first: pipeline (2 bits), mesh (16 bits), material (16 bits), submesh (10 bits), LOD (2 bits), depth (16 bits).
+	 * Instances of the same submesh LOD end up adjacent, so they can be merged into one instanced draw.
+	 * Indices are truncated. A collision only costs a redundant bind or a split batch, never a wrong draw.
+	 */
+	auto MakeSortKey(uint32_t pipelineIndex, uint32_t meshIndex, uint32_t materialIndex, uint32_t submeshIndex, uint32_t lodIndex, float viewDepth)
+		-> uint64_t
+	{
+		// The upper 16 bits of a positive float are monotonic with its value, so nearer instances draw first.
+		uint32_t depthBits = 0;
+		const auto depth = std::max(viewDepth, 0.0f);
+		std::memcpy(&depthBits, &depth, sizeof(depth));
+
+		return (uint64_t(pipelineIndex & 0x3) << 62) | (uint64_t(meshIndex & 0xFFFF) << 46) | (uint64_t(materialIndex & 0xFFFF) << 30)
+			| (uint64_t(submeshIndex & 0x3FF) << 20) | (uint64_t(lodIndex & 0x3) << 18) | (uint64_t(depthBits >> 16) << 2);
+	}
+
+	/* Spins for a short while, then sleeps in short steps. Neither side of the hand-off takes a lock, this is all waiting costs. */
+	template <typename Predicate>
+	void WaitUntil(Predicate&& predicate)
+	{
+		for (auto spin = 0u; !predicate(); ++spin)
+		{
+			if (spin < RENDER_THREAD_SPIN_COUNT)
+				std::this_thread::yield();
+			else
+				std::this_thread::sleep_for(RENDER_THREAD_BACKOFF_SLEEP);
+		}
+	}
+
+	auto GetElapsedMs(std::chrono::high_resolution_clock::time_point startTime) -> float
+	{
+		return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	/* Adds the counters written while recording draws. */
+	void AccumulateDrawStats(RenderStats& dst, const RenderStats& src)
+	{
+		dst.drawCalls += src.drawCalls;
+		dst.pipelineBinds += src.pipelineBinds;
+		dst.vertexBufferBinds += src.vertexBufferBinds;
+		dst.indexBufferBinds += src.indexBufferBinds;
+		for (auto i = 0u; i < MAX_SUBMESH_LODS; ++i)
+		{
+			dst.lodDrawCounts[i] += src.lodDrawCounts[i];
+			dst.lodTriangleCounts[i] += src.lodTriangleCounts[i];
+		}
+	}
+} // namespace
+
 const auto TriangleHLSLShader = R"(
 struct VSOutput
 {
@@ -51,6 +126,24 @@ PSOutput PSMain(PSInput input)
 }
 )";
 
+Renderer::~Renderer()
+{
+	if (m_renderThread.joinable())
+	{
+		// Frames already flushed are still submitted.
+		m_stopRenderThread.store(true, std::memory_order_release);
+		m_renderThread.join();
+	}
+
+	m_pipelineCompiler.WaitForAll();
+	m_pipelineCache.Save();
+
+	// The timestamp queries may still be referenced by frames in flight.
+	if (m_ctx.GetDevice())
+		m_ctx.GetDevice().waitIdle();
+	m_gpuTimer.Shutdown();
+}
+
 bool Renderer::Init(VkMana::WSI& window)
 {
 	m_window = &window;
@@ -61,20 +154,40 @@ bool Renderer::Init(VkMana::WSI& window)
 		return false;
 	}
 
+	if (!m_geometry.Init(GEOMETRY_VERTEX_CAPACITY, GEOMETRY_INDEX_CAPACITY, UPLOAD_BUDGET))
+		return false;
+	if (!m_frameRing.Init(FRAME_RING_CAPACITY))
+		return false;
+	m_shaderCache.Init(SHADER_CACHE_DIR);
+	if (m_usePipelineCache && !m_pipelineCache.Init(m_ctx.GetPhysicalDevice(), m_ctx.GetDevice(), PIPELINE_CACHE_FILENAME))
+		LOG_WARN("Continuing without a pipeline cache");
+	m_gpuTimer.Init(m_ctx.GetPhysicalDevice(), m_ctx.GetDevice());
+
+	// Indirect batches draw several commands per call, each starting at its batch's first instance. Vulkan cannot report which
+	// features a device was created with, so this relies on the context enabling every supported one (see VkManaRequirements.cpp).
+	const auto features = m_ctx.GetPhysicalDevice().getFeatures();
+	m_indirectDrawSupported = features.multiDrawIndirect && features.drawIndirectFirstInstance;
+	SetDrawMode(m_requestedDrawMode);
+
 	{
 		const auto imageInfo = VkMana::ImageCreateInfo::Texture(1, 1, false);
 
 		// White Texture
 		constexpr uint8_t whitePixels[] = { 255, 255, 255, 255 };
-		m_whiteTexture = std::make_unique<Texture>(m_ctx);
+		m_whiteTexture = std::make_shared<Texture>(m_ctx);
 		assert(m_whiteTexture->FromData(1, 1, whitePixels));
+		m_assets.AddBuiltinTexture("builtin://white", m_whiteTexture);
 
 		// White Texture
 		constexpr uint8_t blackPixels[] = { 0, 0, 0, 255 };
-		m_blackTexture = std::make_unique<Texture>(m_ctx);
+		m_blackTexture = std::make_shared<Texture>(m_ctx);
 		assert(m_blackTexture->FromData(1, 1, blackPixels));
+		m_assets.AddBuiltinTexture("builtin://black", m_blackTexture);
 	}
 
+	m_assets.AddTextureEvictedCallback([this](const Texture* texture) { OnTextureEvicted(texture); });
+	m_assets.AddMeshEvictedCallback([this](const Mesh* mesh) { OnMeshEvicted(mesh); });
+
 	{
 		// Depth Target
 		const auto imageInfo = VkMana::ImageCreateInfo::DepthStencilTarget(window.GetSurfaceWidth(), window.GetSurfaceHeight(), false);
@@ -85,208 +198,426 @@ bool Renderer::Init(VkMana::WSI& window)
 		// Bindless set layout
 		std::vector bindings{
 			VkMana::SetLayoutBinding(
-				0, vk::DescriptorType::eCombinedImageSampler, 10000, vk::ShaderStageFlagBits::eFragment, vk::DescriptorBindingFlagBits::ePartiallyBound),
+				0, vk::DescriptorType::eCombinedImageSampler, BINDLESS_TEXTURE_CAPACITY, vk::ShaderStageFlagBits::eFragment, vk::DescriptorBindingFlagBits::ePartiallyBound),
 		};
 		m_bindlesSetLayout = m_ctx.CreateSetLayout(bindings);
 	}
 	{
 		// Scene set layout
 		std::vector bindings{
-			VkMana::SetLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex),
+			VkMana::SetLayoutBinding(0, vk::DescriptorType::eUniformBufferDynamic, 1, vk::ShaderStageFlagBits::eVertex),
 		};
 		m_sceneSetLayout = m_ctx.CreateSetLayout(bindings);
 	}
 	{
 		// Material set layout
 		std::vector bindings{
-			VkMana::SetLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eFragment),
+			VkMana::SetLayoutBinding(0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eFragment),
 		};
 		m_materialSetLayout = m_ctx.CreateSetLayout(bindings);
 	}
+	if (!m_bindless.Init(m_bindlesSetLayout, m_materialSetLayout, m_whiteTexture->GetImage()->GetImageView(VkMana::ImageViewType::Texture)))
+		return false;
+	// Slot 0, also the fallback when the table is full.
+	m_whiteTextureSlot = AddOrGetBindlessTexture(m_whiteTexture.get());
+	m_blackTextureSlot = AddOrGetBindlessTexture(m_blackTexture.get());
 	{
-		// Triangle Pipeline
-		const VkMana::PipelineLayoutCreateInfo pipelineLayoutInfo{};
-		auto pipelineLayout = m_ctx.CreatePipelineLayout(pipelineLayoutInfo);
-
-		VkMana::ShaderCompileInfo compileInfo{
-			.SrcLanguage = VkMana::SourceLanguage::HLSL,
-			.SrcString = TriangleHLSLShader,
-			.Stage = vk::ShaderStageFlagBits::eVertex,
-			.EntryPoint = "VSMain",
-			.Debug = false,
+		// Instance set layout
+		std::vector bindings{
+			VkMana::SetLayoutBinding(0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex),
 		};
-		const auto vertSpirvOpt = VkMana::CompileShader(compileInfo);
-		if (!vertSpirvOpt)
-		{
-			VM_ERR("Failed to compiler VERTEX shader.");
-			return false;
-		}
-
-		compileInfo.Stage = vk::ShaderStageFlagBits::eFragment;
-		compileInfo.EntryPoint = "PSMain";
-		const auto fragSpirvOpt = VkMana::CompileShader(compileInfo);
-		if (!fragSpirvOpt)
+		m_instanceSetLayout = m_ctx.CreateSetLayout(bindings);
+	}
+	{
+		// Pipelines. All shader stages compile and all pipelines are created concurrently on the thread pool.
+		// Only the pipelines used by Flush() are waited on, the rest are picked up by Flush() once they finish.
+		std::string cacheState = "no pipeline cache";
+		if (m_pipelineCache.Get())
+			cacheState = m_pipelineCache.IsWarm() ? fmt::format("warm pipeline cache, {} bytes", m_pipelineCache.GetLoadedSize()) : "cold pipeline cache";
+		LOG_INFO("Building pipelines ({})", cacheState);
+
+		// Triangle Pipeline (not drawn, built in the background)
 		{
-			VM_ERR("Failed to compiler FRAGMENT shader.");
-			return false;
+			const VkMana::PipelineLayoutCreateInfo pipelineLayoutInfo{};
+			auto pipelineLayout = m_ctx.CreatePipelineLayout(pipelineLayoutInfo);
+
+			VkMana::ShaderCompileInfo compileInfo{
+				.SrcLanguage = VkMana::SourceLanguage::HLSL,
+				.SrcString = TriangleHLSLShader,
+				.Stage = vk::ShaderStageFlagBits::eVertex,
+				.EntryPoint = "VSMain",
+				.Debug = false,
+			};
+			auto vertShader = m_pipelineCompiler.CompileShader(compileInfo);
+
+			compileInfo.Stage = vk::ShaderStageFlagBits::eFragment;
+			compileInfo.EntryPoint = "PSMain";
+			auto fragShader = m_pipelineCompiler.CompileShader(compileInfo);
+
+			const VkMana::GraphicsPipelineCreateInfo pipelineInfo{
+				.Topology = vk::PrimitiveTopology::eTriangleList,
+				.ColorTargetFormats = { vk::Format::eB8G8R8A8Srgb },
+				.Layout = pipelineLayout,
+			};
+			m_pipelineCompiler.CreatePipeline(m_trianglePipeline, pipelineInfo, vertShader, fragShader, false);
 		}
 
-		const VkMana::GraphicsPipelineCreateInfo pipelineInfo{
-			.Vertex = { vertSpirvOpt.value(), "VSMain" },
-			.Fragment = { fragSpirvOpt.value(), "PSMain" },
-			.Topology = vk::PrimitiveTopology::eTriangleList,
-			.ColorTargetFormats = { vk::Format::eB8G8R8A8Srgb },
-			.Layout = pipelineLayout,
-		};
-		m_trianglePipeline = m_ctx.CreateGraphicsPipeline(pipelineInfo);
-	}
-	{
 		// Foward-Mesh Pipeline
-
-		const VkMana::PipelineLayoutCreateInfo pipelineLayoutInfo{
-			.PushConstantRange = { vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0u, uint32_t(sizeof(glm::mat4) + sizeof(uint32_t)) },
-			.SetLayouts = { m_bindlesSetLayout.Get(), m_sceneSetLayout.Get(), m_materialSetLayout.Get(), },
-		};
-		auto pipelineLayout = m_ctx.CreatePipelineLayout(pipelineLayoutInfo);
-
-		VkMana::ShaderCompileInfo compileInfo{
-			.SrcLanguage = VkMana::SourceLanguage::HLSL,
-			.SrcFilename = "assets/shaders/fwd_mesh.hlsl",
-			.Stage = vk::ShaderStageFlagBits::eVertex,
-			.EntryPoint = "VSMain",
-			.Debug = false,
-		};
-		const auto vertSpirvOpt = VkMana::CompileShader(compileInfo);
-		if (!vertSpirvOpt)
 		{
-			VM_ERR("Failed to compiler VERTEX shader.");
-			return false;
+			const VkMana::PipelineLayoutCreateInfo pipelineLayoutInfo{
+				.SetLayouts = { m_bindlesSetLayout.Get(), m_sceneSetLayout.Get(), m_materialSetLayout.Get(), m_instanceSetLayout.Get(), },
+			};
+			auto pipelineLayout = m_ctx.CreatePipelineLayout(pipelineLayoutInfo);
+
+			VkMana::ShaderCompileInfo compileInfo{
+				.SrcLanguage = VkMana::SourceLanguage::HLSL,
+				.SrcFilename = "assets/shaders/fwd_mesh.hlsl",
+				.Stage = vk::ShaderStageFlagBits::eVertex,
+				.EntryPoint = "VSMain",
+				.Debug = false,
+			};
+			auto vertShader = m_pipelineCompiler.CompileShader(compileInfo);
+
+			compileInfo.EntryPoint = "VSMainPacked";
+			auto packedVertShader = m_pipelineCompiler.CompileShader(compileInfo);
+
+			compileInfo.Stage = vk::ShaderStageFlagBits::eFragment;
+			compileInfo.EntryPoint = "PSMain";
+			auto fragShader = m_pipelineCompiler.CompileShader(compileInfo);
+
+			VkMana::GraphicsPipelineCreateInfo pipelineInfo{
+				.VertexAttributes = {
+					vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, position)),
+					vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32Sfloat, offsetof(Vertex, texCoord)),
+					vk::VertexInputAttributeDescription(2, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, normal)),
+					vk::VertexInputAttributeDescription(3, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, tangent)),
+				},
+				.VertexBindings = {
+					vk::VertexInputBindingDescription(0, sizeof(Vertex), vk::VertexInputRate::eVertex),
+				},
+				.Topology = vk::PrimitiveTopology::eTriangleList,
+				.ColorTargetFormats = { vk::Format::eB8G8R8A8Srgb },
+				.DepthTargetFormat = m_depthTarget->GetFormat(),
+				.Layout = pipelineLayout,
+			};
+			m_pipelineCompiler.CreatePipeline(m_fwdMeshPipeline, pipelineInfo, vertShader, fragShader, true);
+
+			// Packed vertex variant. Shares the layout, so bound descriptor sets stay valid when switching between the two.
+			pipelineInfo.VertexAttributes = {
+				vk::VertexInputAttributeDescription(0, 0, vk::Format::eR16G16B16A16Unorm, offsetof(PackedVertex, position)),
+				vk::VertexInputAttributeDescription(1, 0, vk::Format::eR16G16Sfloat, offsetof(PackedVertex, texCoord)),
+				vk::VertexInputAttributeDescription(2, 0, vk::Format::eR16G16Snorm, offsetof(PackedVertex, normal)),
+				vk::VertexInputAttributeDescription(3, 0, vk::Format::eR16G16Snorm, offsetof(PackedVertex, tangent)),
+			};
+			pipelineInfo.VertexBindings = {
+				vk::VertexInputBindingDescription(0, sizeof(PackedVertex), vk::VertexInputRate::eVertex),
+			};
+			m_pipelineCompiler.CreatePipeline(m_fwdMeshPackedPipeline, pipelineInfo, packedVertShader, fragShader, true);
 		}
 
-		compileInfo.Stage = vk::ShaderStageFlagBits::eFragment;
-		compileInfo.EntryPoint = "PSMain";
-		const auto fragSpirvOpt = VkMana::CompileShader(compileInfo);
-		if (!fragSpirvOpt)
+		if (!m_pipelineCompiler.WaitForRequired())
 		{
-			VM_ERR("Failed to compiler FRAGMENT shader.");
+			LOG_ERR("Failed to create pipelines");
 			return false;
 		}
-
-		const VkMana::GraphicsPipelineCreateInfo pipelineInfo{
-			.Vertex = { vertSpirvOpt.value(), "VSMain" },
-			.Fragment = { fragSpirvOpt.value(), "PSMain" },
-			.VertexAttributes = {
-				vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, position)),
-				vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32Sfloat, offsetof(Vertex, texCoord)),
-				vk::VertexInputAttributeDescription(2, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, normal)),
-				vk::VertexInputAttributeDescription(3, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, tangent)),
-			},
-			.VertexBindings = {
-				vk::VertexInputBindingDescription(0, sizeof(Vertex), vk::VertexInputRate::eVertex),
-			},
-			.Topology = vk::PrimitiveTopology::eTriangleList,
-			.ColorTargetFormats = { vk::Format::eB8G8R8A8Srgb },
-			.DepthTargetFormat = m_depthTarget->GetFormat(),
-			.Layout = pipelineLayout,
-		};
-		m_fwdMeshPipeline = m_ctx.CreateGraphicsPipeline(pipelineInfo);
+		m_shaderCache.LogStats();
 	}
 
+	if (m_useRenderThread)
+		m_renderThread = std::thread(&Renderer::RenderThreadLoop, this);
+
 	return true;
 }
 
+void Renderer::SetDrawMode(DrawMode mode)
+{
+	m_requestedDrawMode = mode;
+	m_drawMode = mode;
+	// Not known before Init(), which applies the requested mode again.
+	if (mode == DrawMode::Indirect && m_window && !m_indirectDrawSupported)
+	{
+		LOG_WARN("Device lacks multiDrawIndirect or drawIndirectFirstInstance, using direct draws instead of indirect");
+		m_drawMode = DrawMode::Direct;
+	}
+}
+
 void Renderer::SetCamera(const glm::mat4& projMatrix, const glm::mat4& viewMatrix)
 {
-	m_sceneData.projMatrix = projMatrix;
-	m_sceneData.viewMatrix = viewMatrix;
+	auto& sceneData = m_packets[m_buildPacketIndex].sceneData;
+	sceneData.projMatrix = projMatrix;
+	sceneData.viewMatrix = viewMatrix;
 }
 
 void Renderer::Submit(Mesh* mesh, const glm::mat4& transform)
 {
+	SubmitInstanced(mesh, &transform, 1);
+}
+
+void Renderer::SubmitInstanced(Mesh* mesh, const glm::mat4* transforms, size_t count)
+{
+	// Meshes still streaming in are skipped until their geometry is on the GPU.
+	if (mesh == nullptr || count == 0 || !mesh->IsResident())
+		return;
+
+	auto& packet = m_packets[m_buildPacketIndex];
+	const auto meshIndex = AddOrGetMesh(mesh);
+	const auto pipelineIndex = mesh->GetVertexFormat() == VertexFormat::Packed ? 1u : 0u;
+
 	const auto& submeshes = mesh->GetSubmeshes();
 	auto& materials = mesh->GetMaterials();
+	packet.renderInstances.reserve(packet.renderInstances.size() + submeshes.size() * count);
 	for (auto i = 0; i < submeshes.size(); ++i)
 	{
 		const auto& submesh = submeshes[i];
-		auto& material = materials[submesh.materialIndex];
+		const auto materialIndex = AddOrGetBindlessMaterial(&materials[submesh.materialIndex]);
+		const auto dequantizeTransform =
+			mesh->GetVertexFormat() == VertexFormat::Packed ? GetPositionDequantizeTransform(submesh) : glm::mat4(1.0f);
 
-		auto& renderInstance = m_renderInstances.emplace_back();
-		renderInstance.meshIndex = AddOrGetMesh(mesh);
-		renderInstance.submeshIndex = i;
-		renderInstance.materialIndex = AddOrGetBindlessMaterial(&material);
-		renderInstance.transform = transform * submesh.transform;
+		for (size_t instance = 0; instance < count; ++instance)
+		{
+			auto& renderInstance = packet.renderInstances.emplace_back();
+			renderInstance.meshIndex = meshIndex;
+			renderInstance.submeshIndex = i;
+			renderInstance.materialIndex = materialIndex;
+			renderInstance.transform = transforms[instance] * submesh.transform;
+			renderInstance.lodIndex = SelectLod(submesh, renderInstance.transform);
+
+			const auto& instanceTransform = renderInstance.transform;
+			const auto scale = std::max({ glm::length(glm::vec3(instanceTransform[0])),
+				glm::length(glm::vec3(instanceTransform[1])),
+				glm::length(glm::vec3(instanceTransform[2])) });
+			const auto worldCenter = glm::vec3(instanceTransform * glm::vec4(submesh.sphereCenter, 1.0f));
+			packet.instanceSpheres.Add(worldCenter, submesh.sphereRadius * scale);
+
+			const auto viewDepth = (packet.sceneData.viewMatrix * glm::vec4(worldCenter, 1.0f)).z;
+			renderInstance.sortKey = MakeSortKey(pipelineIndex, meshIndex, materialIndex, i, renderInstance.lodIndex, viewDepth);
+
+			renderInstance.transform *= dequantizeTransform;
+		}
 	}
 }
 
 void Renderer::Flush()
 {
-	const auto windowWidth = m_window->GetSurfaceWidth();
-	const auto windowHeight = m_window->GetSurfaceHeight();
+	PROFILE_SCOPE("Renderer::Flush");
+	const auto flushStartTime = std::chrono::high_resolution_clock::now();
+
+	auto& packet = m_packets[m_buildPacketIndex];
+	packet.width = m_window->GetSurfaceWidth();
+	packet.height = m_window->GetSurfaceHeight();
+	packet.drawMode = m_drawMode;
+	packet.instancing = m_instancing;
+	packet.recordThreadCount = m_recordThreadCount;
+	packet.meshes.assign(m_meshes.begin(), m_meshes.end());
+	packet.buildTimeMs = m_lastFlushTime != std::chrono::high_resolution_clock::time_point{}
+		? std::chrono::duration<float, std::milli>(flushStartTime - m_lastFlushTime).count()
+		: 0.0f;
+
+	if (!m_renderThread.joinable())
+	{
+		packet.textureUploadBytes = m_assets.FinishMeshLoads(UPLOAD_BUDGET);
+		m_assets.EvictUnreferenced();
+		RenderFrame(packet);
+		m_stats = packet.stats;
+		m_lastFlushTime = std::chrono::high_resolution_clock::now();
+		return;
+	}
 
-	m_ctx.BeginFrame();
+	// The other packet is the previous frame. Once it is drawn, it is free to be built into.
+	WaitForRenderThread();
+	packet.handoffWaitMs = GetElapsedMs(flushStartTime);
+	// The render thread is idle until the hand-off below, so loads can create their GPU resources and released assets can go. Evicted
+	// bindless slots and geometry ranges are only reused once no in-flight frame can reference them.
+	packet.textureUploadBytes = m_assets.FinishMeshLoads(UPLOAD_BUDGET);
+	m_assets.EvictUnreferenced();
+
+	auto& nextPacket = m_packets[(m_buildPacketIndex + 1) % RENDER_PACKET_COUNT];
+	if (m_flushedFrames.load(std::memory_order_relaxed) != 0)
+		m_stats = nextPacket.stats;
+	nextPacket.sceneData = packet.sceneData; // The camera carries over until the next SetCamera()
+
+	m_flushedFrames.fetch_add(1, std::memory_order_release);
+	m_buildPacketIndex = (m_buildPacketIndex + 1) % RENDER_PACKET_COUNT;
+	m_lastFlushTime = std::chrono::high_resolution_clock::now();
+}
 
-	auto bindlessSet = m_ctx.RequestDescriptorSet(m_bindlesSetLayout.Get());
-	m_ctx.SetName(*bindlessSet, "descriptor_set_bindless");
-	bindlessSet->WriteArray(0, 0, m_bindlessTextures, m_ctx.GetLinearSampler());
+void Renderer::WaitForRenderThread()
+{
+	if (!m_renderThread.joinable())
+		return;
 
-	auto mainCmd = m_ctx.RequestCmd();
+	PROFILE_SCOPE("WaitForRenderThread");
+	const auto flushedFrames = m_flushedFrames.load(std::memory_order_relaxed);
+	WaitUntil([&] { return m_renderedFrames.load(std::memory_order_acquire) == flushedFrames; });
+}
 
-	auto rpInfo = m_ctx.GetSurfaceRenderPass(m_window);
-	rpInfo.Targets.push_back(VkMana::RenderPassTarget::DefaultDepthStencilTarget(m_depthTarget->GetImageView(VkMana::ImageViewType::RenderTarget)));
-	mainCmd->BeginRenderPass(rpInfo);
-	// mainCmd->BindPipeline(m_trianglePipeline.Get());
-	// mainCmd->SetViewport(0, 0, float(windowWidth), float(windowHeight));
-	// mainCmd->SetScissor(0, 0, windowWidth, windowHeight);
-	// mainCmd->Draw(3, 0);
+void Renderer::RenderThreadLoop()
+{
+	PROFILE_THREAD_NAME("Render");
+
+	uint64_t frame = 0;
+	while (true)
+	{
+		WaitUntil([&] { return m_flushedFrames.load(std::memory_order_acquire) > frame || m_stopRenderThread.load(std::memory_order_acquire); });
+		if (m_flushedFrames.load(std::memory_order_acquire) == frame)
+			return; // Stopping, and every flushed frame has been drawn.
+
+		RenderFrame(m_packets[frame % RENDER_PACKET_COUNT]);
+		m_renderedFrames.store(++frame, std::memory_order_release);
+	}
+}
+
+void Renderer::RenderFrame(RenderPacket& packet)
+{
+	PROFILE_FUNCTION();
+	const auto startTime = std::chrono::high_resolution_clock::now();
+
+	const auto windowWidth = packet.width;
+	const auto windowHeight = packet.height;
+	// Swapped rather than copied, the packet's table is overwritten at the next hand-off.
+	m_drawMeshes.swap(packet.meshes);
+
+	m_pipelineCompiler.Poll();
+
+	CullRenderInstances(packet);
+	SortRenderInstances(packet);
+	BuildDrawBatches(packet);
 
 	{
-		/* Scene Set */
-		auto sceneUbo = m_ctx.CreateBuffer(VkMana::BufferCreateInfo::Uniform(sizeof(SceneData)));
-		m_ctx.SetName(*sceneUbo, "ubo_scene");
-		sceneUbo->WriteHostAccessible(0, sizeof(SceneData), &m_sceneData);
+		PROFILE_SCOPE("BeginFrame");
+		m_ctx.BeginFrame();
+	}
 
-		auto sceneSet = m_ctx.RequestDescriptorSet(m_sceneSetLayout.Get());
-		m_ctx.SetName(*sceneSet, "descriptor_set_scene");
-		sceneSet->Write(sceneUbo.Get(), 0, vk::DescriptorType::eUniformBuffer, 0, sceneUbo->GetSize());
+	{
+		PROFILE_SCOPE("GeometryUploads");
+		// Textures created by this frame's Flush() used their share of the budget already.
+		m_geometry.ProcessUploads(UPLOAD_BUDGET - std::min(packet.textureUploadBytes, UPLOAD_BUDGET));
+		m_frameStats.textureUploadBytes = packet.textureUploadBytes;
+		const auto uploadStats = m_geometry.GetUploadStats();
+		m_frameStats.geometryUploadBytes = uploadStats.frameUploadBytes;
+		m_frameStats.pendingGeometryUploadBytes = uploadStats.pendingUploadBytes;
+	}
 
-		/* Materials Set */
-		auto materialUbo = m_ctx.CreateBuffer(VkMana::BufferCreateInfo::Uniform(sizeof(MaterialData) * m_bindlessMaterials.size()));
-		m_ctx.SetName(*materialUbo, "ubo_materials");
-		materialUbo->WriteHostAccessible(0, sizeof(MaterialData) * m_bindlessMaterials.size(), m_bindlessMaterials.data());
+	{
+		std::lock_guard lock(m_bindlessMutex);
+		m_bindless.BeginFrame();
+		m_frameStats.bindlessTextureWrites = m_bindless.GetStats().textureWrites;
+		m_frameStats.materialUploadBytes = m_bindless.GetStats().materialUploadBytes;
+	}
+
+	/* Frame Data */
+	// Everything transient lives in the frame ring buffer. The descriptors always point at the same buffer, the frame's data is
+	// selected with dynamic offsets (uniforms) and the draws' first instance (instance data). Indirect commands are one per batch at most.
+	const auto indirectSize = packet.drawMode == DrawMode::Indirect ? sizeof(vk::DrawIndexedIndirectCommand) * (m_drawBatches.size() + 1) : 0;
+	const auto reserveSize =
+		(sizeof(SceneData) + FRAME_RING_UNIFORM_ALIGNMENT) + sizeof(InstanceData) * (m_instanceData.size() + 1) + indirectSize;
+	m_frameRing.BeginFrame(reserveSize);
+
+	const auto sceneOffset = m_frameRing.Upload(&packet.sceneData, sizeof(SceneData), FRAME_RING_UNIFORM_ALIGNMENT);
+	const auto instanceOffset = m_frameRing.Upload(m_instanceData.data(), sizeof(InstanceData) * m_instanceData.size(), sizeof(InstanceData));
+	m_instanceBase = instanceOffset ? uint32_t(*instanceOffset / sizeof(InstanceData)) : 0;
+	m_frameStats.frameDataBytes = m_frameRing.GetStats().frameUsage;
+
+	// The sets are persistent, like the bindless ones. A frame's copy is only rewritten once its frame comes round again (so never while
+	// the GPU may be reading it), and only if the ring buffer was reallocated since.
+	auto* ringBuffer = m_frameRing.GetBuffer().Get();
+	auto& frameSets = m_frameSets[m_frameSetIndex];
+	m_frameSetIndex = (m_frameSetIndex + 1) % FRAME_RING_FRAME_COUNT;
+	if (!frameSets.sceneSet)
+	{
+		frameSets.sceneSet = m_ctx.RequestDescriptorSet(m_sceneSetLayout.Get());
+		m_ctx.SetName(*frameSets.sceneSet, "descriptor_set_scene");
+		frameSets.instanceSet = m_ctx.RequestDescriptorSet(m_instanceSetLayout.Get());
+		m_ctx.SetName(*frameSets.instanceSet, "descriptor_set_instances");
+	}
+	if (frameSets.ringGrowCount != m_frameRing.GetStats().growCount)
+	{
+		frameSets.sceneSet->Write(ringBuffer, 0, vk::DescriptorType::eUniformBufferDynamic, 0, sizeof(SceneData));
+		frameSets.instanceSet->Write(ringBuffer, 0, vk::DescriptorType::eStorageBuffer, 0, ringBuffer->GetSize());
+		frameSets.ringGrowCount = m_frameRing.GetStats().growCount;
+	}
 
-		auto materialSet = m_ctx.RequestDescriptorSet(m_materialSetLayout.Get());
-		m_ctx.SetName(*materialSet, "descriptor_set_materials");
-		materialSet->Write(materialUbo.Get(), 0, vk::DescriptorType::eUniformBuffer, 0, materialUbo->GetSize());
+	const FrameBindings frameBindings{
+		.sets = { m_bindless.GetTextureSet().Get(), frameSets.sceneSet.Get(), m_bindless.GetMaterialSet().Get(), frameSets.instanceSet.Get() },
+		.sceneOffset = uint32_t(sceneOffset.value_or(0)),
+		.width = windowWidth,
+		.height = windowHeight,
+	};
 
-		mainCmd->BindPipeline(m_fwdMeshPipeline.Get());
-		mainCmd->SetViewport(0.0f, float(windowHeight), float(windowWidth), -float(windowHeight), 0.0f, 1.0f);
-		mainCmd->SetScissor(0, 0, windowWidth, windowHeight);
+	auto mainCmd = m_ctx.RequestCmd();
+	m_gpuTimer.BeginFrame(mainCmd->GetCmd());
+	m_frameStats.gpuTimeMs = float(m_gpuTimer.GetLastTimeMs());
 
-		mainCmd->BindDescriptorSets(0, { bindlessSet.Get(), sceneSet.Get(), materialSet.Get() }, {});
+	auto rpInfo = m_ctx.GetSurfaceRenderPass(m_window);
+	rpInfo.Targets.push_back(VkMana::RenderPassTarget::DefaultDepthStencilTarget(m_depthTarget->GetImageView(VkMana::ImageViewType::RenderTarget)));
 
-		DrawRenderInstances(*mainCmd);
+	const auto recordStartTime = std::chrono::high_resolution_clock::now();
+	const auto recordThreadCount = packet.drawMode == DrawMode::Direct ? GetRecordThreadCount(packet, m_drawBatches.size()) : 1u;
+	if (recordThreadCount > 1)
+	{
+		mainCmd->BeginRenderPass(rpInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+		DrawRenderInstancesParallel(*mainCmd, rpInfo, frameBindings, recordThreadCount);
 	}
+	else
+	{
+		PROFILE_SCOPE("RecordDraws");
+		mainCmd->BeginRenderPass(rpInfo);
+		// mainCmd->BindPipeline(m_trianglePipeline.Get());
+		// mainCmd->SetViewport(0, 0, float(windowWidth), float(windowHeight));
+		// mainCmd->SetScissor(0, 0, windowWidth, windowHeight);
+		// mainCmd->Draw(3, 0);
+
+		if (!m_drawBatches.empty())
+			BindFrameState(*mainCmd, GetBatchPipeline(m_drawBatches.front()), frameBindings);
+		PROFILE_GPU_SCOPE(m_gpuTimer, mainCmd->GetCmd(), "DrawBatches");
+		if (packet.drawMode == DrawMode::Indirect)
+			DrawRenderInstancesIndirect(*mainCmd);
+		else
+			DrawRenderInstances(*mainCmd, 0, m_drawBatches.size(), m_frameStats);
+	}
+	const auto recordEndTime = std::chrono::high_resolution_clock::now();
+	m_frameStats.recordTimeMs = std::chrono::duration<float, std::milli>(recordEndTime - recordStartTime).count();
+	m_frameStats.recordThreads = recordThreadCount;
 
 	mainCmd->EndRenderPass();
+	m_gpuTimer.EndFrame(mainCmd->GetCmd());
 
 	m_ctx.Submit(mainCmd);
 
 	m_ctx.EndFrame();
-	m_ctx.Present();
+	{
+		PROFILE_SCOPE("Present");
+		m_ctx.Present();
+	}
+
+	m_geometry.NewFrame();
 
-	m_renderInstances.clear();
+	packet.renderInstances.clear();
+	packet.instanceSpheres.Clear();
+	m_frameStats.buildTimeMs = packet.buildTimeMs;
+	m_frameStats.handoffWaitMs = packet.handoffWaitMs;
+	m_frameStats.renderThreadTimeMs = GetElapsedMs(startTime);
+	packet.stats = m_frameStats;
+	m_frameStats = {};
 }
 
 auto Renderer::AddOrGetBindlessTexture(Texture* texture) -> uint32_t
 {
+	// Only registry-owned textures get a bindless slot, so the slot can be released when the registry evicts the texture.
+	assert(m_assets.IsRegistered(texture));
+
 	const auto it = m_bindlessTexturesMap.find(texture);
 	if (it != m_bindlessTexturesMap.end())
 		return it->second;
 
-	const auto index = m_bindlessTextures.size();
-	m_bindlessTextures.push_back(texture->GetImage()->GetImageView(VkMana::ImageViewType::Texture));
-	m_bindlessTexturesMap[texture] = index;
-	return index;
+	std::unique_lock lock(m_bindlessMutex);
+	const auto slot = m_bindless.AddTexture(texture->GetImage()->GetImageView(VkMana::ImageViewType::Texture));
+	lock.unlock();
+	if (!slot)
+		return m_whiteTextureSlot;
+
+	m_bindlessTexturesMap[texture] = *slot;
+	return *slot;
 }
 
 auto Renderer::AddOrGetBindlessMaterial(Material* material) -> uint32_t
@@ -295,14 +626,15 @@ auto Renderer::AddOrGetBindlessMaterial(Material* material) -> uint32_t
 	if (it != m_bindlessMaterialsMap.end())
 		return it->second;
 
-	const auto index = m_bindlessMaterials.size();
-	m_bindlessMaterialsMap[material] = index;
-
-	auto& materialData = m_bindlessMaterials.emplace_back();
-	materialData.albedoTexIndex = AddOrGetBindlessTexture(material->albedo ? material->albedo.get() : m_whiteTexture.get());
-	materialData.normalTexIndex = AddOrGetBindlessTexture(material->normalMap ? material->normalMap.get() : m_blackTexture.get());
+	MaterialData materialData{};
+	materialData.albedoTexIndex = material->albedo ? AddOrGetBindlessTexture(material->albedo.get()) : m_whiteTextureSlot;
+	materialData.normalTexIndex = material->normalMap ? AddOrGetBindlessTexture(material->normalMap.get()) : m_blackTextureSlot;
 
-	return index;
+	std::unique_lock lock(m_bindlessMutex);
+	const auto slot = m_bindless.AddMaterial(materialData);
+	lock.unlock();
+	m_bindlessMaterialsMap[material] = slot;
+	return slot;
 }
 
 auto Renderer::AddOrGetMesh(Mesh* mesh) -> uint32_t
@@ -317,20 +649,271 @@ auto Renderer::AddOrGetMesh(Mesh* mesh) -> uint32_t
 	return index;
 }
 
-void Renderer::DrawRenderInstances(VkMana::CommandBuffer& cmd)
+void Renderer::OnTextureEvicted(const Texture* texture)
+{
+	const auto it = m_bindlessTexturesMap.find(texture);
+	if (it == m_bindlessTexturesMap.end())
+		return;
+
+	{
+		std::lock_guard lock(m_bindlessMutex);
+		m_bindless.FreeTexture(it->second);
+	}
+	m_bindlessTexturesMap.erase(it);
+}
+
+void Renderer::OnMeshEvicted(const Mesh* mesh)
 {
-	for (const auto& instance : m_renderInstances)
+	const auto it = m_meshMap.find(mesh);
+	if (it != m_meshMap.end())
+	{
+		m_meshes[it->second] = nullptr;
+		m_meshMap.erase(it);
+	}
+
+	for (const auto& material : mesh->GetMaterials())
 	{
-		const auto* mesh = m_meshes[instance.meshIndex];
-		// #TODO: Cache bound mesh
-		cmd.BindVertexBuffers(0, { mesh->GetVertexBuffer().Get() }, { 0 });
-		cmd.BindIndexBuffer(mesh->GetIndexBuffer().Get());
+		const auto materialIt = m_bindlessMaterialsMap.find(&material);
+		if (materialIt == m_bindlessMaterialsMap.end())
+			continue;
+
+		{
+			std::lock_guard lock(m_bindlessMutex);
+			m_bindless.FreeMaterial(materialIt->second);
+		}
+		m_bindlessMaterialsMap.erase(materialIt);
+	}
+}
+
+auto Renderer::SelectLod(const Submesh& submesh, const glm::mat4& transform) const -> uint32_t
+{
+	if (submesh.lodCount <= 1)
+		return 0;
 
-		cmd.SetPushConstants(vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof(glm::mat4), glm::value_ptr(instance.transform));
-		cmd.SetPushConstants(
-			vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, sizeof(glm::mat4), sizeof(uint32_t), &instance.materialIndex);
+	// Bounding sphere of the submesh, in view space.
+	const auto& sceneData = m_packets[m_buildPacketIndex].sceneData;
+	const auto viewCenter = glm::vec3(sceneData.viewMatrix * transform * glm::vec4(submesh.sphereCenter, 1.0f));
+	const auto scale = std::max({ glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])) });
+	const auto radius = submesh.sphereRadius * scale;
+
+	const auto distance = glm::length(viewCenter) - radius;
+	if (distance <= 0.0f)
+		return 0; // Camera is inside the bounds.
+
+	// Size of one world unit at the nearest point of the sphere, in pixels.
+	const auto pixelsPerUnit = sceneData.projMatrix[1][1] * 0.5f * float(m_window->GetSurfaceHeight()) / distance;
+	const auto threshold = LOD_ERROR_THRESHOLD_PIXELS * std::exp2(m_lodBias);
+
+	// Coarsest LOD whose simplification error projects below the threshold.
+	for (auto lod = submesh.lodCount - 1; lod > 0; --lod)
+	{
+		if (submesh.lods[lod].error * scale * pixelsPerUnit <= threshold)
+			return lod;
+	}
+	return 0;
+}
+
+void Renderer::CullRenderInstances(const RenderPacket& packet)
+{
+	PROFILE_FUNCTION();
+	const auto startTime = std::chrono::high_resolution_clock::now();
+
+	const auto frustum = Frustum::FromMatrix(packet.sceneData.projMatrix * packet.sceneData.viewMatrix);
+	const auto visibleCount = CullSpheres(frustum, packet.instanceSpheres, m_visibleInstances);
+
+	const auto endTime = std::chrono::high_resolution_clock::now();
+	m_frameStats.cullTimeMs = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+	m_frameStats.visibleInstances = uint32_t(visibleCount);
+	m_frameStats.culledInstances = uint32_t(packet.renderInstances.size() - visibleCount);
+}
+
+void Renderer::SortRenderInstances(const RenderPacket& packet)
+{
+	PROFILE_FUNCTION();
+	const auto startTime = std::chrono::high_resolution_clock::now();
+
+	const auto count = m_visibleInstances.size();
+	m_sortKeys.resize(count);
+	m_sortKeysTemp.resize(count);
+	m_sortValuesTemp.resize(count);
+	JobSystem::Get().ParallelFor(0, count, INSTANCE_JOB_GRAIN, [&](size_t begin, size_t end) {
+		for (auto i = begin; i < end; ++i)
+			m_sortKeys[i] = packet.renderInstances[m_visibleInstances[i]].sortKey;
+	});
+
+	RadixSort(m_sortKeys.data(), m_visibleInstances.data(), m_sortKeysTemp.data(), m_sortValuesTemp.data(), count);
+
+	const auto endTime = std::chrono::high_resolution_clock::now();
+	m_frameStats.sortTimeMs = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+}
+
+void Renderer::BuildDrawBatches(const RenderPacket& packet)
+{
+	PROFILE_FUNCTION();
+	// Sorted instances of the same submesh LOD are adjacent, each run becomes one instanced draw.
+	m_drawBatches.clear();
+	m_instanceData.resize(m_visibleInstances.size());
+	JobSystem::Get().ParallelFor(0, m_visibleInstances.size(), INSTANCE_JOB_GRAIN, [&](size_t begin, size_t end) {
+		for (auto i = begin; i < end; ++i)
+		{
+			const auto& instance = packet.renderInstances[m_visibleInstances[i]];
+			m_instanceData[i].modelMatrix = instance.transform;
+			m_instanceData[i].materialIndex = instance.materialIndex;
+		}
+	});
+
+	for (size_t i = 0; i < m_visibleInstances.size(); ++i)
+	{
+		const auto& instance = packet.renderInstances[m_visibleInstances[i]];
+		if (packet.instancing && !m_drawBatches.empty())
+		{
+			auto& batch = m_drawBatches.back();
+			if (batch.meshIndex == instance.meshIndex && batch.submeshIndex == instance.submeshIndex && batch.lodIndex == instance.lodIndex)
+			{
+				++batch.instanceCount;
+				continue;
+			}
+		}
+
+		auto& batch = m_drawBatches.emplace_back();
+		batch.meshIndex = instance.meshIndex;
+		batch.submeshIndex = instance.submeshIndex;
+		batch.lodIndex = instance.lodIndex;
+		batch.firstInstance = uint32_t(i);
+		batch.instanceCount = 1;
+	}
+	m_frameStats.drawBatches = uint32_t(m_drawBatches.size());
+}
+
+auto Renderer::GetBatchLod(const DrawBatch& batch) const -> SubmeshLod
+{
+	const auto* mesh = m_drawMeshes[batch.meshIndex];
+	const auto& submesh = mesh->GetSubmeshes().at(batch.submeshIndex);
+	auto lod = submesh.lodCount > 0 ? submesh.lods[batch.lodIndex] : SubmeshLod{ submesh.indexOffset, submesh.indexCount };
+	lod.indexOffset += mesh->GetFirstIndex();
+	return lod;
+}
+
+auto Renderer::GetBatchPipeline(const DrawBatch& batch) const -> VkMana::Pipeline*
+{
+	const auto* mesh = m_drawMeshes[batch.meshIndex];
+	return mesh->GetVertexFormat() == VertexFormat::Packed ? m_fwdMeshPackedPipeline.Get() : m_fwdMeshPipeline.Get();
+}
+
+auto Renderer::GetRecordThreadCount(const RenderPacket& packet, size_t batchCount) const -> uint32_t
+{
+	const auto maxThreadCount = packet.recordThreadCount != 0 ? packet.recordThreadCount : JobSystem::Get().GetWorkerCount() + 1;
+	const auto usefulThreadCount = std::max<size_t>(batchCount / RECORD_MIN_BATCHES_PER_THREAD, 1);
+	return uint32_t(std::min<size_t>(maxThreadCount, usefulThreadCount));
+}
+
+void Renderer::BindFrameState(VkMana::CommandBuffer& cmd, VkMana::Pipeline* pipeline, const FrameBindings& bindings)
+{
+	// The descriptor sets are bound against the bound pipeline's layout, which every forward pipeline shares.
+	cmd.BindPipeline(pipeline);
+	cmd.SetViewport(0.0f, float(bindings.height), float(bindings.width), -float(bindings.height), 0.0f, 1.0f);
+	cmd.SetScissor(0, 0, bindings.width, bindings.height);
+	cmd.BindDescriptorSets(0, { bindings.sets[0], bindings.sets[1], bindings.sets[2], bindings.sets[3] }, { bindings.sceneOffset });
+}
+
+void Renderer::DrawRenderInstancesParallel(
+	VkMana::CommandBuffer& cmd, const VkMana::RenderPassInfo& rpInfo, const FrameBindings& bindings, uint32_t threadCount)
+{
+	PROFILE_SCOPE("RecordDraws");
+
+	// Contiguous chunks of batches, one secondary command buffer each. Executing them in chunk order keeps the sorted draw order.
+	// Command buffers are requested here, on the recording thread's pool, only the recording itself runs on the workers.
+	std::vector<VkMana::CommandBufferHandle> secondaryCmds(threadCount);
+	for (auto i = 0u; i < threadCount; ++i)
+		secondaryCmds[i] = m_ctx.RequestSecondaryCmd(i, rpInfo);
+
+	// One job per chunk. The calling thread records the first chunk and helps with the others.
+	std::vector<RenderStats> threadStats(threadCount);
+	JobSystem::Get().ParallelFor(0, threadCount, 1, [&](size_t firstChunk, size_t lastChunk) {
+		for (auto chunk = firstChunk; chunk < lastChunk; ++chunk)
+		{
+			const auto begin = m_drawBatches.size() * chunk / threadCount;
+			const auto end = m_drawBatches.size() * (chunk + 1) / threadCount;
+			PROFILE_SCOPE("RecordDrawChunk");
+			// Every secondary starts with no state, it needs its own pipeline before the sets.
+			BindFrameState(*secondaryCmds[chunk], GetBatchPipeline(m_drawBatches[begin]), bindings);
+			PROFILE_GPU_SCOPE(m_gpuTimer, secondaryCmds[chunk]->GetCmd(), "DrawBatches");
+			DrawRenderInstances(*secondaryCmds[chunk], begin, end, threadStats[chunk]);
+		}
+	});
+
+	cmd.ExecuteCommands(secondaryCmds);
+	for (const auto& stats : threadStats)
+		AccumulateDrawStats(m_frameStats, stats);
+}
+
+void Renderer::DrawRenderInstancesIndirect(VkMana::CommandBuffer& cmd)
+{
+	// All meshes live in the shared geometry buffers, so the commands only split where the pipeline (vertex format) changes.
+	// The sort puts those runs next to each other.
+	struct PipelineBatch
+	{
+		VkMana::Pipeline* pipeline;
+		uint32_t firstCommand;
+		uint32_t commandCount;
+	};
+	std::vector<PipelineBatch> pipelineBatches;
+
+	m_indirectCommands.clear();
+	for (const auto& batch : m_drawBatches)
+	{
+		const auto* mesh = m_drawMeshes[batch.meshIndex];
+
+		auto* pipeline = GetBatchPipeline(batch);
+		if (pipelineBatches.empty() || pipelineBatches.back().pipeline != pipeline)
+			pipelineBatches.push_back({ pipeline, uint32_t(m_indirectCommands.size()), 0 });
+		++pipelineBatches.back().commandCount;
+
+		const auto& submesh = mesh->GetSubmeshes().at(batch.submeshIndex);
+		const auto lod = GetBatchLod(batch);
+		// The shader finds the batch's instances through firstInstance, SetDrawMode() only allows this path with
+		// drawIndirectFirstInstance. Without it every command would read the frame's first instances.
+		m_indirectCommands.emplace_back(
+			lod.indexCount, batch.instanceCount, lod.indexOffset, int32_t(mesh->GetFirstVertex() + submesh.vertexOffset), m_instanceBase + batch.firstInstance);
+
+		m_frameStats.lodDrawCounts[batch.lodIndex] += batch.instanceCount;
+		m_frameStats.lodTriangleCounts[batch.lodIndex] += uint64_t(lod.indexCount / 3) * batch.instanceCount;
+	}
+	if (m_indirectCommands.empty())
+		return;
+
+	const auto commandsOffset = m_frameRing.Upload(
+		m_indirectCommands.data(), sizeof(vk::DrawIndexedIndirectCommand) * m_indirectCommands.size(), sizeof(vk::DrawIndexedIndirectCommand));
+	if (!commandsOffset)
+	{
+		LOG_WARN("Frame ring buffer full, skipping {} indirect draws", m_indirectCommands.size());
+		return;
+	}
+	m_frameStats.frameDataBytes = m_frameRing.GetStats().frameUsage;
+
+	const auto* firstMesh = m_drawMeshes[m_drawBatches.front().meshIndex];
+	cmd.BindVertexBuffers(0, { firstMesh->GetVertexBuffer().Get() }, { 0 });
+	cmd.BindIndexBuffer(firstMesh->GetIndexBuffer().Get());
+	m_frameStats.vertexBufferBinds += 1;
+	m_frameStats.indexBufferBinds += 1;
+
+	// The first batch's pipeline was bound with the frame state.
+	auto* boundPipeline = pipelineBatches.front().pipeline;
+	m_frameStats.pipelineBinds += 1;
+	for (const auto& batch : pipelineBatches)
+	{
+		if (batch.pipeline != boundPipeline)
+		{
+			cmd.BindPipeline(batch.pipeline);
+			boundPipeline = batch.pipeline;
+			++m_frameStats.pipelineBinds;
+		}
+		cmd.DrawIndexedIndirect(m_frameRing.GetBuffer().Get(),
+			*commandsOffset + sizeof(vk::DrawIndexedIndirectCommand) * batch.firstCommand,
+			batch.commandCount,
+			sizeof(vk::DrawIndexedIndirectCommand));
 
-		const auto& submesh = mesh->GetSubmeshes().at(instance.submeshIndex);
-		cmd.DrawIndexed(submesh.indexCount, submesh.indexOffset, submesh.vertexOffset);
+		++m_frameStats.drawCalls;
 	}
+	m_frameStats.indirectCommands = uint32_t(m_indirectCommands.size());
 }
@@ -1,91 +1,369 @@
 #pragma once
 
+#include "AssetRegistry.hpp"
+#include "BindlessTables.hpp"
+#include "FrameRingBuffer.hpp"
+#include "FrustumCulling.hpp"
+#include "GeometryBuffer.hpp"
+#include "GpuFrameTimer.hpp"
 #include "Mesh.hpp"
+#include "PipelineCache.hpp"
+#include "PipelineCompiler.hpp"
+#include "ShaderCache.hpp"
 
 #include <VkMana/Context.hpp>
 #include <VkMana/WSI.hpp>
 
 #include <glm/ext/matrix_float4x4.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
+/**
+ * Counters of the last flushed frame.
+ */
+struct RenderStats
+{
+	uint32_t visibleInstances = 0;
+	uint32_t culledInstances = 0;
+	float cullTimeMs = 0.0f;
+	float sortTimeMs = 0.0f;
+	float recordTimeMs = 0.0f; // CPU time spent recording draws
+	uint32_t recordThreads = 0;
+	float gpuTimeMs = -1.0f; // GPU time of the main pass, of a frame FRAME_RING_FRAME_COUNT frames back. Negative if unavailable.
+	uint32_t drawCalls = 0;
+	uint32_t drawBatches = 0; // Instanced draws, one per run of visible instances sharing a submesh LOD.
+	uint32_t indirectCommands = 0;
+	uint32_t pipelineBinds = 0;
+	uint32_t vertexBufferBinds = 0;
+	uint32_t indexBufferBinds = 0;
+	uint64_t frameDataBytes = 0; // Transient data written to the frame ring buffer
+	uint32_t bindlessTextureWrites = 0;
+	uint64_t materialUploadBytes = 0;
+	uint64_t textureUploadBytes = 0;		 // Texture data of the meshes finished this frame. Counts against the upload budget.
+	uint64_t geometryUploadBytes = 0;		 // Streamed to the geometry buffer this frame, at most what textures left of the budget.
+	uint64_t pendingGeometryUploadBytes = 0; // Still waiting for a later frame's budget.
+	uint32_t lodDrawCounts[MAX_SUBMESH_LODS] = {};
+	uint64_t lodTriangleCounts[MAX_SUBMESH_LODS] = {};
+	float buildTimeMs = 0.0f;		 // Main thread, building the frame (from the previous Flush() to this one).
+	float renderThreadTimeMs = 0.0f; // Render thread (or Flush() without one), from culling to present.
+	float handoffWaitMs = 0.0f;		 // Main thread, waiting in Flush() for the render thread to finish the previous frame.
+};
+
+enum class DrawMode : uint8_t
+{
+	Direct,	  // One DrawIndexed per instance batch.
+	Indirect, // One DrawIndexedIndirect per pipeline, commands built on the CPU.
+};
+
 class Renderer
 {
 public:
 	Renderer() = default;
-	~Renderer() = default;
+	~Renderer();
 
+	/**
+	 * Disables loading/saving the pipeline cache. Must be called before Init(). Used to measure cold pipeline creation.
+	 */
+	void SetPipelineCacheEnabled(bool enabled) { m_usePipelineCache = enabled; }
+	/**
+	 * Record and submit frames on a dedicated render thread (default). Must be called before Init().
+	 */
+	void SetRenderThreadEnabled(bool enabled) { m_useRenderThread = enabled; }
 	bool Init(VkMana::WSI& window);
 
 	void SetCamera(const glm::mat4& projMatrix, const glm::mat4& viewMatrix);
+	/**
+	 * The caller must keep a reference to `mesh` until the Flush() that ends the frame has returned. Flush() evicts every asset that
+	 * only the registry still references.
+	 */
 	void Submit(Mesh* mesh, const glm::mat4& transform = glm::mat4(1.0f));
+	/**
+	 * Submits `count` instances of `mesh`. Same as calling Submit() per transform, but the mesh and its materials are resolved once.
+	 * Instances of the same submesh (from either call) are merged into instanced draws.
+	 */
+	void SubmitInstanced(Mesh* mesh, const glm::mat4* transforms, size_t count);
+	void SubmitInstanced(Mesh* mesh, const std::vector<glm::mat4>& transforms) { SubmitInstanced(mesh, transforms.data(), transforms.size()); }
+
+	/**
+	 * Shifts LOD selection. Each +1 doubles the screen-space error allowed before switching to a coarser LOD, -1 halves it.
+	 */
+	void SetLodBias(float bias) { m_lodBias = bias; }
+	/**
+	 * DrawMode::Indirect needs the multiDrawIndirect and drawIndirectFirstInstance device features. Without them (known once Init()
+	 * has run) the renderer falls back to direct draws.
+	 */
+	void SetDrawMode(DrawMode mode);
+	/**
+	 * Merge instances of the same submesh into one instanced draw (default). Disabling it draws every visible instance on its own.
+	 */
+	void SetInstancing(bool enabled) { m_instancing = enabled; }
+	/**
+	 * Maximum number of threads recording draws (direct mode). 0 uses every job system worker plus the calling thread.
+	 * Fewer threads are used when there are not enough draws to make it worthwhile.
+	 */
+	void SetRecordThreadCount(uint32_t threadCount) { m_recordThreadCount = threadCount; }
 
+	/**
+	 * Ends the frame built by SetCamera()/Submit(). With a render thread, the frame is handed over and recorded while the caller builds
+	 * the next one. Only one frame is ever pending, so this waits for the previous frame's recording to finish first, and the stats
+	 * are those of the previous frame.
+	 */
 	void Flush();
+	/**
+	 * Blocks until every flushed frame has been submitted. Until the next Flush(), the caller may then use the context, the asset
+	 * registry and the geometry buffer (eg. load or evict assets) as if there was no render thread.
+	 */
+	void WaitForRenderThread();
 
 	//////////////////////////////////////////////////
 	/// Getters
 	//////////////////////////////////////////////////
 
 	auto GetContext() -> auto& { return m_ctx; }
+	auto GetAssets() -> auto& { return m_assets; }
+	auto GetGeometry() -> auto& { return m_geometry; }
+	auto GetFrameRing() const -> const auto& { return m_frameRing; }
+	auto GetLodBias() const -> float { return m_lodBias; }
+	auto GetDrawMode() const -> DrawMode { return m_drawMode; }
+	auto GetInstancing() const -> bool { return m_instancing; }
+	auto GetRecordThreadCount() const -> uint32_t { return m_recordThreadCount; }
+	auto IsRenderThreadEnabled() const -> bool { return m_renderThread.joinable(); }
+	auto GetStats() const -> const auto& { return m_stats; }
 
 private:
 	auto AddOrGetBindlessTexture(Texture* texture) -> uint32_t;
 	auto AddOrGetBindlessMaterial(Material* material) -> uint32_t;
 	auto AddOrGetMesh(Mesh* mesh) -> uint32_t;
 
-	void DrawRenderInstances(VkMana::CommandBuffer& cmd);
+	void OnTextureEvicted(const Texture* texture);
+	void OnMeshEvicted(const Mesh* mesh);
+
+	auto SelectLod(const Submesh& submesh, const glm::mat4& transform) const -> uint32_t;
+
+	struct RenderPacket;
+	void RenderThreadLoop();
+	/* Culls, sorts, records and submits `packet`. Runs on the render thread, or in Flush() without one. */
+	void RenderFrame(RenderPacket& packet);
+
+	void CullRenderInstances(const RenderPacket& packet);
+	void SortRenderInstances(const RenderPacket& packet);
+	void BuildDrawBatches(const RenderPacket& packet);
+
+	struct DrawBatch;
+	struct FrameBindings
+	{
+		VkMana::DescriptorSet* sets[4];
+		uint32_t sceneOffset;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	auto GetBatchLod(const DrawBatch& batch) const -> SubmeshLod;
+	auto GetBatchPipeline(const DrawBatch& batch) const -> VkMana::Pipeline*;
+	auto GetRecordThreadCount(const RenderPacket& packet, size_t batchCount) const -> uint32_t;
+	/* Binds `pipeline` (the first batch's) and the frame's dynamic state and descriptor sets. */
+	static void BindFrameState(VkMana::CommandBuffer& cmd, VkMana::Pipeline* pipeline, const FrameBindings& bindings);
+	/**
+	 * Records `m_drawBatches[batchBegin, batchEnd)`. Only reads renderer state, so chunks can be recorded concurrently.
+	 * The first batch's pipeline must already be bound (see BindFrameState()).
+	 * Templated on the command buffer, so the benchmarks can record into a mock without a device.
+	 */
+	template <typename CommandBuffer>
+	void DrawRenderInstances(CommandBuffer& cmd, size_t batchBegin, size_t batchEnd, RenderStats& stats) const;
+	void DrawRenderInstancesParallel(VkMana::CommandBuffer& cmd, const VkMana::RenderPassInfo& rpInfo, const FrameBindings& bindings, uint32_t threadCount);
+	void DrawRenderInstancesIndirect(VkMana::CommandBuffer& cmd);
+
+	friend class RendererBenchmark; // Drives the CPU-side submission path directly, see bench/RendererBenchmark.cpp
 
 private:
 	VkMana::WSI* m_window = nullptr;
 	VkMana::Context m_ctx{};
+	GeometryBuffer m_geometry{ m_ctx };
+	AssetRegistry m_assets{ m_ctx, m_geometry };
+	FrameRingBuffer m_frameRing{ m_ctx,
+		vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer };
+	BindlessTables m_bindless{ m_ctx };
+	ShaderCache m_shaderCache;
+	PipelineCache m_pipelineCache;
+	bool m_usePipelineCache = true;
+	PipelineCompiler m_pipelineCompiler{ m_ctx, m_shaderCache, m_pipelineCache };
+	GpuFrameTimer m_gpuTimer;
 
-	std::unique_ptr<Texture> m_whiteTexture = nullptr;
-	std::unique_ptr<Texture> m_blackTexture = nullptr;
+	std::shared_ptr<Texture> m_whiteTexture = nullptr;
+	std::shared_ptr<Texture> m_blackTexture = nullptr;
+	uint32_t m_whiteTextureSlot = 0; // Bindless slots of the default textures, used by materials without a texture.
+	uint32_t m_blackTextureSlot = 0;
 
 	VkMana::ImageHandle m_depthTarget = nullptr;
 
 	VkMana::SetLayoutHandle m_bindlesSetLayout = nullptr;
 	VkMana::SetLayoutHandle m_sceneSetLayout = nullptr;
 	VkMana::SetLayoutHandle m_materialSetLayout = nullptr;
+	VkMana::SetLayoutHandle m_instanceSetLayout = nullptr;
 
 	VkMana::PipelineHandle m_trianglePipeline = nullptr;
-	VkMana::PipelineHandle m_fwdMeshPipeline = nullptr; // Forward-Mesh
+	VkMana::PipelineHandle m_fwdMeshPipeline = nullptr;		  // Forward-Mesh
+	VkMana::PipelineHandle m_fwdMeshPackedPipeline = nullptr; // Forward-Mesh, PackedVertex input
+
+	float m_lodBias = 0.0f;
+	DrawMode m_requestedDrawMode = DrawMode::Direct;
+	DrawMode m_drawMode = DrawMode::Direct;
+	bool m_indirectDrawSupported = false;
+	bool m_instancing = true;
+	uint32_t m_recordThreadCount = 0;
+	RenderStats m_stats{};
+
+	bool m_useRenderThread = true;
+	std::thread m_renderThread;
+	// The hand-off. A packet is owned by the main thread until it is counted in `m_flushedFrames`, then by the render thread until it
+	// is counted in `m_renderedFrames`.
+	alignas(64) std::atomic<uint64_t> m_flushedFrames = 0; // Written by the main thread
+	alignas(64) std::atomic<uint64_t> m_renderedFrames = 0; // Written by the render thread
+	std::atomic<bool> m_stopRenderThread = false;
+	std::chrono::high_resolution_clock::time_point m_lastFlushTime{};
+	std::mutex m_bindlessMutex; // Slots are added by Submit(), and the tables flushed by the render thread.
 
 	//////////////////////////////////////////////////
 	/// Frame Data
 	//////////////////////////////////////////////////
 
-	std::vector<const VkMana::ImageView*> m_bindlessTextures;
-	std::unordered_map<Texture*, uint32_t> m_bindlessTexturesMap;
+	std::unordered_map<const Texture*, uint32_t> m_bindlessTexturesMap;
+
+	/* Scene and instance sets, one copy per frame in flight. Both point at the frame ring buffer. */
+	struct FrameSets
+	{
+		VkMana::DescriptorSetHandle sceneSet = nullptr;
+		VkMana::DescriptorSetHandle instanceSet = nullptr;
+		uint32_t ringGrowCount = ~0u; // Ring buffer the sets were written for, see FrameRingStats::growCount
+	};
+	FrameSets m_frameSets[FRAME_RING_FRAME_COUNT];
+	uint32_t m_frameSetIndex = 0;
 
 	struct SceneData
 	{
 		glm::mat4 projMatrix;
 		glm::mat4 viewMatrix;
-	} m_sceneData{};
-
-#pragma pack(push, 4)
-	struct MaterialData
-	{
-		glm::vec4 albedoColor = { 1, 1, 1, 1 };
-		uint32_t albedoTexIndex = 0;
-		uint32_t normalTexIndex = 0;
-		float padding[2];
 	};
-#pragma pack(pop)
-	std::vector<MaterialData> m_bindlessMaterials;
-	std::unordered_map<Material*, uint32_t> m_bindlessMaterialsMap;
 
-	std::vector<Mesh*> m_meshes;
-	std::unordered_map<Mesh*, uint32_t> m_meshMap;
+	std::unordered_map<const Material*, uint32_t> m_bindlessMaterialsMap;
+
+	std::vector<Mesh*> m_meshes; // Main thread, see RenderPacket::meshes
+	std::unordered_map<const Mesh*, uint32_t> m_meshMap;
 
 	struct RenderInstance
 	{
 		uint32_t meshIndex;
 		uint32_t submeshIndex;
+		uint32_t lodIndex;
 		uint32_t materialIndex;
+		uint64_t sortKey;
 		glm::mat4 transform;
 	};
-	std::vector<RenderInstance> m_renderInstances;
+
+	/* Everything built on the main thread for one frame. The main thread fills one packet while the render thread draws the other. */
+	struct RenderPacket
+	{
+		SceneData sceneData{};
+		uint32_t width = 0;
+		uint32_t height = 0;
+		DrawMode drawMode = DrawMode::Direct;
+		bool instancing = true;
+		uint32_t recordThreadCount = 0;
+		std::vector<RenderInstance> renderInstances;
+		CullingSpheres instanceSpheres; // World-space bounds, parallel to `renderInstances`.
+		std::vector<Mesh*> meshes;		// The mesh table at the hand-off, `m_meshes` can grow while the packet is drawn.
+		uint64_t textureUploadBytes = 0; // Created by Flush() before the hand-off
+		float buildTimeMs = 0.0f;
+		float handoffWaitMs = 0.0f;
+		RenderStats stats{}; // Written once the frame is submitted
+	};
+	static constexpr uint32_t RENDER_PACKET_COUNT = 2;
+	RenderPacket m_packets[RENDER_PACKET_COUNT];
+	uint32_t m_buildPacketIndex = 0; // Packet filled by SetCamera()/Submit()
+
+	//////////////////////////////////////////////////
+	/// Render Thread Data
+	//////////////////////////////////////////////////
+
+	std::vector<Mesh*> m_drawMeshes; // Mesh table of the packet being drawn
+	std::vector<uint32_t> m_visibleInstances; // Indices into the packet's instances, in draw order after sorting.
+	std::vector<uint64_t> m_sortKeys;
+	std::vector<uint64_t> m_sortKeysTemp;
+	std::vector<uint32_t> m_sortValuesTemp;
+	RenderStats m_frameStats{};
+
+	// Consecutive visible instances (in sorted order) drawing the same submesh LOD.
+	struct DrawBatch
+	{
+		uint32_t meshIndex;
+		uint32_t submeshIndex;
+		uint32_t lodIndex;
+		uint32_t firstInstance; // Into `m_instanceData`
+		uint32_t instanceCount;
+	};
+	std::vector<DrawBatch> m_drawBatches;
+
+#pragma pack(push, 4)
+	struct InstanceData
+	{
+		glm::mat4 modelMatrix;
+		uint32_t materialIndex;
+		uint32_t padding[3];
+	};
+#pragma pack(pop)
+	std::vector<InstanceData> m_instanceData;
+	uint32_t m_instanceBase = 0; // Index of `m_instanceData[0]` in the frame ring buffer
+	std::vector<vk::DrawIndexedIndirectCommand> m_indirectCommands;
 };
+
+template <typename CommandBuffer>
+void Renderer::DrawRenderInstances(CommandBuffer& cmd, size_t batchBegin, size_t batchEnd, RenderStats& stats) const
+{
+	// Batches are sorted by pipeline/mesh, so state only changes at the boundaries between runs.
+	if (batchBegin == batchEnd)
+		return;
+	VkMana::Pipeline* boundPipeline = GetBatchPipeline(m_drawBatches[batchBegin]);
+	++stats.pipelineBinds;
+	const VkMana::Buffer* boundVertexBuffer = nullptr;
+	const VkMana::Buffer* boundIndexBuffer = nullptr;
+	for (auto batchIndex = batchBegin; batchIndex < batchEnd; ++batchIndex)
+	{
+		const auto& batch = m_drawBatches[batchIndex];
+		const auto* mesh = m_drawMeshes[batch.meshIndex];
+
+		auto* pipeline = GetBatchPipeline(batch);
+		if (pipeline != boundPipeline)
+		{
+			cmd.BindPipeline(pipeline);
+			boundPipeline = pipeline;
+			++stats.pipelineBinds;
+		}
+
+		if (mesh->GetVertexBuffer().Get() != boundVertexBuffer)
+		{
+			cmd.BindVertexBuffers(0, { mesh->GetVertexBuffer().Get() }, { 0 });
+			boundVertexBuffer = mesh->GetVertexBuffer().Get();
+			++stats.vertexBufferBinds;
+		}
+		if (mesh->GetIndexBuffer().Get() != boundIndexBuffer)
+		{
+			cmd.BindIndexBuffer(mesh->GetIndexBuffer().Get());
+			boundIndexBuffer = mesh->GetIndexBuffer().Get();
+			++stats.indexBufferBinds;
+		}
+
+		const auto& submesh = mesh->GetSubmeshes().at(batch.submeshIndex);
+		const auto lod = GetBatchLod(batch);
+		cmd.DrawIndexed(
+			lod.indexCount, lod.indexOffset, mesh->GetFirstVertex() + submesh.vertexOffset, batch.instanceCount, m_instanceBase + batch.firstInstance);
+		++stats.drawCalls;
+
+		stats.lodDrawCounts[batch.lodIndex] += batch.instanceCount;
+		stats.lodTriangleCounts[batch.lodIndex] += uint64_t(lod.indexCount / 3) * batch.instanceCount;
+	}
+}
@@ -0,0 +1,258 @@
+#include "ShaderCache.hpp"
+
+#include "Core/Hash.hpp"
+#include "Core/Logging.hpp"
+#include "Core/MappedFile.hpp"
+#include "Core/Profiler.hpp"
+#include "Core/TempFile.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+#include <system_error>
+#include <unordered_set>
+
+// The VkMana commit the build fetched (see Dependencies.cmake). VkMana wraps the shader compiler, so a new revision may compile differently.
+#ifndef GS_VKMANA_REVISION
+	#define GS_VKMANA_REVISION "unknown"
+#endif
+
+namespace
+{
+	constexpr std::string_view SHADER_COMPILER_REVISION = GS_VKMANA_REVISION;
+	constexpr uint32_t SHADER_CACHE_MAGIC = 0x43565053; // "SPVC"
+	constexpr uint32_t SHADER_CACHE_VERSION = 1;
+	constexpr uint32_t SHADER_INCLUDE_MAX_DEPTH = 32;
+
+	struct ShaderCacheHeader
+	{
+		uint32_t magic = SHADER_CACHE_MAGIC;
+		uint32_t version = SHADER_CACHE_VERSION;
+		uint64_t key = 0;
+		uint64_t spirvHash = 0;
+		uint64_t spirvSize = 0; // Bytes
+	};
+
+	auto ReadTextFile(const std::filesystem::path& filename) -> std::optional<std::string>
+	{
+		std::ifstream stream(filename, std::ios::binary);
+		if (!stream)
+			return std::nullopt;
+
+		std::ostringstream contents;
+		contents << stream.rdbuf();
+		return contents.str();
+	}
+
+	/* Returns the path of every `#include "..."` in `source`. Angle-bracket includes resolve through the compiler's search paths, and are
+	 * not followed. */
+	auto FindIncludes(const std::string& source) -> std::vector<std::string>
+	{
+		std::vector<std::string> includes;
+		std::istringstream stream(source);
+		std::string line;
+		while (std::getline(stream, line))
+		{
+			const auto directiveStart = line.find_first_not_of(" \t");
+			if (directiveStart == std::string::npos || line.compare(directiveStart, 8, "#include") != 0)
+				continue;
+
+			const auto pathStart = line.find('"', directiveStart + 8);
+			const auto pathEnd = pathStart != std::string::npos ? line.find('"', pathStart + 1) : std::string::npos;
+			if (pathEnd != std::string::npos)
+				includes.push_back(line.substr(pathStart + 1, pathEnd - pathStart - 1));
+		}
+		return includes;
+	}
+
+	/* Hashes the contents of every file included by `source`, depth first. Returns false if an include cannot be read (let the compiler
+	 * report it). */
+	bool HashIncludes(const std::string& source,
+		const std::filesystem::path& directory,
+		uint32_t depth,
+		std::unordered_set<std::string>& visited,
+		uint64_t& hash)
+	{
+		if (depth > SHADER_INCLUDE_MAX_DEPTH)
+			return false;
+
+		for (const auto& include : FindIncludes(source))
+		{
+			const auto includeFilename = (directory / include).lexically_normal();
+			if (!visited.insert(includeFilename.generic_string()).second)
+				continue;
+
+			const auto includeSource = ReadTextFile(includeFilename);
+			if (!includeSource)
+				return false;
+
+			hash = HashString(includeFilename.generic_string(), hash);
+			hash = HashString(*includeSource, hash);
+			if (!HashIncludes(*includeSource, includeFilename.parent_path(), depth + 1, visited, hash))
+				return false;
+		}
+		return true;
+	}
+} // namespace
+
+void ShaderCache::Init(const std::filesystem::path& cacheDir)
+{
+	m_cacheDir = cacheDir;
+
+	std::error_code err;
+	std::filesystem::create_directories(m_cacheDir, err);
+	if (err)
+		LOG_WARN("Failed to create shader cache directory {}: {}", m_cacheDir.string(), err.message());
+}
+
+auto ShaderCache::Compile(const VkMana::ShaderCompileInfo& info) -> std::optional<std::vector<uint32_t>>
+{
+	PROFILE_FUNCTION();
+	const auto key = GetKey(info);
+	if (key)
+	{
+		const auto loadStartTime = std::chrono::high_resolution_clock::now();
+		auto spirv = Load(*key);
+		const auto loadEndTime = std::chrono::high_resolution_clock::now();
+		m_loadTimeUs += uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(loadEndTime - loadStartTime).count());
+		if (spirv)
+		{
+			++m_hits;
+			return spirv;
+		}
+	}
+	++m_misses;
+
+	const auto compileStartTime = std::chrono::high_resolution_clock::now();
+	auto spirv = VkMana::CompileShader(info);
+	const auto compileEndTime = std::chrono::high_resolution_clock::now();
+	m_compileTimeUs += uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(compileEndTime - compileStartTime).count());
+
+	if (spirv && key)
+		Store(*key, *spirv);
+	return spirv;
+}
+
+void ShaderCache::LogStats() const
+{
+	const auto stats = GetStats();
+	LOG_INFO("Shader cache: {} hits, {} misses ({:.1f}% hit rate), {:.2f} ms loading, {:.2f} ms compiling",
+		stats.hits,
+		stats.misses,
+		stats.GetHitRate() * 100.0f,
+		stats.loadTimeMs,
+		stats.compileTimeMs);
+}
+
+auto ShaderCache::GetStats() const -> ShaderCacheStats
+{
+	ShaderCacheStats stats{};
+	stats.hits = m_hits;
+	stats.misses = m_misses;
+	stats.loadTimeMs = float(m_loadTimeUs) / 1000.0f;
+	stats.compileTimeMs = float(m_compileTimeUs) / 1000.0f;
+	return stats;
+}
+
+auto ShaderCache::GetKey(const VkMana::ShaderCompileInfo& info) -> std::optional<uint64_t>
+{
+	std::string source;
+	std::filesystem::path directory;
+	if (!info.SrcFilename.empty())
+	{
+		const std::filesystem::path filename(info.SrcFilename);
+		auto fileSource = ReadTextFile(filename);
+		if (!fileSource)
+			return std::nullopt;
+
+		source = std::move(*fileSource);
+		directory = filename.parent_path();
+	}
+	else
+	{
+		source = info.SrcString;
+	}
+
+	auto key = HashCombine(HASH_FNV1A_OFFSET, SHADER_CACHE_VERSION);
+	// DXC comes with the Vulkan SDK, whose headers carry its version.
+	key = HashString(SHADER_COMPILER_REVISION, key);
+	key = HashCombine(key, uint32_t(VK_HEADER_VERSION_COMPLETE));
+	key = HashString(source, key);
+	key = HashString(info.EntryPoint, key);
+	key = HashCombine(key, uint32_t(info.Stage));
+	key = HashCombine(key, uint32_t(info.SrcLanguage));
+	key = HashCombine(key, bool(info.Debug));
+
+	std::unordered_set<std::string> visited;
+	if (!HashIncludes(source, directory, 0, visited, key))
+		return std::nullopt;
+
+	return key;
+}
+
+auto ShaderCache::GetCacheFilename(uint64_t key) const -> std::filesystem::path
+{
+	return m_cacheDir / fmt::format("{:016x}.spv", key);
+}
+
+auto ShaderCache::Load(uint64_t key) const -> std::optional<std::vector<uint32_t>>
+{
+	MappedFile file;
+	if (!file.Open(GetCacheFilename(key)))
+		return std::nullopt;
+
+	const auto fileSize = uint64_t(file.GetSize());
+	if (fileSize < sizeof(ShaderCacheHeader))
+		return std::nullopt;
+
+	const auto& header = *reinterpret_cast<const ShaderCacheHeader*>(file.GetData());
+	if (header.magic != SHADER_CACHE_MAGIC || header.version != SHADER_CACHE_VERSION || header.key != key
+		|| header.spirvSize != fileSize - sizeof(ShaderCacheHeader) || header.spirvSize % sizeof(uint32_t) != 0)
+		return std::nullopt;
+
+	const auto* spirvData = file.GetData() + sizeof(ShaderCacheHeader);
+	if (HashBytes(spirvData, header.spirvSize) != header.spirvHash)
+	{
+		LOG_WARN("Shader cache entry is corrupt: {:016x}", key);
+		return std::nullopt;
+	}
+
+	std::vector<uint32_t> spirv(header.spirvSize / sizeof(uint32_t));
+	std::memcpy(spirv.data(), spirvData, header.spirvSize);
+	return spirv;
+}
+
+void ShaderCache::Store(uint64_t key, const std::vector<uint32_t>& spirv) const
+{
+	if (m_cacheDir.empty())
+		return;
+
+	ShaderCacheHeader header{};
+	header.key = key;
+	header.spirvSize = sizeof(uint32_t) * spirv.size();
+	header.spirvHash = HashBytes(spirv.data(), header.spirvSize);
+
+	// Write to a temporary file and rename it into place, another process may be reading or writing the same entry.
+	const auto filename = GetCacheFilename(key);
+	const auto tempFilename = GetTempFilename(filename);
+	{
+		std::ofstream stream(tempFilename, std::ios::binary | std::ios::trunc);
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(reinterpret_cast<const char*>(spirv.data()), std::streamsize(header.spirvSize));
+		if (!stream)
+		{
+			LOG_WARN("Failed to write shader cache entry: {}", filename.string());
+			stream.close();
+			std::error_code err;
+			std::filesystem::remove(tempFilename, err);
+			return;
+		}
+	}
+
+	std::error_code err;
+	std::filesystem::rename(tempFilename, filename, err);
+	if (err)
+		std::filesystem::remove(tempFilename, err);
+}
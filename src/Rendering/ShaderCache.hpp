@@ -0,0 +1,71 @@
+#pragma once
+
+#include <VkMana/ShaderCompiler.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct ShaderCacheStats
+{
+	uint32_t hits = 0;
+	uint32_t misses = 0;
+	float loadTimeMs = 0.0f;	// Total time spent reading cached SPIR-V
+	float compileTimeMs = 0.0f; // Total time spent in the compiler (misses)
+
+	auto GetHitRate() const -> float { return hits + misses != 0 ? float(hits) / float(hits + misses) : 0.0f; }
+};
+
+/**
+ * On-disk cache of compiled SPIR-V, one file per compilation.
+ *
+ * The key hashes the source text, the contents of every file it (transitively) includes, the entry point, stage, language and compile
+ * options, plus the compiler identity (the VkMana revision and Vulkan SDK headers built against), so any change that could affect the
+ * output is a miss.
+ * Files are written to a unique temporary name and renamed into place, and are validated (header + SPIR-V hash) on load, so concurrent
+ * processes sharing the directory can never observe a partial entry.
+ *
+ * Compile() may be called from multiple threads.
+ */
+class ShaderCache
+{
+public:
+	ShaderCache() = default;
+	~ShaderCache() = default;
+
+	ShaderCache(const ShaderCache&) = delete;
+	auto operator=(const ShaderCache&) -> ShaderCache& = delete;
+
+	void Init(const std::filesystem::path& cacheDir);
+
+	/**
+	 * Same as VkMana::CompileShader(), but loads the result from the cache when possible.
+	 */
+	auto Compile(const VkMana::ShaderCompileInfo& info) -> std::optional<std::vector<uint32_t>>;
+
+	void LogStats() const;
+
+	//////////////////////////////////////////////////
+	/// Getters
+	//////////////////////////////////////////////////
+
+	auto GetStats() const -> ShaderCacheStats;
+
+private:
+	static auto GetKey(const VkMana::ShaderCompileInfo& info) -> std::optional<uint64_t>;
+	auto GetCacheFilename(uint64_t key) const -> std::filesystem::path;
+
+	auto Load(uint64_t key) const -> std::optional<std::vector<uint32_t>>;
+	void Store(uint64_t key, const std::vector<uint32_t>& spirv) const;
+
+private:
+	std::filesystem::path m_cacheDir;
+
+	std::atomic_uint32_t m_hits = 0;
+	std::atomic_uint32_t m_misses = 0;
+	std::atomic_uint64_t m_loadTimeUs = 0;
+	std::atomic_uint64_t m_compileTimeUs = 0;
+};
@@ -3,6 +3,19 @@
 #include <cstdint>
 
 #include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float3.hpp>
+
+constexpr uint32_t MAX_SUBMESH_LODS = 4;
+
+/**
+ * Index range of one level of detail. All LODs of a submesh share its vertices.
+ */
+struct SubmeshLod
+{
+	uint32_t indexOffset = 0;
+	uint32_t indexCount = 0;
+	float error = 0.0f; // Simplification error, in the submesh's local units.
+};
 
 struct Submesh
 {
@@ -12,4 +25,13 @@ struct Submesh
 	uint32_t vertexCount = 0;
 	uint32_t materialIndex = 0;
 	glm::mat4 transform = glm::mat4(1.0f);
+	// Local-space AABB of the submesh's vertices (before `transform`).
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+	// Local-space bounding sphere, centred on the AABB but fitted to the vertices (tighter than the AABB's circumsphere).
+	glm::vec3 sphereCenter = glm::vec3(0.0f);
+	float sphereRadius = 0.0f;
+	// LOD 0 is the full-resolution range (`indexOffset`/`indexCount`), followed by progressively simplified ranges.
+	uint32_t lodCount = 0;
+	SubmeshLod lods[MAX_SUBMESH_LODS] = {};
 };
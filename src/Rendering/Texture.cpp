@@ -1,31 +1,82 @@
 #include "Texture.hpp"
 
+#include "Core/Hash.hpp"
+#include "Core/Logging.hpp"
+#include "Core/Profiler.hpp"
+#include "TextureCache.hpp"
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <VkMana/Context.hpp>
 #include <stb_image.h>
 
 Texture::Texture(VkMana::Context& ctx) : m_ctx(&ctx) {}
 
-bool Texture::LoadFromFile(const std::filesystem::path& filename)
+auto Texture::LoadData(const std::filesystem::path& filename, TextureUsage usage, uint64_t* outContentHash) -> std::optional<TextureData>
 {
-	const auto& filenameStr = filename.string();
+	PROFILE_SCOPE("Texture::LoadData");
+	MappedFile file;
+	if (!file.Open(filename))
+		return std::nullopt;
+
+	const auto sourceHash = HashBytes(file.GetData(), file.GetSize());
+	if (outContentHash != nullptr)
+		*outContentHash = sourceHash;
+
+	const auto cookedFilename = CookedTexture::GetCookedFilename(filename, usage);
+	if (auto cookedData = CookedTexture::Load(cookedFilename, sourceHash, usage))
+		return cookedData;
 
-	stbi_set_flip_vertically_on_load(true);
+	// The global flip flag is not thread-safe, use the per-thread one as this runs on worker threads.
+	stbi_set_flip_vertically_on_load_thread(true);
 
 	int32_t w = 0;
 	int32_t h = 0;
 	int32_t c = 0;
-	const auto* pixels = stbi_load(filenameStr.c_str(), &w, &h, &c, 4);
-	c = 4;
-
+	auto* pixels = stbi_load_from_memory(file.GetData(), int32_t(file.GetSize()), &w, &h, &c, 4);
 	if (pixels == nullptr)
 	{
-		return false;
+		return std::nullopt;
 	}
 
-	const auto imageInfo = VkMana::ImageCreateInfo::Texture(w, h);
-	const VkMana::ImageDataSource dataSrc{ uint32_t(w * h * c), pixels };
-	m_image = m_ctx->CreateImage(imageInfo, &dataSrc);
+	auto data = CookedTexture::Cook(pixels, uint32_t(w), uint32_t(h), usage);
+	stbi_image_free(pixels);
+
+	if (!CookedTexture::Write(cookedFilename, sourceHash, usage, data))
+		LOG_WARN("Failed to write cooked texture: {}", cookedFilename.string());
+
+	return data;
+}
+
+bool Texture::LoadFromFile(const std::filesystem::path& filename, TextureUsage usage)
+{
+	const auto data = LoadData(filename, usage);
+	if (!data)
+		return false;
+
+	return FromData(data.value());
+}
+
+bool Texture::FromData(const TextureData& data)
+{
+	if (data.mipLevels.empty())
+		return false;
+
+	auto imageInfo = VkMana::ImageCreateInfo::Texture(data.width, data.height, false);
+	imageInfo.Format = data.format;
+	imageInfo.MipLevels = uint32_t(data.mipLevels.size());
+
+	// One data source per mip level, the chain is precomputed so nothing is generated at runtime.
+	std::vector<VkMana::ImageDataSource> dataSrcs;
+	dataSrcs.reserve(data.mipLevels.size());
+	m_memorySize = 0;
+	for (const auto& mipLevel : data.mipLevels)
+	{
+		dataSrcs.push_back({ uint32_t(mipLevel.size), data.GetData() + mipLevel.offset });
+		m_memorySize += mipLevel.size;
+	}
+	m_image = m_ctx->CreateImage(imageInfo, dataSrcs.data());
+	m_width = data.width;
+	m_height = data.height;
 
 	return m_image != nullptr;
 }
@@ -40,6 +91,12 @@ bool Texture::FromData(uint32_t width, uint32_t height, const void* data)
 	const auto imageInfo = VkMana::ImageCreateInfo::Texture(width, height);
 	const VkMana::ImageDataSource dataSrc{ uint32_t(width * height * 4), data };
 	m_image = m_ctx->CreateImage(imageInfo, &dataSrc);
+	m_width = width;
+	m_height = height;
+
+	// A full mip chain adds roughly a third on top of the base level.
+	const auto baseSize = uint64_t(width) * height * 4;
+	m_memorySize = baseSize + baseSize / 3;
 
 	return m_image != nullptr;
 }
@@ -1,8 +1,52 @@
 #pragma once
 
+#include "Core/MappedFile.hpp"
+
 #include <VkMana/Image.hpp>
 
+#include <cstdint>
 #include <filesystem>
+#include <optional>
+#include <vector>
+
+enum class TextureUsage : uint32_t
+{
+	Color,	   // sRGB, cooked to BC1 (opaque) or BC3 (with alpha).
+	NormalMap, // Linear, cooked to BC5. Only XY are stored, Z is reconstructed in the shader.
+};
+
+/**
+ * Texel data of every mip level, waiting to be uploaded with Texture::FromData().
+ * Loading touches no GPU state, so it is safe to do on worker threads.
+ */
+struct TextureData
+{
+	struct MipLevel
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint64_t offset = 0;
+		uint64_t size = 0;
+	};
+
+	vk::Format format = vk::Format::eUndefined;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<MipLevel> mipLevels;
+
+	// Level data lives either in the memory-mapped cooked file or in `storage`.
+	MappedFile file;
+	std::vector<uint8_t> storage;
+
+	auto GetData() const -> const uint8_t* { return file.IsOpen() ? file.GetData() : storage.data(); }
+	auto GetSize() const -> uint64_t
+	{
+		uint64_t size = 0;
+		for (const auto& mipLevel : mipLevels)
+			size += mipLevel.size;
+		return size;
+	}
+};
 
 class Texture
 {
@@ -10,13 +54,29 @@ public:
 	explicit Texture(VkMana::Context& ctx);
 	~Texture() = default;
 
-	bool LoadFromFile(const std::filesystem::path& filename);
+	/**
+	 * Loads the cooked version of an image file, cooking it first if it is missing or out of date.
+	 * If `outContentHash` is given, it receives the hash of the source file contents.
+	 */
+	static auto LoadData(const std::filesystem::path& filename, TextureUsage usage, uint64_t* outContentHash = nullptr) -> std::optional<TextureData>;
+
+	bool LoadFromFile(const std::filesystem::path& filename, TextureUsage usage = TextureUsage::Color);
+	bool FromData(const TextureData& data);
 	bool FromData(uint32_t width, uint32_t height, const void* data);
 
 	auto GetImage() -> auto& { return m_image; }
 	auto GetImage() const -> const auto& { return m_image; }
+	auto GetWidth() const -> uint32_t { return m_width; }
+	auto GetHeight() const -> uint32_t { return m_height; }
+	/**
+	 * Approximate GPU memory of the image, including the mip chain.
+	 */
+	auto GetMemorySize() const -> uint64_t { return m_memorySize; }
 
 private:
 	VkMana::Context* m_ctx = nullptr;
 	VkMana::ImageHandle m_image = nullptr;
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	uint64_t m_memorySize = 0;
 };
@@ -0,0 +1,527 @@
+#include "TextureCache.hpp"
+
+#include "Core/Hash.hpp"
+#include "Core/Logging.hpp"
+#include "Core/TempFile.hpp"
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <system_error>
+
+namespace
+{
+	/* Bump when the cooked output changes (mip filtering, compression settings). */
+	constexpr uint32_t COOKED_TEXTURE_VERSION = 1;
+
+	constexpr std::array<uint8_t, 12> KTX2_IDENTIFIER = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	constexpr std::string_view KTX2_COOK_INFO_KEY = "GSCookInfo";
+	constexpr uint64_t KTX2_LEVEL_ALIGNMENT = 16; // lcm(block size, 4) for every BC format used.
+
+	struct Ktx2Header
+	{
+		std::array<uint8_t, 12> identifier = KTX2_IDENTIFIER;
+		uint32_t vkFormat = 0;
+		uint32_t typeSize = 1;
+		uint32_t pixelWidth = 0;
+		uint32_t pixelHeight = 0;
+		uint32_t pixelDepth = 0;
+		uint32_t layerCount = 0;
+		uint32_t faceCount = 1;
+		uint32_t levelCount = 0;
+		uint32_t supercompressionScheme = 0;
+		uint32_t dfdByteOffset = 0;
+		uint32_t dfdByteLength = 0;
+		uint32_t kvdByteOffset = 0;
+		uint32_t kvdByteLength = 0;
+		uint64_t sgdByteOffset = 0;
+		uint64_t sgdByteLength = 0;
+	};
+	static_assert(sizeof(Ktx2Header) == 80);
+
+	struct Ktx2LevelIndex
+	{
+		uint64_t byteOffset = 0;
+		uint64_t byteLength = 0;
+		uint64_t uncompressedByteLength = 0;
+	};
+
+	/* Value stored under KTX2_COOK_INFO_KEY, used to validate the cooked file against its source. */
+	struct CookInfo
+	{
+		uint64_t sourceHash = 0;
+		uint64_t cookKey = 0;
+	};
+
+	inline auto GetCookKey(TextureUsage usage) -> uint64_t
+	{
+		return HashCombine(HashCombine(HASH_FNV1A_OFFSET, COOKED_TEXTURE_VERSION), usage);
+	}
+
+	inline auto AlignUp(uint64_t value, uint64_t alignment) -> uint64_t
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	inline auto GetBlockSize(vk::Format format) -> uint32_t
+	{
+		switch (format)
+		{
+			case vk::Format::eBc1RgbUnormBlock:
+			case vk::Format::eBc1RgbSrgbBlock:
+				return 8;
+			default:
+				return 16;
+		}
+	}
+
+	/* The formats Cook() produces for `usage`. Anything else in a cooked file did not come from this cooker. */
+	inline bool IsCookedFormat(vk::Format format, TextureUsage usage)
+	{
+		if (usage == TextureUsage::NormalMap)
+			return format == vk::Format::eBc5UnormBlock;
+		return format == vk::Format::eBc1RgbSrgbBlock || format == vk::Format::eBc3SrgbBlock;
+	}
+
+	inline auto GetLevelSize(vk::Format format, uint32_t width, uint32_t height) -> uint64_t
+	{
+		return uint64_t((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(format);
+	}
+
+	inline auto GetMipCount(uint32_t width, uint32_t height) -> uint32_t
+	{
+		auto count = 1u;
+		for (auto size = std::max(width, height); size > 1; size /= 2)
+			++count;
+		return count;
+	}
+
+	//////////////////////////////////////////////////
+	/// Mip Generation
+	//////////////////////////////////////////////////
+
+	struct FloatImage
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<glm::vec4> texels;
+
+		auto At(uint32_t x, uint32_t y) const -> const glm::vec4& { return texels[size_t(y) * width + x]; }
+	};
+
+	inline auto SrgbToLinear(float value) -> float
+	{
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	inline auto LinearToSrgb(float value) -> float
+	{
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	}
+
+	inline auto ToUnorm8(float value) -> uint8_t
+	{
+		return uint8_t(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+
+	/* Unpacks RGBA8 into a filterable space: linear RGB for color, unit vectors for normal maps. */
+	auto ToFloatImage(const uint8_t* pixels, uint32_t width, uint32_t height, TextureUsage usage) -> FloatImage
+	{
+		std::array<float, 256> srgbToLinear{};
+		for (auto i = 0u; i < 256; ++i)
+			srgbToLinear[i] = SrgbToLinear(float(i) / 255.0f);
+
+		FloatImage image{ width, height, std::vector<glm::vec4>(size_t(width) * height) };
+		for (size_t i = 0; i < image.texels.size(); ++i)
+		{
+			const auto* texel = &pixels[i * 4];
+			if (usage == TextureUsage::Color)
+			{
+				image.texels[i] = { srgbToLinear[texel[0]], srgbToLinear[texel[1]], srgbToLinear[texel[2]], float(texel[3]) / 255.0f };
+			}
+			else
+			{
+				const glm::vec3 normal = glm::vec3(texel[0], texel[1], texel[2]) / 127.5f - 1.0f;
+				image.texels[i] = { normal, 1.0f };
+			}
+		}
+		return image;
+	}
+
+	auto ToUnorm8Image(const FloatImage& image, TextureUsage usage) -> std::vector<uint8_t>
+	{
+		std::vector<uint8_t> pixels(image.texels.size() * 4);
+		for (size_t i = 0; i < image.texels.size(); ++i)
+		{
+			const auto& texel = image.texels[i];
+			auto* outTexel = &pixels[i * 4];
+			if (usage == TextureUsage::Color)
+			{
+				outTexel[0] = ToUnorm8(LinearToSrgb(texel.r));
+				outTexel[1] = ToUnorm8(LinearToSrgb(texel.g));
+				outTexel[2] = ToUnorm8(LinearToSrgb(texel.b));
+				outTexel[3] = ToUnorm8(texel.a);
+			}
+			else
+			{
+				const auto length = glm::length(glm::vec3(texel));
+				const auto normal = length > 0.0f ? glm::vec3(texel) / length : glm::vec3(0, 0, 1);
+				outTexel[0] = ToUnorm8(normal.x * 0.5f + 0.5f);
+				outTexel[1] = ToUnorm8(normal.y * 0.5f + 0.5f);
+				outTexel[2] = ToUnorm8(normal.z * 0.5f + 0.5f);
+				outTexel[3] = 255;
+			}
+		}
+		return pixels;
+	}
+
+	/* 2x2 box filter. Odd dimensions clamp the last row/column. */
+	auto Downsample(const FloatImage& image) -> FloatImage
+	{
+		FloatImage outImage{ std::max(image.width / 2, 1u), std::max(image.height / 2, 1u), {} };
+		outImage.texels.resize(size_t(outImage.width) * outImage.height);
+		for (auto y = 0u; y < outImage.height; ++y)
+		{
+			const auto y0 = std::min(y * 2, image.height - 1);
+			const auto y1 = std::min(y * 2 + 1, image.height - 1);
+			for (auto x = 0u; x < outImage.width; ++x)
+			{
+				const auto x0 = std::min(x * 2, image.width - 1);
+				const auto x1 = std::min(x * 2 + 1, image.width - 1);
+				outImage.texels[size_t(y) * outImage.width + x] = (image.At(x0, y0) + image.At(x1, y0) + image.At(x0, y1) + image.At(x1, y1)) * 0.25f;
+			}
+		}
+		return outImage;
+	}
+
+	//////////////////////////////////////////////////
+	/// Block Compression
+	//////////////////////////////////////////////////
+
+	void CompressLevel(const uint8_t* pixels, uint32_t width, uint32_t height, vk::Format format, uint8_t* outBlocks)
+	{
+		const auto blockSize = GetBlockSize(format);
+		const auto blocksX = (width + 3) / 4;
+		const auto blocksY = (height + 3) / 4;
+
+		std::array<uint8_t, 16 * 4> blockRgba{};
+		std::array<uint8_t, 16 * 2> blockRg{};
+		for (auto by = 0u; by < blocksY; ++by)
+		{
+			for (auto bx = 0u; bx < blocksX; ++bx)
+			{
+				// Gather the 4x4 block, clamping at the edges of levels smaller than a block.
+				for (auto i = 0u; i < 16; ++i)
+				{
+					const auto x = std::min(bx * 4 + i % 4, width - 1);
+					const auto y = std::min(by * 4 + i / 4, height - 1);
+					const auto* texel = &pixels[(size_t(y) * width + x) * 4];
+					std::memcpy(&blockRgba[i * 4], texel, 4);
+					blockRg[i * 2 + 0] = texel[0];
+					blockRg[i * 2 + 1] = texel[1];
+				}
+
+				auto* outBlock = outBlocks + (size_t(by) * blocksX + bx) * blockSize;
+				switch (format)
+				{
+					case vk::Format::eBc5UnormBlock:
+						stb_compress_bc5_block(outBlock, blockRg.data());
+						break;
+					case vk::Format::eBc3SrgbBlock:
+						stb_compress_dxt_block(outBlock, blockRgba.data(), 1, STB_DXT_HIGHQUAL);
+						break;
+					default:
+						stb_compress_dxt_block(outBlock, blockRgba.data(), 0, STB_DXT_HIGHQUAL);
+						break;
+				}
+			}
+		}
+	}
+
+	//////////////////////////////////////////////////
+	/// KTX2
+	//////////////////////////////////////////////////
+
+	/* Basic data format descriptor (Khronos Data Format spec, section 5) for the BC formats written by the cooker. */
+	auto BuildDataFormatDescriptor(vk::Format format) -> std::vector<uint32_t>
+	{
+		struct Sample
+		{
+			uint32_t bitOffset;
+			uint32_t channelType;
+		};
+
+		constexpr uint32_t KHR_DF_MODEL_BC1A = 128;
+		constexpr uint32_t KHR_DF_MODEL_BC3 = 130;
+		constexpr uint32_t KHR_DF_MODEL_BC5 = 132;
+		constexpr uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+		constexpr uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+		constexpr uint32_t KHR_DF_TRANSFER_SRGB = 2;
+		constexpr uint32_t KHR_DF_SAMPLE_DATATYPE_LINEAR = 0x10;
+
+		uint32_t colorModel = KHR_DF_MODEL_BC1A;
+		uint32_t transfer = KHR_DF_TRANSFER_SRGB;
+		std::vector<Sample> samples;
+		switch (format)
+		{
+			case vk::Format::eBc3SrgbBlock:
+				colorModel = KHR_DF_MODEL_BC3;
+				samples = { { 0, 15 | KHR_DF_SAMPLE_DATATYPE_LINEAR }, { 64, 0 } }; // Alpha, Color
+				break;
+			case vk::Format::eBc5UnormBlock:
+				colorModel = KHR_DF_MODEL_BC5;
+				transfer = KHR_DF_TRANSFER_LINEAR;
+				samples = { { 0, 0 }, { 64, 1 } }; // Red, Green
+				break;
+			default:
+				samples = { { 0, 0 } }; // Color
+				break;
+		}
+
+		const auto blockSize = GetBlockSize(format);
+		const auto descriptorBlockSize = uint32_t(24 + 16 * samples.size());
+
+		std::vector<uint32_t> dfd;
+		dfd.push_back(4 + descriptorBlockSize); // dfdTotalSize
+		dfd.push_back(0);						// vendorId = Khronos, descriptorType = basic
+		dfd.push_back(2 | (descriptorBlockSize << 16));
+		dfd.push_back(colorModel | (KHR_DF_PRIMARIES_BT709 << 8) | (transfer << 16));
+		dfd.push_back(3 | (3 << 8)); // 4x4x1x1 texel block
+		dfd.push_back(blockSize);	 // bytesPlane0
+		dfd.push_back(0);
+		for (const auto& sample : samples)
+		{
+			dfd.push_back(sample.bitOffset | (63 << 16) | (sample.channelType << 24));
+			dfd.push_back(0);		   // samplePosition
+			dfd.push_back(0);		   // sampleLower
+			dfd.push_back(0xFFFFFFFF); // sampleUpper
+		}
+		return dfd;
+	}
+
+	auto BuildKeyValueData(const CookInfo& cookInfo) -> std::vector<uint8_t>
+	{
+		const auto keyAndValueLength = uint32_t(KTX2_COOK_INFO_KEY.size() + 1 + sizeof(CookInfo));
+
+		std::vector<uint8_t> kvd(AlignUp(sizeof(uint32_t) + keyAndValueLength, 4));
+		auto* ptr = kvd.data();
+		std::memcpy(ptr, &keyAndValueLength, sizeof(uint32_t));
+		ptr += sizeof(uint32_t);
+		std::memcpy(ptr, KTX2_COOK_INFO_KEY.data(), KTX2_COOK_INFO_KEY.size());
+		ptr += KTX2_COOK_INFO_KEY.size() + 1; // Key is null-terminated
+		std::memcpy(ptr, &cookInfo, sizeof(CookInfo));
+		return kvd;
+	}
+
+	auto FindCookInfo(const uint8_t* kvd, uint64_t kvdLength) -> std::optional<CookInfo>
+	{
+		uint64_t offset = 0;
+		while (offset + sizeof(uint32_t) <= kvdLength)
+		{
+			uint32_t keyAndValueLength = 0;
+			std::memcpy(&keyAndValueLength, kvd + offset, sizeof(uint32_t));
+			offset += sizeof(uint32_t);
+			if (keyAndValueLength > kvdLength - offset)
+				return std::nullopt;
+
+			const std::string_view keyAndValue(reinterpret_cast<const char*>(kvd + offset), keyAndValueLength);
+			const auto keyLength = keyAndValue.find('\0');
+			if (keyLength != std::string_view::npos && keyAndValue.substr(0, keyLength) == KTX2_COOK_INFO_KEY
+				&& keyAndValueLength - keyLength - 1 == sizeof(CookInfo))
+			{
+				CookInfo cookInfo{};
+				std::memcpy(&cookInfo, keyAndValue.data() + keyLength + 1, sizeof(CookInfo));
+				return cookInfo;
+			}
+			offset = AlignUp(offset + keyAndValueLength, 4);
+		}
+		return std::nullopt;
+	}
+
+} // namespace
+
+auto CookedTexture::GetCookedFilename(const std::filesystem::path& sourceFilename, TextureUsage usage) -> std::filesystem::path
+{
+	auto cookedFilename = sourceFilename;
+	cookedFilename += usage == TextureUsage::NormalMap ? ".normal.ktx2" : ".color.ktx2";
+	return cookedFilename;
+}
+
+auto CookedTexture::Cook(const uint8_t* pixels, uint32_t width, uint32_t height, TextureUsage usage) -> TextureData
+{
+	TextureData data{};
+	data.width = width;
+	data.height = height;
+
+	if (usage == TextureUsage::NormalMap)
+	{
+		data.format = vk::Format::eBc5UnormBlock;
+	}
+	else
+	{
+		const auto texelCount = size_t(width) * height;
+		bool hasAlpha = false;
+		for (size_t i = 0; i < texelCount && !hasAlpha; ++i)
+			hasAlpha = pixels[i * 4 + 3] != 255;
+
+		data.format = hasAlpha ? vk::Format::eBc3SrgbBlock : vk::Format::eBc1RgbSrgbBlock;
+	}
+	auto levelImage = ToFloatImage(pixels, width, height, usage);
+	while (true)
+	{
+		// The base level is compressed straight from the source pixels, so it doesn't round-trip through float.
+		const auto levelPixels = data.mipLevels.empty() ? std::vector<uint8_t>() : ToUnorm8Image(levelImage, usage);
+		const auto* levelSrc = data.mipLevels.empty() ? pixels : levelPixels.data();
+
+		auto& mipLevel = data.mipLevels.emplace_back();
+		mipLevel.width = levelImage.width;
+		mipLevel.height = levelImage.height;
+		mipLevel.offset = AlignUp(data.storage.size(), KTX2_LEVEL_ALIGNMENT);
+		mipLevel.size = GetLevelSize(data.format, levelImage.width, levelImage.height);
+
+		data.storage.resize(mipLevel.offset + mipLevel.size);
+		CompressLevel(levelSrc, levelImage.width, levelImage.height, data.format, data.storage.data() + mipLevel.offset);
+
+		if (levelImage.width == 1 && levelImage.height == 1)
+			break;
+		levelImage = Downsample(levelImage);
+	}
+
+	return data;
+}
+
+bool CookedTexture::Write(const std::filesystem::path& filename, uint64_t sourceHash, TextureUsage usage, const TextureData& data)
+{
+	const auto levelCount = uint32_t(data.mipLevels.size());
+	const auto dfd = BuildDataFormatDescriptor(data.format);
+	const auto kvd = BuildKeyValueData({ sourceHash, GetCookKey(usage) });
+
+	Ktx2Header header{};
+	header.vkFormat = uint32_t(data.format);
+	header.pixelWidth = data.width;
+	header.pixelHeight = data.height;
+	header.levelCount = levelCount;
+	header.dfdByteOffset = uint32_t(sizeof(Ktx2Header) + sizeof(Ktx2LevelIndex) * levelCount);
+	header.dfdByteLength = uint32_t(dfd.size() * sizeof(uint32_t));
+	header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+	header.kvdByteLength = uint32_t(kvd.size());
+
+	// KTX2 stores the level data from the smallest mip to the largest.
+	std::vector<Ktx2LevelIndex> levelIndex(levelCount);
+	auto offset = uint64_t(header.kvdByteOffset) + header.kvdByteLength;
+	for (auto i = int32_t(levelCount) - 1; i >= 0; --i)
+	{
+		offset = AlignUp(offset, KTX2_LEVEL_ALIGNMENT);
+		levelIndex[i].byteOffset = offset;
+		levelIndex[i].byteLength = data.mipLevels[i].size;
+		levelIndex[i].uncompressedByteLength = data.mipLevels[i].size;
+		offset += data.mipLevels[i].size;
+	}
+
+	// Write to a temporary file and rename it into place, so a concurrent/crashed cook never leaves a partial file behind.
+	const auto tempFilename = GetTempFilename(filename);
+	{
+		std::ofstream stream(tempFilename, std::ios::binary | std::ios::trunc);
+		if (!stream)
+			return false;
+
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(reinterpret_cast<const char*>(levelIndex.data()), std::streamsize(sizeof(Ktx2LevelIndex) * levelCount));
+		stream.write(reinterpret_cast<const char*>(dfd.data()), header.dfdByteLength);
+		stream.write(reinterpret_cast<const char*>(kvd.data()), header.kvdByteLength);
+
+		auto position = uint64_t(header.kvdByteOffset) + header.kvdByteLength;
+		constexpr char zeroes[KTX2_LEVEL_ALIGNMENT] = {};
+		for (auto i = int32_t(levelCount) - 1; i >= 0; --i)
+		{
+			stream.write(zeroes, std::streamsize(levelIndex[i].byteOffset - position));
+			stream.write(reinterpret_cast<const char*>(data.GetData() + data.mipLevels[i].offset), std::streamsize(levelIndex[i].byteLength));
+			position = levelIndex[i].byteOffset + levelIndex[i].byteLength;
+		}
+		if (!stream)
+		{
+			stream.close();
+			std::error_code err;
+			std::filesystem::remove(tempFilename, err);
+			return false;
+		}
+	}
+
+	std::error_code err;
+	std::filesystem::rename(tempFilename, filename, err);
+	if (err)
+	{
+		std::filesystem::remove(tempFilename, err);
+		return false;
+	}
+
+	return true;
+}
+
+auto CookedTexture::Load(const std::filesystem::path& filename, uint64_t sourceHash, TextureUsage usage) -> std::optional<TextureData>
+{
+	TextureData data{};
+	if (!data.file.Open(filename))
+		return std::nullopt;
+
+	const auto fileSize = uint64_t(data.file.GetSize());
+	const auto* fileData = data.file.GetData();
+	if (fileSize < sizeof(Ktx2Header))
+		return std::nullopt;
+
+	Ktx2Header header{};
+	std::memcpy(&header, fileData, sizeof(Ktx2Header));
+	if (header.identifier != KTX2_IDENTIFIER || header.supercompressionScheme != 0 || header.levelCount == 0 || header.faceCount != 1
+		|| header.layerCount > 1 || header.pixelDepth > 1)
+		return std::nullopt;
+
+	if (uint64_t(header.kvdByteOffset) + header.kvdByteLength > fileSize
+		|| sizeof(Ktx2Header) + uint64_t(sizeof(Ktx2LevelIndex)) * header.levelCount > fileSize)
+		return std::nullopt;
+
+	const auto cookInfo = FindCookInfo(fileData + header.kvdByteOffset, header.kvdByteLength);
+	if (!cookInfo || cookInfo->sourceHash != sourceHash || cookInfo->cookKey != GetCookKey(usage))
+		return std::nullopt;
+
+	// The image is created straight from these levels, so each one must hold exactly the blocks its format and size need.
+	data.format = vk::Format(header.vkFormat);
+	data.width = header.pixelWidth;
+	data.height = header.pixelHeight;
+	if (!IsCookedFormat(data.format, usage) || data.width == 0 || data.height == 0 || header.levelCount > GetMipCount(data.width, data.height))
+	{
+		LOG_WARN("Cooked texture has an unexpected format or size: {}", filename.string());
+		return std::nullopt;
+	}
+
+	data.mipLevels.resize(header.levelCount);
+	for (auto i = 0u; i < header.levelCount; ++i)
+	{
+		Ktx2LevelIndex levelIndex{};
+		std::memcpy(&levelIndex, fileData + sizeof(Ktx2Header) + sizeof(Ktx2LevelIndex) * i, sizeof(Ktx2LevelIndex));
+
+		auto& mipLevel = data.mipLevels[i];
+		mipLevel.width = std::max(header.pixelWidth >> i, 1u);
+		mipLevel.height = std::max(header.pixelHeight >> i, 1u);
+		mipLevel.offset = levelIndex.byteOffset;
+		mipLevel.size = levelIndex.byteLength;
+
+		if (levelIndex.byteOffset > fileSize || levelIndex.byteLength > fileSize - levelIndex.byteOffset
+			|| levelIndex.byteLength != GetLevelSize(data.format, mipLevel.width, mipLevel.height))
+		{
+			LOG_WARN("Cooked texture is truncated or corrupt: {}", filename.string());
+			return std::nullopt;
+		}
+	}
+
+	return data;
+}
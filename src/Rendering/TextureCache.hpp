@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Texture.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+/**
+ * Cooked textures are block-compressed (BC1/BC3/BC5) with a full, precomputed mip chain, stored in a KTX2 container next to the source image.
+ * Each usage has its own file, so an image used both as color and as a normal map keeps both cooked versions.
+ * Loading memory-maps the KTX2 file and exposes the mip levels in place, so the upload needs no decode work.
+ *
+ * The cache is invalidated when the cooker version, the source file hash or the texture usage change.
+ */
+class CookedTexture
+{
+public:
+	static auto GetCookedFilename(const std::filesystem::path& sourceFilename, TextureUsage usage) -> std::filesystem::path;
+
+	/**
+	 * Builds the mip chain from RGBA8 pixels and block-compresses every level.
+	 * Color textures become BC1 (opaque) or BC3 (with alpha) sRGB, normal maps become BC5 (XY only).
+	 */
+	static auto Cook(const uint8_t* pixels, uint32_t width, uint32_t height, TextureUsage usage) -> TextureData;
+
+	static bool Write(const std::filesystem::path& filename, uint64_t sourceHash, TextureUsage usage, const TextureData& data);
+	static auto Load(const std::filesystem::path& filename, uint64_t sourceHash, TextureUsage usage) -> std::optional<TextureData>;
+};
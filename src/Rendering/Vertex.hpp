@@ -3,10 +3,30 @@
 #include <glm/ext/vector_float2.hpp>
 #include <glm/ext/vector_float3.hpp>
 
+#include <cstdint>
+
+enum class VertexFormat : uint32_t
+{
+	Full,	// Vertex
+	Packed, // PackedVertex
+};
+
 struct Vertex
 {
 	glm::vec3 position{};
 	glm::vec2 texCoord{};
 	glm::vec3 normal{};
 	glm::vec3 tangent{};
-};
\ No newline at end of file
+};
+
+/**
+ * Quantized vertex, see VertexPacking.hpp for the encoding.
+ */
+struct PackedVertex
+{
+	uint16_t position[4]{}; // Unorm16, relative to the submesh bounds. W is unused.
+	uint32_t texCoord = 0;	// 2x half float
+	uint32_t normal = 0;	// Octahedral, 2x snorm16
+	uint32_t tangent = 0;	// Octahedral, 2x snorm16
+};
+static_assert(sizeof(PackedVertex) == 20);
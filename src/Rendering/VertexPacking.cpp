@@ -0,0 +1,109 @@
+#include "VertexPacking.hpp"
+
+#include <glm/common.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/geometric.hpp>
+#include <glm/packing.hpp>
+#include <glm/trigonometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	inline auto SignNotZero(const glm::vec2& v) -> glm::vec2
+	{
+		return { v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f };
+	}
+
+	inline auto AngleBetween(const glm::vec3& a, const glm::vec3& b) -> float
+	{
+		const auto lengths = glm::length(a) * glm::length(b);
+		if (lengths <= 0.0f)
+			return 0.0f;
+		return glm::degrees(std::acos(std::clamp(glm::dot(a, b) / lengths, -1.0f, 1.0f)));
+	}
+} // namespace
+
+void VertexQuantizationError::Merge(const VertexQuantizationError& other)
+{
+	vertexCount += other.vertexCount;
+	maxPositionError = std::max(maxPositionError, other.maxPositionError);
+	maxTexCoordError = std::max(maxTexCoordError, other.maxTexCoordError);
+	maxNormalError = std::max(maxNormalError, other.maxNormalError);
+	maxTangentError = std::max(maxTangentError, other.maxTangentError);
+}
+
+auto OctEncode(const glm::vec3& normal) -> glm::vec2
+{
+	const auto l1Norm = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+	if (l1Norm <= 0.0f)
+		return { 0.0f, 0.0f };
+
+	auto encoded = glm::vec2(normal) / l1Norm;
+	if (normal.z < 0.0f)
+		encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * SignNotZero(encoded);
+	return encoded;
+}
+
+auto OctDecode(const glm::vec2& encoded) -> glm::vec3
+{
+	glm::vec3 normal(encoded, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+	const auto t = std::max(-normal.z, 0.0f);
+	normal.x += normal.x >= 0.0f ? -t : t;
+	normal.y += normal.y >= 0.0f ? -t : t;
+	return glm::normalize(normal);
+}
+
+auto PackVertex(const Vertex& vertex, const glm::vec3& boundsMin, const glm::vec3& boundsMax) -> PackedVertex
+{
+	const auto extent = boundsMax - boundsMin;
+
+	PackedVertex packed{};
+	for (auto i = 0; i < 3; ++i)
+	{
+		const auto normalized = extent[i] > 0.0f ? (vertex.position[i] - boundsMin[i]) / extent[i] : 0.0f;
+		packed.position[i] = uint16_t(std::round(std::clamp(normalized, 0.0f, 1.0f) * 65535.0f));
+	}
+	packed.texCoord = glm::packHalf2x16(vertex.texCoord);
+	packed.normal = glm::packSnorm2x16(OctEncode(vertex.normal));
+	packed.tangent = glm::packSnorm2x16(OctEncode(vertex.tangent));
+	return packed;
+}
+
+auto UnpackVertex(const PackedVertex& vertex, const glm::vec3& boundsMin, const glm::vec3& boundsMax) -> Vertex
+{
+	const auto extent = boundsMax - boundsMin;
+
+	Vertex unpacked{};
+	for (auto i = 0; i < 3; ++i)
+		unpacked.position[i] = boundsMin[i] + float(vertex.position[i]) / 65535.0f * extent[i];
+	unpacked.texCoord = glm::unpackHalf2x16(vertex.texCoord);
+	unpacked.normal = OctDecode(glm::unpackSnorm2x16(vertex.normal));
+	unpacked.tangent = OctDecode(glm::unpackSnorm2x16(vertex.tangent));
+	return unpacked;
+}
+
+auto PackVertices(const Vertex* vertices, uint32_t count, const glm::vec3& boundsMin, const glm::vec3& boundsMax, PackedVertex* outVertices)
+	-> VertexQuantizationError
+{
+	VertexQuantizationError error{};
+	error.vertexCount = count;
+	for (auto i = 0u; i < count; ++i)
+	{
+		const auto& vertex = vertices[i];
+		outVertices[i] = PackVertex(vertex, boundsMin, boundsMax);
+
+		const auto unpacked = UnpackVertex(outVertices[i], boundsMin, boundsMax);
+		error.maxPositionError = std::max(error.maxPositionError, glm::length(unpacked.position - vertex.position));
+		error.maxTexCoordError = std::max(error.maxTexCoordError, glm::length(unpacked.texCoord - vertex.texCoord));
+		error.maxNormalError = std::max(error.maxNormalError, AngleBetween(unpacked.normal, vertex.normal));
+		error.maxTangentError = std::max(error.maxTangentError, AngleBetween(unpacked.tangent, vertex.tangent));
+	}
+	return error;
+}
+
+auto GetPositionDequantizeTransform(const Submesh& submesh) -> glm::mat4
+{
+	return glm::scale(glm::translate(glm::mat4(1.0f), submesh.boundsMin), submesh.boundsMax - submesh.boundsMin);
+}
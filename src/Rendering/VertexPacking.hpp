@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Submesh.hpp"
+#include "Vertex.hpp"
+
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float3.hpp>
+
+#include <cstdint>
+
+/**
+ * Worst-case precision loss of packing a set of vertices.
+ */
+struct VertexQuantizationError
+{
+	uint32_t vertexCount = 0;
+	float maxPositionError = 0.0f; // Mesh units
+	float maxTexCoordError = 0.0f;
+	float maxNormalError = 0.0f;  // Degrees
+	float maxTangentError = 0.0f; // Degrees
+
+	void Merge(const VertexQuantizationError& other);
+};
+
+auto OctEncode(const glm::vec3& normal) -> glm::vec2;
+auto OctDecode(const glm::vec2& encoded) -> glm::vec3;
+
+auto PackVertex(const Vertex& vertex, const glm::vec3& boundsMin, const glm::vec3& boundsMax) -> PackedVertex;
+auto UnpackVertex(const PackedVertex& vertex, const glm::vec3& boundsMin, const glm::vec3& boundsMax) -> Vertex;
+
+/**
+ * Packs `count` vertices quantized against the given bounds, and measures the error by unpacking them again.
+ */
+auto PackVertices(const Vertex* vertices, uint32_t count, const glm::vec3& boundsMin, const glm::vec3& boundsMax, PackedVertex* outVertices)
+	-> VertexQuantizationError;
+
+/**
+ * Maps unorm positions back into the submesh's space. Folded into the instance transform, so the shader needs no per-submesh data.
+ */
+auto GetPositionDequantizeTransform(const Submesh& submesh) -> glm::mat4;
@@ -0,0 +1,98 @@
+/**
+ * Compile-time checks for the VkMana API this tree relies on beyond what it was first written against. VkMana is fetched by
+ * revision (GS_VKMANA_GIT_TAG), so a revision without one of these fails here, with the feature that needs it, rather than
+ * somewhere in the renderer.
+ */
+
+#include <VkMana/Buffer.hpp>
+#include <VkMana/Context.hpp>
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	template <typename T, template <typename> class Expr, typename = void>
+	struct IsDetected : std::false_type
+	{
+	};
+
+	template <typename T, template <typename> class Expr>
+	struct IsDetected<T, Expr, std::void_t<Expr<T>>> : std::true_type
+	{
+	};
+
+	using BufferPtr = decltype(std::declval<VkMana::BufferHandle&>().Get());
+
+	/* GeometryBuffer: staging uploads and arena growth. */
+	template <typename Cmd>
+	using CopyBufferExpr =
+		decltype(std::declval<Cmd&>().CopyBuffer(std::declval<BufferPtr>(), uint64_t(), std::declval<BufferPtr>(), uint64_t(), uint64_t()));
+	template <typename Info>
+	using BufferUsageExpr = decltype(std::declval<Info&>().Usage |= vk::BufferUsageFlagBits::eTransferDst);
+
+	static_assert(IsDetected<VkMana::CommandBuffer, CopyBufferExpr>::value,
+		"VkMana: CommandBuffer::CopyBuffer(dst, dstOffset, src, srcOffset, size) is required by GeometryBuffer");
+	static_assert(IsDetected<VkMana::BufferCreateInfo, BufferUsageExpr>::value,
+		"VkMana: a writable BufferCreateInfo::Usage is required by GeometryBuffer and FrameRingBuffer");
+
+	/* Renderer: instanced draws of merged batches. */
+	template <typename Cmd>
+	using DrawIndexedInstancedExpr = decltype(std::declval<Cmd&>().DrawIndexed(uint32_t(), uint32_t(), uint32_t(), uint32_t(), uint32_t()));
+
+	static_assert(IsDetected<VkMana::CommandBuffer, DrawIndexedInstancedExpr>::value,
+		"VkMana: CommandBuffer::DrawIndexed(indexCount, firstIndex, vertexOffset, instanceCount, firstInstance) is required by "
+		"instanced draws");
+
+	/* Renderer: multi-draw indirect path. */
+	template <typename Cmd>
+	using DrawIndexedIndirectExpr =
+		decltype(std::declval<Cmd&>().DrawIndexedIndirect(std::declval<BufferPtr>(), uint64_t(), uint32_t(), uint32_t()));
+
+	static_assert(IsDetected<VkMana::CommandBuffer, DrawIndexedIndirectExpr>::value,
+		"VkMana: CommandBuffer::DrawIndexedIndirect(buffer, offset, drawCount, stride) is required by DrawMode::Indirect");
+	// The renderer only uses DrawMode::Indirect when the physical device supports multiDrawIndirect and drawIndirectFirstInstance,
+	// and relies on the context enabling both in that case.
+
+	/* Renderer: direct-mode draws recorded into secondary command buffers on worker threads. */
+	template <typename Ctx>
+	using RequestSecondaryCmdExpr = decltype(VkMana::CommandBufferHandle(
+		std::declval<Ctx&>().RequestSecondaryCmd(uint32_t(), std::declval<const VkMana::RenderPassInfo&>())));
+	template <typename Cmd>
+	using ExecuteCommandsExpr = decltype(std::declval<Cmd&>().ExecuteCommands(std::declval<std::vector<VkMana::CommandBufferHandle>&>()));
+	template <typename Cmd>
+	using BeginSecondaryRenderPassExpr = decltype(std::declval<Cmd&>().BeginRenderPass(
+		std::declval<const VkMana::RenderPassInfo&>(), vk::SubpassContents::eSecondaryCommandBuffers));
+
+	static_assert(IsDetected<VkMana::Context, RequestSecondaryCmdExpr>::value,
+		"VkMana: Context::RequestSecondaryCmd(threadIndex, renderPassInfo) is required by parallel draw recording");
+	static_assert(IsDetected<VkMana::CommandBuffer, ExecuteCommandsExpr>::value,
+		"VkMana: CommandBuffer::ExecuteCommands(secondaryCmds) is required by parallel draw recording");
+	static_assert(IsDetected<VkMana::CommandBuffer, BeginSecondaryRenderPassExpr>::value,
+		"VkMana: CommandBuffer::BeginRenderPass(info, subpassContents) is required by parallel draw recording");
+
+	/* PipelineCache: the cache is created on the context's device and handed to every pipeline. */
+	template <typename Ctx>
+	using GetDeviceExpr = decltype(vk::Device(std::declval<Ctx&>().GetDevice()));
+	template <typename Ctx>
+	using GetPhysicalDeviceExpr = decltype(vk::PhysicalDevice(std::declval<Ctx&>().GetPhysicalDevice()));
+	template <typename Info>
+	using PipelineCacheExpr = decltype(std::declval<Info&>().Cache = vk::PipelineCache());
+
+	static_assert(IsDetected<VkMana::Context, GetDeviceExpr>::value && IsDetected<VkMana::Context, GetPhysicalDeviceExpr>::value,
+		"VkMana: Context::GetDevice() and Context::GetPhysicalDevice() are required by PipelineCache and GpuFrameTimer");
+	static_assert(IsDetected<VkMana::GraphicsPipelineCreateInfo, PipelineCacheExpr>::value,
+		"VkMana: GraphicsPipelineCreateInfo::Cache is required by the persistent pipeline cache");
+
+	/*
+	 * GpuFrameTimer and the transfer barriers record raw Vulkan commands. Whether the context enabled VK_EXT_headless_surface is
+	 * only known at runtime, HeadlessWindow checks it before creating a surface.
+	 */
+	template <typename Cmd>
+	using GetCmdExpr = decltype(vk::CommandBuffer(std::declval<Cmd&>().GetCmd()));
+
+	static_assert(IsDetected<VkMana::CommandBuffer, GetCmdExpr>::value,
+		"VkMana: CommandBuffer::GetCmd() is required by GpuFrameTimer and GeometryBuffer");
+} // namespace
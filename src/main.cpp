@@ -1,11 +1,40 @@
 #include "Core/App.hpp"
 #include "Core/Logging.hpp"
 
-int main(int /*argc*/, char** /*argv*/)
+#include <cstdlib>
+#include <cstring>
+
+int main(int argc, char** argv)
 {
 	LOG_INFO("Graphics Sandbox");
 
-	App app{};
+	AppOptions options{};
+	for (auto i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--record-scaling") == 0)
+			options.recordScalingBenchmark = true;
+		else if (std::strcmp(argv[i], "--no-pipeline-cache") == 0)
+			options.pipelineCache = false;
+		else if (std::strcmp(argv[i], "--headless") == 0)
+			options.headless = true;
+		else if (std::strcmp(argv[i], "--no-render-thread") == 0)
+			options.renderThread = false;
+		else if (std::strcmp(argv[i], "--benchmark") == 0)
+		{
+			options.benchmarkFrames = 1000;
+			// Optional frame count
+			if (i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+				options.benchmarkFrames = uint32_t(std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--benchmark-output") == 0 && i + 1 < argc)
+			options.benchmarkOutput = argv[++i];
+		else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+			options.traceOutput = argv[++i];
+		else
+			LOG_WARN("Unknown argument: {}", argv[i]);
+	}
+
+	App app{ options };
 	app.Run();
 
 	return 0;
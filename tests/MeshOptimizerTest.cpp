@@ -0,0 +1,180 @@
+/**
+ * MeshOptimizer checks on a generated grid whose triangles are shuffled, so the input starts with poor cache locality.
+ * The optimisers may only reorder: every triangle (with its winding) must survive, the vertex cache must not get worse, and the
+ * vertex fetch reorder must be a permutation of the vertices.
+ *
+ * Usage: graphics-sandbox-mesh-optimizer-test
+ */
+
+#include "Core/Logging.hpp"
+#include "Rendering/MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t GRID_SIZE = 48; // Quads per side, (GRID_SIZE + 1)^2 vertices
+	constexpr uint32_t SHUFFLE_SEED = 1234;
+
+	uint32_t g_failures = 0;
+
+	void Check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			LOG_ERR("Failed: {}", what);
+			++g_failures;
+		}
+	}
+
+	struct TestMesh
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint16_t> indices;
+	};
+
+	auto MakeShuffledGrid() -> TestMesh
+	{
+		TestMesh mesh;
+		for (auto y = 0u; y <= GRID_SIZE; ++y)
+		{
+			for (auto x = 0u; x <= GRID_SIZE; ++x)
+			{
+				auto& vertex = mesh.vertices.emplace_back();
+				vertex.position = glm::vec3(float(x), float(y), 0.0f);
+				vertex.texCoord = glm::vec2(float(x) / GRID_SIZE, float(y) / GRID_SIZE);
+				vertex.normal = glm::vec3(0.0f, 0.0f, 1.0f);
+				vertex.tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+			}
+		}
+
+		std::vector<std::array<uint16_t, 3>> triangles;
+		for (auto y = 0u; y < GRID_SIZE; ++y)
+		{
+			for (auto x = 0u; x < GRID_SIZE; ++x)
+			{
+				const auto i0 = uint16_t(y * (GRID_SIZE + 1) + x);
+				const auto i1 = uint16_t(i0 + 1);
+				const auto i2 = uint16_t(i0 + GRID_SIZE + 1);
+				const auto i3 = uint16_t(i2 + 1);
+				triangles.push_back({ i0, i1, i3 });
+				triangles.push_back({ i0, i3, i2 });
+			}
+		}
+		std::shuffle(triangles.begin(), triangles.end(), std::mt19937(SHUFFLE_SEED));
+		for (const auto& triangle : triangles)
+			mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+		return mesh;
+	}
+
+	/* Triangles as sorted position triples, each rotated to start at its smallest position so the winding is kept. */
+	auto GetTriangleSet(const TestMesh& mesh) -> std::vector<std::array<std::array<float, 3>, 3>>
+	{
+		std::vector<std::array<std::array<float, 3>, 3>> triangles;
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			std::array<std::array<float, 3>, 3> triangle;
+			for (auto j = 0; j < 3; ++j)
+			{
+				const auto& p = mesh.vertices[mesh.indices[i + j]].position;
+				triangle[j] = { p.x, p.y, p.z };
+			}
+			std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+			triangles.push_back(triangle);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	auto GetAcmr(const TestMesh& mesh) -> float
+	{
+		return AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), uint32_t(mesh.vertices.size())).acmr;
+	}
+
+	void TestVertexCache()
+	{
+		auto mesh = MakeShuffledGrid();
+		const auto triangles = GetTriangleSet(mesh);
+		const auto acmrBefore = GetAcmr(mesh);
+
+		OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), uint32_t(mesh.vertices.size()));
+		const auto acmrAfter = GetAcmr(mesh);
+		LOG_INFO("OptimizeVertexCache: ACMR {:.3f} -> {:.3f}", acmrBefore, acmrAfter);
+
+		Check(GetTriangleSet(mesh) == triangles, "OptimizeVertexCache changed the triangle set");
+		Check(acmrAfter <= acmrBefore, "OptimizeVertexCache increased the ACMR");
+	}
+
+	void TestOverdraw()
+	{
+		constexpr float threshold = 1.05f;
+		auto mesh = MakeShuffledGrid();
+		OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), uint32_t(mesh.vertices.size()));
+		const auto triangles = GetTriangleSet(mesh);
+		const auto acmrBefore = GetAcmr(mesh);
+
+		OptimizeOverdraw(mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), uint32_t(mesh.vertices.size()), threshold);
+		const auto acmrAfter = GetAcmr(mesh);
+		LOG_INFO("OptimizeOverdraw: ACMR {:.3f} -> {:.3f}", acmrBefore, acmrAfter);
+
+		Check(GetTriangleSet(mesh) == triangles, "OptimizeOverdraw changed the triangle set");
+		Check(acmrAfter <= acmrBefore * threshold, "OptimizeOverdraw exceeded its ACMR threshold");
+	}
+
+	void TestVertexFetch()
+	{
+		auto mesh = MakeShuffledGrid();
+		OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), uint32_t(mesh.vertices.size()));
+		const auto triangles = GetTriangleSet(mesh);
+		const auto oldVertices = mesh.vertices;
+
+		OptimizeVertexFetch(mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), uint32_t(mesh.vertices.size()));
+
+		// Grid positions are unique, so they identify where each vertex came from.
+		std::map<std::array<float, 3>, uint32_t> oldIndexByPosition;
+		for (auto i = 0u; i < oldVertices.size(); ++i)
+			oldIndexByPosition[{ oldVertices[i].position.x, oldVertices[i].position.y, oldVertices[i].position.z }] = i;
+
+		std::vector<uint32_t> remapCounts(oldVertices.size(), 0);
+		for (const auto& vertex : mesh.vertices)
+		{
+			const auto it = oldIndexByPosition.find({ vertex.position.x, vertex.position.y, vertex.position.z });
+			if (it != oldIndexByPosition.end())
+				++remapCounts[it->second];
+		}
+		Check(std::all_of(remapCounts.begin(), remapCounts.end(), [](uint32_t count) { return count == 1; }),
+			"OptimizeVertexFetch remap is not a permutation");
+		Check(GetTriangleSet(mesh) == triangles, "OptimizeVertexFetch changed the triangle set");
+
+		// First-use order: each index is at most one past the largest index seen before it.
+		auto inOrder = true;
+		int32_t maxIndex = -1;
+		for (const auto index : mesh.indices)
+		{
+			inOrder &= int32_t(index) <= maxIndex + 1;
+			maxIndex = std::max(maxIndex, int32_t(index));
+		}
+		Check(inOrder, "OptimizeVertexFetch did not put vertices in first-use order");
+	}
+} // namespace
+
+int main()
+{
+	TestVertexCache();
+	TestOverdraw();
+	TestVertexFetch();
+
+	if (g_failures != 0)
+	{
+		LOG_ERR("{} checks failed", g_failures);
+		Logger::Get().Flush();
+		return 1;
+	}
+	LOG_INFO("All checks passed");
+	Logger::Get().Flush();
+	return 0;
+}
@@ -0,0 +1,150 @@
+/**
+ * RangeAllocator checks: allocation and freeing, coalescing of free neighbours, best-fit placement, alignment, Grow() and the
+ * fragmentation stats.
+ *
+ * Usage: graphics-sandbox-range-allocator-test
+ */
+
+#include "Core/Logging.hpp"
+#include "Core/RangeAllocator.hpp"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	uint32_t g_failures = 0;
+
+	void Check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			LOG_ERR("Failed: {}", what);
+			++g_failures;
+		}
+	}
+
+	auto IsAt(const std::optional<RangeAllocation>& allocation, uint64_t offset) -> bool
+	{
+		return allocation.has_value() && allocation->offset == offset;
+	}
+
+	void TestAllocateFree()
+	{
+		RangeAllocator allocator(1000);
+		const auto a = allocator.Allocate(100);
+		const auto b = allocator.Allocate(200);
+		const auto c = allocator.Allocate(700);
+		Check(IsAt(a, 0) && IsAt(b, 100) && IsAt(c, 300), "allocations are not packed from the start");
+		Check(!allocator.Allocate(1), "allocated from a full range");
+		Check(!allocator.Allocate(0), "allocated zero bytes");
+
+		auto stats = allocator.GetStats();
+		Check(stats.usedSize == 1000 && stats.freeSize == 0 && stats.allocationCount == 3, "wrong stats when full");
+
+		allocator.Free(*b);
+		Check(IsAt(allocator.Allocate(200), 100), "freed block not reused");
+	}
+
+	void TestCoalesce()
+	{
+		RangeAllocator allocator(300);
+		const auto a = allocator.Allocate(100);
+		const auto b = allocator.Allocate(100);
+		const auto c = allocator.Allocate(100);
+
+		// Middle first, so the later frees merge with a neighbour on each side.
+		allocator.Free(*b);
+		allocator.Free(*a);
+		Check(allocator.GetStats().freeBlockCount == 1, "free neighbours not merged (previous)");
+		allocator.Free(*c);
+
+		const auto stats = allocator.GetStats();
+		Check(stats.freeBlockCount == 1 && stats.largestFreeBlock == 300 && stats.allocationCount == 0, "free neighbours not merged (next)");
+		Check(IsAt(allocator.Allocate(300), 0), "coalesced range not allocatable as one block");
+	}
+
+	void TestBestFit()
+	{
+		// Holes of 100, 30 and 50 bytes, separated by live allocations.
+		RangeAllocator allocator(1000);
+		std::vector<std::optional<RangeAllocation>> allocations;
+		for (const auto size : { 100u, 10u, 30u, 10u, 50u, 10u })
+			allocations.push_back(allocator.Allocate(size));
+		allocator.Free(*allocations[0]);
+		allocator.Free(*allocations[2]);
+		allocator.Free(*allocations[4]);
+
+		Check(IsAt(allocator.Allocate(25), allocations[2]->offset), "not placed in the smallest hole that fits");
+		Check(IsAt(allocator.Allocate(40), allocations[4]->offset), "not placed in the smallest remaining hole that fits");
+	}
+
+	void TestAlignment()
+	{
+		RangeAllocator allocator(100);
+		allocator.Allocate(1);
+		const auto aligned = allocator.Allocate(24, 12); // Vertex stride, not a power of two
+		Check(IsAt(aligned, 12), "allocation not aligned to a non-power-of-two stride");
+
+		// The padding in front stays free.
+		Check(IsAt(allocator.Allocate(11), 1), "alignment padding not returned to the free list");
+		Check(!allocator.Allocate(100, 0), "allocated with zero alignment");
+	}
+
+	void TestGrow()
+	{
+		RangeAllocator allocator(100);
+		const auto a = allocator.Allocate(60);
+		Check(!allocator.Allocate(80), "allocated more than the free space");
+
+		allocator.Grow(200);
+		const auto b = allocator.Allocate(80);
+		Check(IsAt(b, 60), "growth not merged with the free block at the old end");
+		Check(a->offset == 0, "existing allocation moved");
+
+		allocator.Grow(150); // Shrinking is ignored
+		const auto stats = allocator.GetStats();
+		Check(stats.capacity == 200 && stats.freeSize == 60 && stats.freeBlockCount == 1, "wrong stats after growing");
+	}
+
+	void TestFragmentation()
+	{
+		RangeAllocator allocator(100);
+		Check(allocator.GetStats().GetFragmentation() == 0.0f, "empty allocator reports fragmentation");
+
+		std::vector<RangeAllocation> allocations;
+		for (auto i = 0; i < 10; ++i)
+			allocations.push_back(*allocator.Allocate(10));
+		for (auto i = 0; i < 10; i += 2)
+			allocator.Free(allocations[i]);
+
+		// Five separate 10 byte holes.
+		const auto stats = allocator.GetStats();
+		Check(stats.freeBlockCount == 5 && stats.largestFreeBlock == 10 && stats.freeSize == 50, "wrong stats with holes");
+		Check(std::abs(stats.GetFragmentation() - 0.8f) < 1e-6f, "wrong fragmentation with holes");
+
+		for (auto i = 1; i < 10; i += 2)
+			allocator.Free(allocations[i]);
+		Check(allocator.GetStats().GetFragmentation() == 0.0f, "fragmentation left once everything is freed");
+	}
+} // namespace
+
+int main()
+{
+	TestAllocateFree();
+	TestCoalesce();
+	TestBestFit();
+	TestAlignment();
+	TestGrow();
+	TestFragmentation();
+
+	if (g_failures != 0)
+	{
+		LOG_ERR("{} checks failed", g_failures);
+		Logger::Get().Flush();
+		return 1;
+	}
+	LOG_INFO("All checks passed");
+	Logger::Get().Flush();
+	return 0;
+}